@@ -0,0 +1,337 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include "boost_process.h"
+#include "zemu_env.h"
+#include "batch.h"
+
+#ifdef _WIN32
+    #define PSAPI_VERSION 2
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+struct s_BatchItem {
+    std::string fileName;
+    std::vector<std::string> arguments;
+    int frames = 0; // 0 if not set in the manifest
+    bool isReplay = false;
+    bool isGolden = false;
+
+    // results
+    bool isFinished = false;
+    bool isLoaded = false;
+    bool isBlank = true;
+    bool isGoldenMatched = false;
+    int exitCode = -1;
+    int emulatedFrames = 0;
+    double fps = 0.0;
+    std::string screenHash;
+    std::string audioHash;
+    uint64_t peakRssKb = 0;
+    uint32_t wallMillis = 0;
+};
+
+static std::mutex batchOutputMutex;
+
+static std::string Batch_JsonEscape(const std::string& value) {
+    std::string result;
+
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            sprintf(buf, "\\u%04x", (unsigned char)c);
+            result += buf;
+        } else {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+static bool Batch_ParseManifestLine(const std::string& line, s_BatchItem& item) {
+    std::istringstream stream(line);
+    std::string token;
+
+    stream >> std::ws;
+
+    if (stream.peek() == '"') {
+        stream.get();
+        std::getline(stream, item.fileName, '"');
+    } else {
+        stream >> item.fileName;
+    }
+
+    if (item.fileName.empty() || item.fileName[0] == '#') {
+        return false;
+    }
+
+    while (stream >> token) {
+        size_t eq = token.find('=');
+        std::string key = token.substr(0, eq);
+        std::string value = (eq == std::string::npos ? "" : token.substr(eq + 1));
+
+        if (key == "frames") {
+            item.frames = std::max(1, atoi(value.c_str()));
+        } else if (key == "keys") {
+            item.arguments.push_back("--keys");
+            item.arguments.push_back(value);
+        } else if (key == "replay") {
+            item.arguments.push_back("--replay");
+            item.arguments.push_back(value);
+            item.isReplay = true;
+        } else if (key == "screen-hash") {
+            item.arguments.push_back("--expect-screen-hash");
+            item.arguments.push_back(value);
+            item.isGolden = true;
+        } else if (key == "audio-hash") {
+            item.arguments.push_back("--expect-audio-hash");
+            item.arguments.push_back(value);
+            item.isGolden = true;
+        } else if (key == "until-tape-end") {
+            item.arguments.push_back("--until-tape-end");
+        } else if (key == "max-speed") {
+            item.arguments.push_back("--max-speed");
+        } else {
+            printf("Unknown manifest option \"%s\" for \"%s\" ignored\n", token.c_str(), item.fileName.c_str());
+        }
+    }
+
+    return true;
+}
+
+static void Batch_ParseResultLine(const std::string& line, s_BatchItem& item) {
+    std::istringstream stream(line.substr(strlen(BATCH_RESULT_PREFIX)));
+    std::string token;
+
+    while (stream >> token) {
+        size_t eq = token.find('=');
+
+        if (eq == std::string::npos) {
+            continue;
+        }
+
+        std::string key = token.substr(0, eq);
+        std::string value = token.substr(eq + 1);
+
+        if (key == "loaded") {
+            item.isLoaded = (value == "1");
+        } else if (key == "blank") {
+            item.isBlank = (value == "1");
+        } else if (key == "golden") {
+            item.isGoldenMatched = (value == "1");
+        } else if (key == "frames") {
+            item.emulatedFrames = atoi(value.c_str());
+        } else if (key == "fps") {
+            item.fps = atof(value.c_str());
+        } else if (key == "screen") {
+            item.screenHash = value;
+        } else if (key == "audio") {
+            item.audioHash = value;
+        } else if (key == "rss") {
+            item.peakRssKb = strtoull(value.c_str(), nullptr, 10);
+        }
+    }
+}
+
+static void Batch_RunItem(const std::string& executable, s_BatchItem& item) {
+    std::vector<std::string> arguments = { "--headless", "--result-line" };
+
+    // replay runs to the end of the movie, unless frames are limited explicitly
+    if (item.frames || !item.isReplay) {
+        arguments.push_back("--frames");
+        arguments.push_back(std::to_string(item.frames ? item.frames : BATCH_DEFAULT_FRAMES));
+    }
+
+    arguments.insert(arguments.end(), item.arguments.begin(), item.arguments.end());
+    if (item.fileName != BATCH_NO_MEDIA) {
+        arguments.push_back(item.fileName);
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    try {
+        boost::process::ipstream ips;
+        boost::process::child child(executable, boost::process::args(arguments), boost::process::std_out > ips);
+        std::string line;
+
+        while (std::getline(ips, line)) {
+            if (!line.compare(0, strlen(BATCH_RESULT_PREFIX), BATCH_RESULT_PREFIX)) {
+                Batch_ParseResultLine(line, item);
+            }
+        }
+
+        child.wait();
+        item.exitCode = child.exit_code();
+    } catch (std::exception& e) {
+        std::lock_guard<std::mutex> lock(batchOutputMutex);
+        printf("Failed to run \"%s\": %s\n", item.fileName.c_str(), e.what());
+    }
+
+    item.wallMillis = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime
+    ).count();
+    item.isFinished = true;
+}
+
+static const char* Batch_GetItemStatus(const s_BatchItem& item) {
+    if (item.isGolden) {
+        return (item.isGoldenMatched ? "golden ok" : "golden MISMATCH");
+    }
+
+    return (item.isLoaded && !item.isBlank ? "ok" : "FAILED");
+}
+
+static bool Batch_WriteReport(const char* reportFileName, std::vector<s_BatchItem>& items, int jobs) {
+    DataWriterPtr writer;
+
+    try {
+        writer = host->storage()->path(reportFileName)->dataWriter();
+    } catch (StorageException& e) {
+        printf("Failed to write report: %s\n", e.what());
+        return false;
+    }
+
+    writer->writeFmt("{\n    \"jobs\": %d,\n    \"items\": [", jobs);
+
+    for (size_t i = 0; i < items.size(); i++) {
+        const s_BatchItem& item = items[i];
+        bool isBooted = (item.exitCode == 0 && item.isLoaded && !item.isBlank);
+
+        writer->writeFmt(i ? ",\n" : "\n");
+        writer->writeFmt("        {\n");
+        writer->writeFmt("            \"file\": \"%s\",\n", Batch_JsonEscape(item.fileName).c_str());
+        writer->writeFmt("            \"boot\": %s,\n", isBooted ? "true" : "false");
+        writer->writeFmt("            \"loaded\": %s,\n", item.isLoaded ? "true" : "false");
+        writer->writeFmt("            \"exitCode\": %d,\n", item.exitCode);
+        writer->writeFmt("            \"frames\": %d,\n", item.emulatedFrames);
+        writer->writeFmt("            \"fps\": %.1f,\n", item.fps);
+        writer->writeFmt("            \"screenHash\": \"%s\",\n", item.screenHash.c_str());
+        writer->writeFmt("            \"audioHash\": \"%s\",\n", item.audioHash.c_str());
+
+        if (item.isGolden) {
+            writer->writeFmt("            \"goldenMatch\": %s,\n", item.isGoldenMatched ? "true" : "false");
+        }
+
+        writer->writeFmt("            \"peakRssKb\": %llu,\n", (unsigned long long)item.peakRssKb);
+        writer->writeFmt("            \"wallMs\": %u\n", item.wallMillis);
+        writer->writeFmt("        }");
+    }
+
+    writer->writeFmt("\n    ]\n}\n");
+    return true;
+}
+
+int Batch_Run(const char* executable, const char* manifestFileName, int jobs, const char* reportFileName) {
+    std::vector<s_BatchItem> items;
+    DataReaderPtr reader;
+
+    try {
+        reader = host->storage()->path(manifestFileName)->dataReader();
+    } catch (StorageException& e) {
+        printf("Failed to load manifest: %s\n", e.what());
+        return 1;
+    }
+
+    while (!reader->isEof()) {
+        s_BatchItem item;
+
+        if (Batch_ParseManifestLine(reader->readLine(), item)) {
+            items.push_back(item);
+        }
+    }
+
+    std::string executablePath(executable);
+
+    if (executablePath.find('/') == std::string::npos && executablePath.find('\\') == std::string::npos) {
+        executablePath = boost::process::search_path(executablePath).string();
+    }
+
+    if (jobs <= 0) {
+        jobs = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    printf("Running %u items on %d workers ...\n", (unsigned)items.size(), jobs);
+
+    std::atomic<size_t> nextItem(0);
+    std::atomic<size_t> finishedItems(0);
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < jobs; i++) {
+        workers.emplace_back([&]() {
+            for (size_t index; (index = nextItem++) < items.size();) {
+                Batch_RunItem(executablePath, items[index]);
+
+                std::lock_guard<std::mutex> lock(batchOutputMutex);
+                printf("[%u/%u] %s : %s\n",
+                    (unsigned)++finishedItems,
+                    (unsigned)items.size(),
+                    items[index].fileName.c_str(),
+                    Batch_GetItemStatus(items[index])
+                );
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (!Batch_WriteReport(reportFileName, items, jobs)) {
+        return 1;
+    }
+
+    printf("Report written to \"%s\"\n", reportFileName);
+
+    int goldenFailed = (int)std::count_if(items.begin(), items.end(), [](const s_BatchItem& item) {
+        return (item.isGolden && !item.isGoldenMatched);
+    });
+
+    if (goldenFailed) {
+        printf("%d golden item(s) failed\n", goldenFailed);
+        return 1;
+    }
+
+    return 0;
+}
+
+uint64_t Batch_GetPeakRssKb(void) {
+    #ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return 0;
+        }
+
+        return counters.PeakWorkingSetSize / 1024;
+    #else
+        struct rusage usage;
+
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+
+        #ifdef __APPLE__
+            return usage.ru_maxrss / 1024; // bytes on macOS
+        #else
+            return usage.ru_maxrss; // kilobytes on linux
+        #endif
+    #endif
+}
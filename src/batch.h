@@ -0,0 +1,25 @@
+#ifndef _BATCH_H_INCLUDED_
+#define _BATCH_H_INCLUDED_
+
+#include <cstdint>
+
+// Manifest is a text file with one item per line:
+//
+// <media file> [frames=N] [keys=<key script>] [replay=<movie>] [until-tape-end] [max-speed]
+//     [screen-hash=<hex>] [audio-hash=<hex>]
+//
+// Empty lines and lines starting with "#" are ignored, media file name may be quoted.
+// Media file name "-" runs emulator without any media (to test ROMs and startup).
+// Items are run for BATCH_DEFAULT_FRAMES frames, items with replay - to the end of the movie (unless frames are set).
+// Every item is run in separate headless zemu process, up to "jobs" processes at once.
+// Items with screen-hash / audio-hash are golden tests: Batch_Run() fails if any of them doesn't match,
+// so manifest with reference programs can be used as regression suite.
+
+#define BATCH_DEFAULT_FRAMES 500
+#define BATCH_NO_MEDIA "-"
+#define BATCH_RESULT_PREFIX "@zemu-result"
+
+int Batch_Run(const char* executable, const char* manifestFileName, int jobs, const char* reportFileName);
+uint64_t Batch_GetPeakRssKb(void);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _BOOST_PROCESS_H_INCLUDED_
+#define _BOOST_PROCESS_H_INCLUDED_
+
+// Include this header instead of <boost/process.hpp>, it has a workaround for macOS.
+
+#ifdef __APPLE__
+    // Fix compilation error due to bug in the boost.process 1.69.x - https://github.com/boostorg/process/issues/55
+    // This "fix" will broke timed functions (eg. wait_for / wait_until), but we don't use them, so it's ok for us.
+    #include <signal.h>
+
+    #ifdef sigemptyset
+        #undef sigemptyset
+    #endif
+
+    #ifdef sigaddset
+        #undef sigaddset
+    #endif
+
+    #ifdef sigtimedwait
+        #undef sigtimedwait
+    #endif
+
+    int sigemptyset(sigset_t *);
+    int sigaddset(sigset_t *, int);
+    int sigtimedwait(const sigset_t *set, siginfo_t *info, const struct timespec *timeout);
+#endif
+
+#include <boost/process.hpp>
+
+#endif
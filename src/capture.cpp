@@ -0,0 +1,573 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "zemu_env.h"
+#include "capture.h"
+#include "overlay.h"
+#include "sound/mixer.h"
+
+#ifdef _WIN32
+    #define popen _popen
+    #define pclose _pclose
+    #define CAPTURE_PIPE_MODE "wb"
+#else
+    #define CAPTURE_PIPE_MODE "w"
+#endif
+
+#define CAPTURE_WAV_HEADER_SIZE 44
+#define CAPTURE_Y4M_FRAME_SIZE (6 + WIDTH * HEIGHT + (WIDTH / 2) * (HEIGHT / 2) * 2) // with "FRAME\n"
+
+extern C_Font* fixed_font;
+
+class C_CaptureStream {
+public:
+
+    C_CaptureStream() {}
+    ~C_CaptureStream() { Close(); }
+
+    // "|command" opens pipe to the command, anything else is a file
+    void Open(const std::string& fileName) {
+        if (fileName[0] != '|') {
+            writer = host->storage()->path(fileName)->dataWriter();
+            return;
+        }
+
+        #ifndef _WIN32
+            // broken pipe (e.g. encoder has exited) is reported by fwrite() instead of killing the emulator
+            signal(SIGPIPE, SIG_IGN);
+        #endif
+
+        pipe = popen(fileName.c_str() + 1, CAPTURE_PIPE_MODE);
+
+        if (!pipe) {
+            throw StorageException(std::string("Can't run \"") + (fileName.c_str() + 1) + "\"");
+        }
+    }
+
+    bool IsOpen() {
+        return (writer || pipe);
+    }
+
+    bool IsPipe() {
+        return (pipe != nullptr);
+    }
+
+    bool Write(const void* data, size_t size) {
+        if (pipe) {
+            return (fwrite(data, 1, size, pipe) == size);
+        }
+
+        return writer->writeBlock((void*)data, size);
+    }
+
+    // sizes in headers are known only at the end, pipes are left with the placeholders
+    void Patch(uintmax_t position, uint32_t value) {
+        if (!writer) {
+            return;
+        }
+
+        writer->setPosition(position);
+        writer->writeDword(value);
+    }
+
+    void Close() {
+        writer = nullptr;
+
+        if (pipe) {
+            pclose(pipe);
+            pipe = nullptr;
+        }
+    }
+
+private:
+
+    DataWriterPtr writer;
+    FILE* pipe = nullptr;
+
+    C_CaptureStream(const C_CaptureStream&);
+    C_CaptureStream& operator=(const C_CaptureStream&);
+};
+
+struct s_CaptureItem {
+    bool isVideo;
+    int buffer; // index in the pool, -1 if the queue was full
+    int samples;
+    unsigned frames; // consecutive lagged frames are coalesced in one item (samples are summed)
+};
+
+static int captureVideoFormat = CAPTURE_VIDEO_Y4M;
+static std::string captureVideoFileName;
+static std::string captureAudioFileName;
+static unsigned captureQueueFrames = CAPTURE_DEFAULT_QUEUE_FRAMES;
+
+static std::thread captureThread;
+static std::mutex captureMutex;
+static std::condition_variable captureCondition;
+static std::deque<s_CaptureItem> captureItems;
+static std::vector<std::vector<uint32_t>> captureVideoBuffers;
+static std::vector<std::vector<uint32_t>> captureAudioBuffers;
+static std::vector<int> captureFreeVideoBuffers;
+static std::vector<int> captureFreeAudioBuffers;
+static bool captureIsClosing = false;
+static bool captureIsFinished = false;
+static std::string captureMessage;
+
+// emulation thread
+static bool captureIsActive = false;
+static bool captureHasVideo = false;
+static bool captureHasAudio = false;
+static unsigned captureFrames = 0; // of the stream which is written
+static unsigned captureLaggedItems = 0;
+
+// writer thread
+static C_CaptureStream captureVideo;
+static C_CaptureStream captureAudio;
+static std::vector<uint8_t> captureVideoFrame; // last converted frame, written again when frame was lagged
+static uint32_t captureAudioBytes = 0;
+static bool captureIsFailed = false;
+
+static void Capture_PutDword(uint8_t* into, uint32_t value) {
+    into[0] = (uint8_t)value;
+    into[1] = (uint8_t)(value >> 8);
+    into[2] = (uint8_t)(value >> 16);
+    into[3] = (uint8_t)(value >> 24);
+}
+
+static void Capture_PutWord(uint8_t* into, uint16_t value) {
+    into[0] = (uint8_t)value;
+    into[1] = (uint8_t)(value >> 8);
+}
+
+// sizes are unknown for pipes, so they are the maximal ones, as other streaming tools do
+static void Capture_WriteWavHeader(void) {
+    uint8_t header[CAPTURE_WAV_HEADER_SIZE];
+
+    memcpy(header, "RIFF", 4);
+    Capture_PutDword(header + 4, 0xFFFFFFFF);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    Capture_PutDword(header + 16, 16);
+    Capture_PutWord(header + 20, 1); // PCM
+    Capture_PutWord(header + 22, 2);
+    Capture_PutDword(header + 24, SOUND_FREQ);
+    Capture_PutDword(header + 28, SOUND_FREQ * 4);
+    Capture_PutWord(header + 32, 4);
+    Capture_PutWord(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    Capture_PutDword(header + 40, 0xFFFFFFFF);
+
+    if (!captureAudio.Write(header, sizeof(header))) {
+        throw StorageException("Write error");
+    }
+}
+
+// C420jpeg is only the chroma siting, range must be set explicitly (readers assume limited range by default)
+static void Capture_WriteY4mHeader(void) {
+    char header[0x100];
+    sprintf(header, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", WIDTH, HEIGHT, 1000 / FRAME_WAIT_MS);
+
+    if (!captureVideo.Write(header, strlen(header))) {
+        throw StorageException("Write error");
+    }
+}
+
+static void Capture_ConvertRgb(uint8_t* into, const uint32_t* pixels) {
+    for (int i = WIDTH * HEIGHT; i--;) {
+        uint32_t c = *(pixels++);
+
+        *(into++) = (uint8_t)STAGE_GETR(c);
+        *(into++) = (uint8_t)STAGE_GETG(c);
+        *(into++) = (uint8_t)STAGE_GETB(c);
+    }
+}
+
+// BT.601 full range, chroma is taken from the average of 2 x 2 pixels
+static void Capture_ConvertY4m(uint8_t* into, const uint32_t* pixels) {
+    memcpy(into, "FRAME\n", 6);
+
+    uint8_t* dstY = into + 6;
+    uint8_t* dstU = dstY + WIDTH * HEIGHT;
+    uint8_t* dstV = dstU + (WIDTH / 2) * (HEIGHT / 2);
+
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        uint32_t c = pixels[i];
+        *(dstY++) = (uint8_t)((STAGE_GETR(c) * 77 + STAGE_GETG(c) * 150 + STAGE_GETB(c) * 29 + 128) >> 8);
+    }
+
+    for (int y = 0; y < HEIGHT; y += 2) {
+        const uint32_t* top = pixels + y * WIDTH;
+        const uint32_t* bottom = top + WIDTH;
+
+        for (int x = 0; x < WIDTH; x += 2) {
+            int r = STAGE_GETR(top[x]) + STAGE_GETR(top[x + 1]) + STAGE_GETR(bottom[x]) + STAGE_GETR(bottom[x + 1]);
+            int g = STAGE_GETG(top[x]) + STAGE_GETG(top[x + 1]) + STAGE_GETG(bottom[x]) + STAGE_GETG(bottom[x + 1]);
+            int b = STAGE_GETB(top[x]) + STAGE_GETB(top[x + 1]) + STAGE_GETB(bottom[x]) + STAGE_GETB(bottom[x + 1]);
+
+            // sums of 4 pixels, so shift is 8 + 2, and offset of 128 is (128 << 10) plus rounding
+            *(dstU++) = (uint8_t)std::min(255, (r * -43 + g * -85 + b * 128 + 0x20200) >> 10);
+            *(dstV++) = (uint8_t)std::min(255, (r * 128 + g * -107 + b * -21 + 0x20200) >> 10);
+        }
+    }
+}
+
+static void Capture_WriteItem(const s_CaptureItem& item) {
+    if (item.isVideo) {
+        if (item.buffer >= 0) {
+            const uint32_t* pixels = captureVideoBuffers[item.buffer].data();
+
+            if (captureVideoFormat == CAPTURE_VIDEO_Y4M) {
+                Capture_ConvertY4m(captureVideoFrame.data(), pixels);
+            } else {
+                Capture_ConvertRgb(captureVideoFrame.data(), pixels);
+            }
+        }
+
+        for (unsigned i = 0; i < item.frames && !captureIsFailed; i++) {
+            captureIsFailed = !captureVideo.Write(captureVideoFrame.data(), captureVideoFrame.size());
+        }
+
+        return;
+    }
+
+    captureAudioBytes += item.samples * sizeof(uint32_t);
+
+    if (item.buffer >= 0) {
+        const uint32_t* samples = captureAudioBuffers[item.buffer].data();
+        captureIsFailed = (captureIsFailed || !captureAudio.Write(samples, item.samples * sizeof(uint32_t)));
+        return;
+    }
+
+    static const uint32_t silence[MIX_BUFFER_SIZE] = {};
+
+    for (int left = item.samples; left > 0 && !captureIsFailed; left -= MIX_BUFFER_SIZE) {
+        captureIsFailed = !captureAudio.Write(silence, std::min(left, MIX_BUFFER_SIZE) * sizeof(uint32_t));
+    }
+}
+
+static void Capture_Finish(void) {
+    try {
+        if (captureAudio.IsOpen() && !captureAudio.IsPipe()) {
+            captureAudio.Patch(4, CAPTURE_WAV_HEADER_SIZE - 8 + captureAudioBytes);
+            captureAudio.Patch(40, captureAudioBytes);
+        }
+    } catch (StorageException& e) {
+        printf("Capture failed: %s\n", e.what());
+        captureIsFailed = true;
+    }
+
+    captureVideo.Close();
+    captureAudio.Close();
+}
+
+static void Capture_Worker(void) {
+    std::unique_lock<std::mutex> lock(captureMutex);
+
+    for (;;) {
+        captureCondition.wait(lock, [] { return captureIsClosing || !captureItems.empty(); });
+
+        if (captureItems.empty()) {
+            break;
+        }
+
+        s_CaptureItem item = captureItems.front();
+        captureItems.pop_front();
+
+        lock.unlock();
+
+        // after the error queue is only drained, so emulation is not affected
+        if (!captureIsFailed) {
+            try {
+                Capture_WriteItem(item);
+            } catch (StorageException& e) {
+                printf("Capture failed: %s\n", e.what());
+                captureIsFailed = true;
+            }
+        }
+
+        lock.lock();
+
+        if (item.buffer >= 0) {
+            (item.isVideo ? captureFreeVideoBuffers : captureFreeAudioBuffers).push_back(item.buffer);
+        }
+    }
+
+    lock.unlock();
+    Capture_Finish();
+    lock.lock();
+
+    captureMessage = (captureIsFailed ? "Error writing capture" : "Capture saved");
+    captureIsFinished = true;
+}
+
+// Waits until the stopped capture is completely written.
+static void Capture_Join(void) {
+    if (!captureThread.joinable()) {
+        return;
+    }
+
+    captureThread.join();
+    captureIsFinished = false;
+    captureIsClosing = false;
+
+    if (captureMessage.empty()) {
+        return;
+    }
+
+    if (captureLaggedItems) {
+        captureMessage += ", lagged " + std::to_string(captureLaggedItems);
+    }
+
+    printf("%s\n", captureMessage.c_str());
+    SetMessage(captureMessage.c_str());
+    captureMessage.clear();
+}
+
+static void Capture_OnFrameStart(void) {
+    bool isFinished;
+
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        isFinished = captureIsFinished;
+    }
+
+    if (isFinished) {
+        Capture_Join();
+    }
+}
+
+static void Capture_AllocPool(std::vector<std::vector<uint32_t>>& pool, std::vector<int>& freeBuffers, size_t size) {
+    if (pool.size() != captureQueueFrames) {
+        pool.assign(captureQueueFrames, std::vector<uint32_t>(size));
+    }
+
+    freeBuffers.clear();
+
+    for (int i = (int)captureQueueFrames; i--;) {
+        freeBuffers.push_back(i);
+    }
+}
+
+static int Capture_AcquireBuffer(std::vector<int>& freeBuffers) {
+    std::lock_guard<std::mutex> lock(captureMutex);
+
+    if (freeBuffers.empty()) {
+        return -1;
+    }
+
+    int buffer = freeBuffers.back();
+    freeBuffers.pop_back();
+    return buffer;
+}
+
+// Lagged frame is added to the previous queued item of the same stream, when that item is lagged too, so queue
+// is bounded by the pools size (video and audio streams are separate, so their order between each other is not kept).
+static void Capture_Push(bool isVideo, int buffer, int samples) {
+    if (buffer < 0) {
+        captureLaggedItems++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        auto it = captureItems.rbegin();
+
+        while (it != captureItems.rend() && it->isVideo != isVideo) {
+            ++it;
+        }
+
+        if (buffer < 0 && it != captureItems.rend() && it->buffer < 0) {
+            it->frames++;
+            it->samples += samples;
+            return;
+        }
+
+        captureItems.push_back({ isVideo, buffer, samples, 1 });
+    }
+
+    captureCondition.notify_one();
+}
+
+void Capture_Init(void) {
+    Config* config = host->config();
+
+    captureVideoFormat = (config->getString("capture", "video_format", "y4m") == "rgb"
+        ? CAPTURE_VIDEO_RGB
+        : CAPTURE_VIDEO_Y4M
+    );
+
+    captureVideoFileName = config->getString("capture", "video_file", "capture.y4m");
+    captureAudioFileName = config->getString("capture", "audio_file", "capture.wav");
+
+    captureQueueFrames = (unsigned)std::max(
+        2,
+        config->getInt("capture", "queue_frames", CAPTURE_DEFAULT_QUEUE_FRAMES)
+    );
+
+    AttachFrameStartHandler(Capture_OnFrameStart);
+}
+
+void Capture_Close(void) {
+    Capture_Stop();
+    Capture_Join();
+
+    captureVideoBuffers.clear();
+    captureAudioBuffers.clear();
+}
+
+void Capture_Start(const char* videoFileName, const char* audioFileName) {
+    Capture_Stop();
+    Capture_Join();
+
+    captureHasVideo = (videoFileName && *videoFileName);
+    captureHasAudio = (audioFileName && *audioFileName);
+
+    if (!captureHasVideo && !captureHasAudio) {
+        SetMessage("Nothing to capture");
+        return;
+    }
+
+    try {
+        if (captureHasVideo) {
+            captureVideo.Open(videoFileName);
+
+            if (captureVideoFormat == CAPTURE_VIDEO_Y4M) {
+                Capture_WriteY4mHeader();
+            }
+        }
+
+        if (captureHasAudio) {
+            captureAudio.Open(audioFileName);
+            Capture_WriteWavHeader();
+        }
+    } catch (StorageException& e) {
+        printf("Capture failed: %s\n", e.what());
+
+        captureVideo.Close();
+        captureAudio.Close();
+
+        SetMessage("Error starting capture");
+        return;
+    }
+
+    if (captureHasVideo) {
+        // black frame is written if the first one was lagged
+        captureVideoFrame.assign(captureVideoFormat == CAPTURE_VIDEO_Y4M ? CAPTURE_Y4M_FRAME_SIZE : WIDTH * HEIGHT * 3, 0);
+
+        if (captureVideoFormat == CAPTURE_VIDEO_Y4M) {
+            std::vector<uint32_t> black(WIDTH * HEIGHT, STAGE_MAKERGB(0, 0, 0));
+            Capture_ConvertY4m(captureVideoFrame.data(), black.data());
+        }
+
+        Capture_AllocPool(captureVideoBuffers, captureFreeVideoBuffers, WIDTH * HEIGHT);
+    }
+
+    if (captureHasAudio) {
+        Capture_AllocPool(captureAudioBuffers, captureFreeAudioBuffers, MIX_BUFFER_SIZE);
+    }
+
+    captureItems.clear();
+    captureAudioBytes = 0;
+    captureIsFailed = false;
+    captureFrames = 0;
+    captureLaggedItems = 0;
+
+    captureIsActive = true;
+    captureThread = std::thread(Capture_Worker);
+
+    SetMessage("Capture started");
+}
+
+// Writer finishes the queue in the background, result is reported on one of the next frames.
+void Capture_Stop(void) {
+    if (!captureIsActive) {
+        return;
+    }
+
+    captureIsActive = false;
+
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        captureIsClosing = true;
+    }
+
+    captureCondition.notify_all();
+}
+
+void Capture_Toggle(void) {
+    if (captureIsActive) {
+        Capture_Stop();
+        return;
+    }
+
+    Capture_Start(captureVideoFileName.c_str(), captureAudioFileName.c_str());
+}
+
+bool Capture_IsActive(void) {
+    return captureIsActive;
+}
+
+void Capture_AddFrame(const uint32_t* pixels) {
+    if (!captureIsActive || !captureHasVideo) {
+        return;
+    }
+
+    int buffer = Capture_AcquireBuffer(captureFreeVideoBuffers);
+
+    if (buffer >= 0) {
+        memcpy(captureVideoBuffers[buffer].data(), pixels, WIDTH * HEIGHT * sizeof(uint32_t));
+    }
+
+    captureFrames++;
+    Capture_Push(true, buffer, 0);
+}
+
+void Capture_AddSound(const uint32_t* samples, int count) {
+    if (!captureIsActive || !captureHasAudio) {
+        return;
+    }
+
+    count = std::min(count, MIX_BUFFER_SIZE);
+    int buffer = Capture_AcquireBuffer(captureFreeAudioBuffers);
+
+    if (buffer >= 0) {
+        memcpy(captureAudioBuffers[buffer].data(), samples, count * sizeof(uint32_t));
+    }
+
+    if (!captureHasVideo) {
+        captureFrames++;
+    }
+
+    Capture_Push(false, buffer, count);
+}
+
+void Capture_Draw(void) {
+    if (!captureIsActive) {
+        Overlay_Hide(OVERLAY_ITEM_CAPTURE);
+        return;
+    }
+
+    char buf[0x100];
+    unsigned queued;
+
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        queued = captureQueueFrames - (unsigned)(captureHasVideo ? captureFreeVideoBuffers : captureFreeAudioBuffers).size();
+    }
+
+    unsigned seconds = captureFrames * FRAME_WAIT_MS / 1000;
+    int len = sprintf(buf, "REC %u:%02u queue %u/%u", seconds / 60, seconds % 60, queued, captureQueueFrames);
+
+    if (captureLaggedItems) {
+        sprintf(buf + len, " lag %u", captureLaggedItems);
+    }
+
+    Overlay_Text(OVERLAY_ITEM_CAPTURE, 8, HEIGHT - 4 - fixed_font->Height() * 2, fixed_font, buf);
+}
@@ -0,0 +1,27 @@
+#ifndef _CAPTURE_H_INCLUDED_
+#define _CAPTURE_H_INCLUDED_
+
+#include "zemu.h"
+
+// Capture writes every emulated frame (raw RGB or Y4M) and the mixed sound (WAV) to files, or to the pipe
+// when file name starts with "|". Frames and sound are copied into preallocated buffers and passed through
+// the bounded queue to the writer thread, so emulation never waits for the disk. When the queue is full,
+// frame is written as a repeat of the previous one (and sound as silence of the same length),
+// so streams stay in sync. Such frames are counted as lagged and shown by Capture_Draw().
+
+#define CAPTURE_VIDEO_RGB 0 // 24 bits per pixel, WIDTH x HEIGHT, no headers
+#define CAPTURE_VIDEO_Y4M 1 // 4:2:0, full range
+
+#define CAPTURE_DEFAULT_QUEUE_FRAMES 100
+
+void Capture_Init(void);
+void Capture_Close(void);
+void Capture_Start(const char* videoFileName, const char* audioFileName); // nullptr or empty - stream is not written
+void Capture_Stop(void);
+void Capture_Toggle(void); // starts with file names from the config
+bool Capture_IsActive(void);
+void Capture_AddFrame(const uint32_t* pixels);
+void Capture_AddSound(const uint32_t* samples, int count); // 2 x int16_t (stereo) for each sample
+void Capture_Draw(void);
+
+#endif
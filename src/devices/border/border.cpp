@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "border.h"
+#include "state.h"
 
 uint8_t C_Border::portFB;
 C_SndRenderer C_Border::sndRenderer;
@@ -19,6 +20,21 @@ void C_Border::Init(void) {
 void C_Border::Close(void) {
 }
 
+void C_Border::SaveState(C_StateWriter& writer) {
+    writer.WriteByte(portFB);
+    sndRenderer.SaveState(writer);
+}
+
+void C_Border::LoadState(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
+    }
+
+    portFB = reader.ReadByte();
+    sndRenderer.LoadState(reader);
+}
+
 bool C_Border::OutputByteCheckPort(uint16_t port) {
     return (!(port & 1));
 }
@@ -38,8 +54,8 @@ bool C_Border::OnOutputByte(uint16_t port, uint8_t value) {
         sndRenderer.Update(devClk, vol, vol);
     }
 
-    if (renderPtr && ((portFB & 7) != (value & 7))) {
-        renderPtr(cpuClk + z80ex_op_tstate(cpu));
+    if ((portFB & 7) != (value & 7)) {
+        RenderCatchUp(cpuClk + z80ex_op_tstate(cpu));
     }
 
     portFB = value;
@@ -16,6 +16,8 @@ public:
 
     void Init(void);
     void Close(void);
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader, unsigned version);
 
     static bool OutputByteCheckPort(uint16_t port);
     static bool OnOutputByte(uint16_t port, uint8_t value);
@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "covox.h"
+#include "state.h"
 
 C_SndRenderer C_Covox::sndRenderer;
 bool C_Covox::enabled = false;
@@ -23,6 +24,21 @@ void C_Covox::Init(void) {
 void C_Covox::Close(void) {
 }
 
+void C_Covox::SaveState(C_StateWriter& writer) {
+    if (enabled) {
+        sndRenderer.SaveState(writer);
+    }
+}
+
+void C_Covox::LoadState(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
+    }
+
+    sndRenderer.LoadState(reader);
+}
+
 bool C_Covox::OutputByteCheckPort(uint16_t port) {
     return ((port & 0x07) == 0x03);
 }
@@ -1,12 +1,19 @@
 #ifndef _DEVICE_H_INCLUDED_
 #define _DEVICE_H_INCLUDED_
 
+class C_StateWriter;
+class C_StateReader;
+
 class C_Device {
 public:
 
     virtual ~C_Device() {};
     virtual void Init(void) = 0;
     virtual void Close(void) = 0;
+
+    // devices without own state (like input devices) don't need to override these
+    virtual void SaveState(C_StateWriter& writer) {}
+    virtual void LoadState(C_StateReader& reader, unsigned version) {}
 };
 
 #endif
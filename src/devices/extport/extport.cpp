@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "extport.h"
+#include "state.h"
 
 #define EXTPORT_16COLORS_MASK       1       // 16 colors (4bits per pixel)
 #define EXTPORT_512x192_MASK        2       // 512x192 monochrome
@@ -47,6 +48,21 @@ void C_ExtPort::Init(void) {
 void C_ExtPort::Close(void) {
 }
 
+void C_ExtPort::SaveState(C_StateWriter& writer) {
+    if (enabled) {
+        writer.WriteByte(portEFF7);
+    }
+}
+
+void C_ExtPort::LoadState(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
+    }
+
+    portEFF7 = reader.ReadByte();
+}
+
 bool C_ExtPort::OutputByteCheckPort(uint16_t port) {
     return (port == 0xEFF7);
 }
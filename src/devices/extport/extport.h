@@ -14,6 +14,8 @@ public:
 
     void Init(void);
     void Close(void);
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader, unsigned version);
 
     static bool Is16Colors(void);
     static bool Is512x192(void);
@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include "gsound.h"
 #include "../mmanager/mmanager.h"
+#include "state.h"
 
 C_SndRenderer C_GSound::sndRenderer;
 bool C_GSound::enabled = false;
@@ -75,6 +76,49 @@ void C_GSound::Close(void) {
     }
 }
 
+void C_GSound::SaveState(C_StateWriter& writer) {
+    if (!enabled) {
+        return;
+    }
+
+    writer.WriteByte(regCommand);
+    writer.WriteByte(regStatus);
+    writer.WriteByte(regData);
+    writer.WriteByte(regOutput);
+    writer.WriteBlock(volume, sizeof(volume));
+    writer.WriteBlock(channel, sizeof(channel));
+    writer.WriteByte(memPage);
+    writer.WriteDword(gsClk);
+    writer.WriteCpu(gsCpu);
+    writer.WriteBlock(&mem[0x8000], sizeof(mem) - 0x8000); // first page is rom
+    sndRenderer.SaveState(writer);
+}
+
+void C_GSound::LoadState(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
+    }
+
+    if (!enabled) {
+        return;
+    }
+
+    regCommand = reader.ReadByte();
+    regStatus = reader.ReadByte();
+    regData = reader.ReadByte();
+    regOutput = reader.ReadByte();
+    reader.ReadBlock(volume, sizeof(volume));
+    reader.ReadBlock(channel, sizeof(channel));
+    memPage = reader.ReadByte() & GS_MEMPAGE_MASK;
+    gsClk = reader.ReadDword();
+    reader.ReadCpu(gsCpu);
+    reader.ReadBlock(&mem[0x8000], sizeof(mem) - 0x8000);
+    sndRenderer.LoadState(reader);
+
+    UpdateMaps();
+}
+
 bool C_GSound::InputByteCheckPort(uint16_t port) {
     return ((port & 0xFF) == 0xB3 || (port & 0xFF) == 0xBB);
 }
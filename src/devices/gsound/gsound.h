@@ -19,6 +19,8 @@ public:
 
     void Init(void);
     void Close(void);
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader, unsigned version);
 
     static bool InputByteCheckPort(uint16_t port);
     static bool OutputByteCheckPort(uint16_t port);
@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "kempston.h"
+#include "movie.h"
 
 uint8_t C_KempstonStick::joyState = 0;
 uint8_t C_KempstonStick::joyOnKeybState = 0;
@@ -143,6 +144,12 @@ bool C_KempstonStick::InputByteCheckPort(uint16_t port) {
 }
 
 bool C_KempstonStick::OnInputByte(uint16_t port, uint8_t& retval) {
+    SampleHostInput();
     retval = (joyOnKeyb ? joyOnKeybState : joyState);
+
+    if (movieState != MOVIE_STATE_NONE) {
+        Movie_SyncInput(MOVIE_DEVICE_KEMPSTON, &retval);
+    }
+
     return true;
 }
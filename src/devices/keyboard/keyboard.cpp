@@ -6,6 +6,7 @@
 #include <string.h>
 #include "zemu_env.h"
 #include "tape/tape.h"
+#include "movie.h"
 #include "keyboard.h"
 #include "keys.h"
 
@@ -265,6 +266,18 @@ void C_Keyboard::ReadKbdConfig(void) {
     printf("Config loaded successfully\n");
 }
 
+bool C_Keyboard::FindZxKey(const char* name, int& portnum, int& bitmask) {
+    for (int i = 0; cfgZxKeys[i].cfgname[0]; i++) {
+        if (!strcasecmp(name, cfgZxKeys[i].cfgname)) {
+            portnum = cfgZxKeys[i].portnum;
+            bitmask = cfgZxKeys[i].bitmask;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void C_Keyboard::Init(void) {
     ReadKbdConfig();
 
@@ -289,6 +302,27 @@ void C_Keyboard::ResetPressedState(void) {
     }
 }
 
+// actions are triggered on key release, this allows to check whether key of the action is being held
+bool C_Keyboard::IsActionHeld(void (* action)(void)) {
+    for (int key : hostKeyPressed) {
+        s_HostKey* hostKey = &hostKeys[key];
+
+        for (int k = 0; k < hostKey->mods.count; k++) {
+            if (hostKey->mods.actions[k] == action
+                && hostKeyPressed.find(hostKey->mods.keyMod[k]) != hostKeyPressed.end()
+            ) {
+                return true;
+            }
+        }
+
+        if (hostKey->action == action) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool C_Keyboard::OnKeyDown(StageEvent& event) {
     int key = event.keyCode;
 
@@ -319,7 +353,7 @@ bool C_Keyboard::OnKeyDown(StageEvent& event) {
         }
 
         if (hostKey->mods.actions[k] && keyMod == STAGE_KEYCODE_NUMLOCK) {
-            hostKey->mods.actions[k]();
+            RunAction(hostKey->mods.actions[k]);
             return false;
         }
 
@@ -338,7 +372,7 @@ bool C_Keyboard::OnKeyDown(StageEvent& event) {
     }
 
     if (hostKey->action && key == STAGE_KEYCODE_NUMLOCK) {
-        hostKey->action();
+        RunAction(hostKey->action);
         return false;
     }
 
@@ -379,7 +413,7 @@ bool C_Keyboard::OnKeyUp(StageEvent& event) {
         bool isModPressed = (hostKeyPressed.find(keyMod) != hostKeyPressed.end());
 
         if (isModPressed && hostKey->mods.actions[k]) {
-            hostKey->mods.actions[k]();
+            RunAction(hostKey->mods.actions[k]);
             return false;
         }
 
@@ -409,7 +443,7 @@ bool C_Keyboard::OnKeyUp(StageEvent& event) {
     }
 
     if (hostKey->action) {
-        hostKey->action();
+        RunAction(hostKey->action);
         return false;
     }
 
@@ -427,12 +461,24 @@ bool C_Keyboard::InputByteCheckPort(uint16_t port) {
 }
 
 bool C_Keyboard::OnInputByte(uint16_t port, uint8_t& retval) {
+    SampleHostInput();
+
+    uint8_t matrix[8];
+
+    for (int i = 0; i < 8; i++) {
+        matrix[i] = (uint8_t)keyboard[i];
+    }
+
+    if (movieState != MOVIE_STATE_NONE) {
+        Movie_SyncInput(MOVIE_DEVICE_KEYBOARD, matrix);
+    }
+
     retval = 255;
     int hport = (port >> 8);
 
     for (int i = 0; i < 8; i++) {
         if (!(hport & 1)) {
-            retval &= keyboard[i];
+            retval &= matrix[i];
         }
 
         hport >>= 1;
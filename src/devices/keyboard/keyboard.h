@@ -42,9 +42,11 @@ public:
     static int keyboard[8];
 
     static void ReadKbdConfig(void);
+    static bool FindZxKey(const char* name, int& portnum, int& bitmask);
     void Init(void);
     void Close(void);
     void ResetPressedState(void);
+    static bool IsActionHeld(void (* action)(void));
 
     static bool OnKeyDown(StageEvent& event);
     static bool OnKeyUp(StageEvent& event);
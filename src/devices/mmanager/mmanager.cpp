@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include "mmanager.h"
 #include "../extport/extport.h"
+#include "state.h"
 
 #include <stdlib.h>
 
@@ -15,6 +16,7 @@ uint8_t C_MemoryManager::rom[0x8000];
 uint8_t C_MemoryManager::ram[0x4000 * 64];
 uint8_t* C_MemoryManager::rom_map;
 uint8_t* C_MemoryManager::ram_map;
+bool C_MemoryManager::isVideoRamMapped;
 bool C_MemoryManager::enable512;
 bool C_MemoryManager::enable1024;
 
@@ -81,6 +83,39 @@ void C_MemoryManager::Init(void) {
 void C_MemoryManager::Close(void) {
 }
 
+// state can be loaded only with the same memory size ("enable512" / "enable1024")
+void C_MemoryManager::SaveState(C_StateWriter& writer) {
+    unsigned pages = GetPagesCount();
+
+    writer.WriteByte(port7FFD);
+    writer.WriteByte((uint8_t)pages);
+    writer.WriteBlock(ram, pages * 0x4000);
+}
+
+void C_MemoryManager::LoadState(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
+    }
+
+    uint8_t port = reader.ReadByte();
+    unsigned pages = reader.ReadByte();
+
+    if (pages != GetPagesCount()) {
+        printf("State has %u memory pages, but %u are configured\n", pages, GetPagesCount());
+        reader.Fail();
+        return;
+    }
+
+    port7FFD = port;
+    reader.ReadBlock(ram, pages * 0x4000);
+    Remap();
+}
+
+unsigned C_MemoryManager::GetPagesCount(void) {
+    return (enable1024 ? 64 : (enable512 ? 32 : 8));
+}
+
 void C_MemoryManager::Remap(void) {
     if (enable1024) {
         ram_map = &ram[(((port7FFD & 0xE0) >> 2) | (port7FFD & 7)) * 0x4000];
@@ -91,6 +126,7 @@ void C_MemoryManager::Remap(void) {
     }
 
     rom_map = &rom[(port7FFD & 16) ? 0x4000 : 0];
+    isVideoRamMapped = (ram_map >= &ram[RAM_BANK4] && ram_map <= &ram[RAM_BANK7]);
 }
 
 ptrOnReadByteFunc C_MemoryManager::ReadByteCheckAddr(uint16_t addr, bool m1) {
@@ -139,10 +175,19 @@ bool C_MemoryManager::OnWriteByte(uint16_t addr, uint8_t value) {
     }
 
     if (addr < 0x8000) {
+        // picture up to the start of the instruction is rendered with old memory contents
+        if (addr < 0x4000 + VIDEO_RAM_SIZE) {
+            RenderCatchUpWrite(cpuClk, addr - 0x4000 + RAM_BANK5, value);
+        }
+
         ram[addr - 0x4000 + RAM_BANK5] = value;
     } else if (addr < 0xC000) {
         ram[addr - 0x8000 + RAM_BANK2] = value;
     } else {
+        if (isVideoRamMapped && addr < 0xC000 + VIDEO_RAM_SIZE) {
+            RenderCatchUpWrite(cpuClk, (unsigned)(ram_map - ram) + addr - 0xC000, value);
+        }
+
         ram_map[addr - 0xC000] = value;
     }
 
@@ -157,6 +202,11 @@ bool C_MemoryManager::OnOutputByte(uint16_t port, uint8_t value) {
     bool himemEnabled = !dev_extport.Is128Lock();
 
     if (!(port7FFD & 32) || (enable1024 && himemEnabled)) {
+        // screen page is switched (new page is shown after the instruction, as in the memory writes)
+        if ((port7FFD ^ value) & 8) {
+            RenderCatchUp(cpuClk);
+        }
+
         if (enable512 && port == 0x7FFD && himemEnabled) {
             port7FFD = value;
         } else {
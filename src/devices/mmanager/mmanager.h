@@ -22,13 +22,17 @@ public:
 
     static uint8_t* rom_map;
     static uint8_t* ram_map;
+    static bool isVideoRamMapped; // one of the screen pages (4 - 7) is mapped at 0xC000
     static bool enable512;
     static bool enable1024;
 
     static void ReadFile(void);
     void Init(void);
     void Close(void);
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader, unsigned version);
 
+    static unsigned GetPagesCount(void);
     static void Remap(void);
     static ptrOnReadByteFunc ReadByteCheckAddr(uint16_t addr, bool m1);
     static uint8_t OnReadByte_ROM(uint16_t addr, bool m1);
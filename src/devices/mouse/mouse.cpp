@@ -2,43 +2,88 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "mouse.h"
+#include "movie.h"
 
 uint8_t C_Mouse::portFBDF;
 uint8_t C_Mouse::portFFDF;
 uint8_t C_Mouse::portFADF;
 uint8_t C_Mouse::wheelCnt;
+uint8_t C_Mouse::frameStartX;
+uint8_t C_Mouse::frameStartY;
+int C_Mouse::frameDeltaX;
+int C_Mouse::frameDeltaY;
+int C_Mouse::remainderX;
+int C_Mouse::remainderY;
+uint8_t C_Mouse::buttonsMask;
 
 void C_Mouse::Init(void) {
     AttachZ80InputHandler(InputByteCheckPort, OnInputByte);
     AttachHwHandler(STAGE_EVENT_MOUSEWHEEL, OnHwMouseWheel);
+    AttachFrameStartHandler(OnFrameStart);
 
     portFBDF = 128;
     portFFDF = 96;
     portFADF = 255;
     wheelCnt = 255;
+
+    frameStartX = portFBDF;
+    frameStartY = portFFDF;
+    frameDeltaX = 0;
+    frameDeltaY = 0;
+    remainderX = 0;
+    remainderY = 0;
+    buttonsMask = 0x0F;
 }
 
 void C_Mouse::Close(void) {
 }
 
-void C_Mouse::UpdateState(void) {
+void C_Mouse::OnFrameStart(void) {
     StageMouseState state;
     host->stage()->getRelativeMouseState(&state);
 
-    portFBDF += state.x / params.mouseDivX;
-    portFFDF -= state.y / params.mouseDivY;
-    portFADF = (wheelCnt << 4) | 0x0F;
+    // complete motion of the previous frame
+    frameStartX += frameDeltaX;
+    frameStartY -= frameDeltaY;
+
+    // keep remainder, so slow motion is not lost with mouse divider
+    int dx = state.x + remainderX;
+    int dy = state.y + remainderY;
+
+    frameDeltaX = dx / params.mouseDivX;
+    frameDeltaY = dy / params.mouseDivY;
+    remainderX = dx - frameDeltaX * params.mouseDivX;
+    remainderY = dy - frameDeltaY * params.mouseDivY;
+
+    buttonsMask = 0x0F;
 
     if (state.buttons & STAGE_MOUSE_LMASK) {
-        portFADF &= ~1;
+        buttonsMask &= ~1;
     }
 
     if (state.buttons & STAGE_MOUSE_RMASK) {
-        portFADF &= ~2;
+        buttonsMask &= ~2;
     }
 
     if (state.buttons & STAGE_MOUSE_MMASK) {
-        portFADF &= ~3; // middle button works as LMB + RMB
+        buttonsMask &= ~3; // middle button works as LMB + RMB
+    }
+}
+
+void C_Mouse::UpdateState(void) {
+    int phase = (int)(cpuClk < MAX_FRAME_TACTS ? cpuClk : MAX_FRAME_TACTS);
+
+    portFBDF = (uint8_t)(frameStartX + frameDeltaX * phase / MAX_FRAME_TACTS);
+    portFFDF = (uint8_t)(frameStartY - frameDeltaY * phase / MAX_FRAME_TACTS);
+    portFADF = (uint8_t)(wheelCnt << 4) | buttonsMask;
+
+    if (movieState != MOVIE_STATE_NONE) {
+        uint8_t state[3] = { portFBDF, portFFDF, portFADF };
+        Movie_SyncInput(MOVIE_DEVICE_MOUSE, state);
+
+        portFBDF = state[0];
+        portFFDF = state[1];
+        portFADF = state[2];
     }
 }
 
@@ -12,9 +12,19 @@ public:
     static uint8_t portFADF;
     static uint8_t wheelCnt;
 
+    // host mouse is sampled once per frame, motion is spread over the frame by the T-state of the port read
+    static uint8_t frameStartX;
+    static uint8_t frameStartY;
+    static int frameDeltaX;
+    static int frameDeltaY;
+    static int remainderX;
+    static int remainderY;
+    static uint8_t buttonsMask;
+
     void Init(void);
     void Close(void);
 
+    static void OnFrameStart(void);
     static void UpdateState(void);
     static bool InputByteCheckPort(uint16_t port);
     static bool OnInputByte(uint16_t port, uint8_t& retval);
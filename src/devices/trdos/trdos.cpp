@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include "trdos.h"
 #include "../mmanager/mmanager.h"
+#include "state.h"
 
 extern C_MemoryManager dev_mman;
 
@@ -36,6 +37,26 @@ void C_TrDos::Init(void) {
 void C_TrDos::Close(void) {
 }
 
+void C_TrDos::SaveState(C_StateWriter& writer) {
+    writer.WriteBool(trdos);
+    wd1793_save_state(writer);
+}
+
+void C_TrDos::LoadState(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
+    }
+
+    if (reader.ReadBool()) {
+        Enable();
+    } else {
+        Disable();
+    }
+
+    wd1793_load_state(reader);
+}
+
 ptrOnReadByteFunc C_TrDos::ReadByteCheckAddr(uint16_t addr, bool m1) {
     if (m1) {
         if (trdos && addr > 0x3FFF) {
@@ -14,6 +14,8 @@ public:
     static void ReadFile(void);
     void Init(void);
     void Close(void);
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader, unsigned version);
 
     static ptrOnReadByteFunc ReadByteCheckAddr(uint16_t addr, bool m1);
     static uint8_t OnReadByte_3Dxx_M1(uint16_t addr, bool m1);
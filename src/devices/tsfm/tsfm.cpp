@@ -3,6 +3,7 @@
 
 #include "tsfm.h"
 #include "../trdos/trdos.h"
+#include "state.h"
 
 #define CHIP_FLAG_MASK 1
 #define STATUS_FLAG_MASK 2
@@ -63,6 +64,57 @@ void C_TsFm::Init(void) {
 void C_TsFm::Close(void) {
 }
 
+// chips are stored according to the current mode, so state can be loaded only with the same "tsfmmode"
+void C_TsFm::SaveState(C_StateWriter& writer) {
+    writer.WriteByte(mode);
+    writer.WriteByte(pseudoReg);
+    writer.WriteByte(selectedReg);
+    ayChip[0].SaveState(writer);
+
+    if (mode >= TSFM_MODE_TS) {
+        ayChip[1].SaveState(writer);
+
+        if (mode >= TSFM_MODE_TSFM) {
+            ym2203Chip[0].SaveState(writer);
+            ym2203Chip[1].SaveState(writer);
+
+            if (mode >= TSFM_MODE_ZXM) {
+                saa1099Chip.SaveState(writer);
+            }
+        }
+    }
+}
+
+void C_TsFm::LoadState(C_StateReader& reader, unsigned version) {
+    // version 1 had no envelopes and phases of sound chips
+    if (version != 2) {
+        reader.Fail();
+        return;
+    }
+
+    if (reader.ReadByte() != mode) {
+        printf("TS-FM state skipped, because it was saved in different mode\n");
+        return;
+    }
+
+    pseudoReg = reader.ReadByte();
+    selectedReg = reader.ReadByte();
+    ayChip[0].LoadState(reader);
+
+    if (mode >= TSFM_MODE_TS) {
+        ayChip[1].LoadState(reader);
+
+        if (mode >= TSFM_MODE_TSFM) {
+            ym2203Chip[0].LoadState(reader);
+            ym2203Chip[1].LoadState(reader);
+
+            if (mode >= TSFM_MODE_ZXM) {
+                saa1099Chip.LoadState(reader);
+            }
+        }
+    }
+}
+
 bool C_TsFm::InputByteCheckPort(uint16_t port) {
     return ((port & 0b11000000'00000010) == 0b11000000'00000000); // 0xFFFD
 }
@@ -52,6 +52,7 @@ namespace {
 
 void DlgClearScreen(void) {
     uint32_t* s = screen;
+    MarkScreenLines(0, HEIGHT);
 
     for (int i = HEIGHT; i--;) {
         int cl = (i & 1) ? STAGE_MAKERGB(0, 0, 64) : STAGE_MAKERGB(0, 0, 32);
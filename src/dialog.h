@@ -4,6 +4,7 @@
 #include "zemu.h"
 
 bool DlgConfirm(const char* message);
+const char* DlgInputString(const char* message);
 void FileDialog(void);
 void FileDialogInit(void);
 void RunDebugger(void);
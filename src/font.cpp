@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "font.h"
+#include "graphics.h"
 
 C_Font::C_Font(uint8_t* data) {
     pixelsHeight = data[0] + 0x100 * data[1];
@@ -124,12 +125,15 @@ void C_Font::PrintChar(int x, int y, char c) {
         }
     }
 
+    uint32_t* target = GetDrawTarget();
+    MarkDrawnLines(screenY, screenY + letterH);
+
     for (int y = letterH; y--;) {
         for (int x = letterW; x--;) {
             uint32_t c = pixels[(letterY + y) * pixelsWidth + letterX + x];
 
             if (c != colorKey) {
-                screen[(screenY + y) * WIDTH + screenX + x] = c;
+                target[(screenY + y) * WIDTH + screenX + x] = c;
             }
         }
     }
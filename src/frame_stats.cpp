@@ -0,0 +1,248 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <algorithm>
+#include "zemu_env.h"
+#include "frame_stats.h"
+#include "graphics.h"
+#include "font.h"
+#include "overlay.h"
+
+extern C_Font* fixed_font;
+
+#define FRAME_STATS_GRAPH_HEIGHT 64
+#define FRAME_STATS_GRAPH_SCALE 250 // microseconds per pixel
+#define FRAME_STATS_REFRESH_FRAMES 25
+
+bool frameStatsEnabled = false;
+
+static bool frameStatsOverlay = false;
+static DataWriterPtr frameStatsCsvWriter;
+static uint64_t frameStatsLastMark = 0;
+static uint64_t frameStatsCurrent[FRAME_PHASES_COUNT];
+static uint32_t frameStatsHistory[FRAME_PHASES_COUNT][FRAME_STATS_HISTORY];
+static unsigned frameStatsHistoryPos = 0;
+static unsigned frameStatsHistoryCount = 0;
+static unsigned frameStatsNumber = 0;
+static unsigned frameStatsRefreshCounter = 0;
+static uint32_t frameStatsMin[FRAME_PHASES_COUNT];
+static uint32_t frameStatsMedian[FRAME_PHASES_COUNT];
+static uint32_t frameStatsP99[FRAME_PHASES_COUNT];
+
+static const char* frameStatsPhaseNames[FRAME_PHASES_COUNT] = {
+    "cpu",
+    "render",
+    "expand",
+    "osd",
+    "present",
+    "sound",
+    "events",
+    "wait"
+};
+
+static const uint32_t frameStatsPhaseColors[FRAME_PHASES_COUNT] = {
+    STAGE_MAKERGB(0xE0, 0x40, 0x40),
+    STAGE_MAKERGB(0x40, 0xC0, 0x40),
+    STAGE_MAKERGB(0x40, 0x80, 0xE0),
+    STAGE_MAKERGB(0xE0, 0xE0, 0x40),
+    STAGE_MAKERGB(0xE0, 0x40, 0xE0),
+    STAGE_MAKERGB(0x40, 0xE0, 0xE0),
+    STAGE_MAKERGB(0xE0, 0x90, 0x40),
+    STAGE_MAKERGB(0x60, 0x60, 0x60)
+};
+
+static void FrameStats_UpdateEnabled(void) {
+    bool wasEnabled = frameStatsEnabled;
+    frameStatsEnabled = (frameStatsOverlay || frameStatsCsvWriter);
+
+    if (frameStatsEnabled && !wasEnabled) {
+        for (int i = 0; i < FRAME_PHASES_COUNT; i++) {
+            frameStatsCurrent[i] = 0;
+        }
+
+        frameStatsHistoryPos = 0;
+        frameStatsHistoryCount = 0;
+        frameStatsRefreshCounter = 0;
+        frameStatsLastMark = host->timer()->getElapsedMicros();
+    }
+}
+
+static void FrameStats_CalcPercentiles(void) {
+    uint32_t sorted[FRAME_STATS_HISTORY];
+    unsigned count = frameStatsHistoryCount;
+
+    for (int phase = 0; phase < FRAME_PHASES_COUNT; phase++) {
+        if (!count) {
+            frameStatsMin[phase] = 0;
+            frameStatsMedian[phase] = 0;
+            frameStatsP99[phase] = 0;
+            continue;
+        }
+
+        std::copy(frameStatsHistory[phase], frameStatsHistory[phase] + count, sorted);
+        std::sort(sorted, sorted + count);
+
+        frameStatsMin[phase] = sorted[0];
+        frameStatsMedian[phase] = sorted[count / 2];
+        frameStatsP99[phase] = sorted[std::min(count - 1, (count * 99) / 100)];
+    }
+}
+
+void FrameStats_Init(const char* csvFileName) {
+    if (csvFileName && *csvFileName) {
+        try {
+            frameStatsCsvWriter = host->storage()->path(csvFileName)->dataWriter();
+            frameStatsCsvWriter->writeFmt("frame");
+
+            for (int i = 0; i < FRAME_PHASES_COUNT; i++) {
+                frameStatsCsvWriter->writeFmt(",%s_us", frameStatsPhaseNames[i]);
+            }
+
+            frameStatsCsvWriter->writeFmt("\n");
+        } catch (StorageException& e) {
+            printf("Failed to create frame stats file: %s\n", e.what());
+            frameStatsCsvWriter.reset();
+        }
+    }
+
+    FrameStats_UpdateEnabled();
+}
+
+void FrameStats_Close(void) {
+    frameStatsCsvWriter.reset();
+    frameStatsOverlay = false;
+    FrameStats_UpdateEnabled();
+}
+
+void FrameStats_ToggleOverlay(void) {
+    frameStatsOverlay = !frameStatsOverlay;
+    FrameStats_UpdateEnabled();
+}
+
+void FrameStats_Mark(int phase) {
+    uint64_t now = host->timer()->getElapsedMicros();
+
+    frameStatsCurrent[phase] += now - frameStatsLastMark;
+    frameStatsLastMark = now;
+}
+
+void FrameStats_Move(int fromPhase, int toPhase, uint64_t micros) {
+    micros = std::min(micros, frameStatsCurrent[fromPhase]);
+
+    frameStatsCurrent[fromPhase] -= micros;
+    frameStatsCurrent[toPhase] += micros;
+}
+
+void FrameStats_EndFrame(bool isEmulated) {
+    if (!isEmulated) {
+        // paused, nothing to account
+        for (int i = 0; i < FRAME_PHASES_COUNT; i++) {
+            frameStatsCurrent[i] = 0;
+        }
+
+        return;
+    }
+
+    for (int i = 0; i < FRAME_PHASES_COUNT; i++) {
+        frameStatsHistory[i][frameStatsHistoryPos] = (uint32_t)frameStatsCurrent[i];
+    }
+
+    if (frameStatsCsvWriter) {
+        frameStatsCsvWriter->writeFmt("%u", frameStatsNumber);
+
+        for (int i = 0; i < FRAME_PHASES_COUNT; i++) {
+            frameStatsCsvWriter->writeFmt(",%u", (unsigned)frameStatsCurrent[i]);
+        }
+
+        frameStatsCsvWriter->writeFmt("\n");
+    }
+
+    for (int i = 0; i < FRAME_PHASES_COUNT; i++) {
+        frameStatsCurrent[i] = 0;
+    }
+
+    frameStatsHistoryPos = (frameStatsHistoryPos + 1) % FRAME_STATS_HISTORY;
+    frameStatsHistoryCount = std::min(frameStatsHistoryCount + 1, (unsigned)FRAME_STATS_HISTORY);
+    frameStatsNumber++;
+}
+
+static void FrameStats_Paint(void) {
+    char buf[0x100];
+
+    // stacked bars, newest frame on the right, one pixel per frame
+    int graphBottom = HEIGHT - 1;
+    int graphTop = graphBottom - FRAME_STATS_GRAPH_HEIGHT;
+    int frameBudgetY = graphBottom - (FRAME_WAIT_MS * 1000) / FRAME_STATS_GRAPH_SCALE;
+
+    Bar(0, graphTop, WIDTH - 1, graphBottom, STAGE_MAKERGB(0, 0, 0));
+
+    for (unsigned i = 0; i < frameStatsHistoryCount && i < WIDTH; i++) {
+        unsigned pos = (frameStatsHistoryPos + FRAME_STATS_HISTORY - 1 - i) % FRAME_STATS_HISTORY;
+        int x = WIDTH - 1 - i;
+        int y = graphBottom;
+
+        for (int phase = 0; phase < FRAME_PHASES_COUNT && y > graphTop; phase++) {
+            int h = frameStatsHistory[phase][pos] / FRAME_STATS_GRAPH_SCALE;
+
+            if (h <= 0) {
+                continue;
+            }
+
+            Bar(x, y, x, std::max(graphTop, y - h + 1), frameStatsPhaseColors[phase]);
+            y -= h;
+        }
+    }
+
+    Bar(0, frameBudgetY, WIDTH - 1, frameBudgetY, STAGE_MAKERGB(0xFF, 0xFF, 0xFF));
+
+    int h = fixed_font->Height();
+    int y = graphTop - h * (FRAME_PHASES_COUNT + 2) - 2;
+
+    Bar(0, y, WIDTH - 1, graphTop - 1, STAGE_MAKERGB(0, 0, 0));
+    fixed_font->PrintString(12, y, "phase          min    med    p99");
+
+    for (int phase = 0; phase < FRAME_PHASES_COUNT; phase++) {
+        y += h;
+
+        Bar(4, y + 1, 7, y + h - 2, frameStatsPhaseColors[phase]);
+        sprintf(
+            buf,
+            "%-12s %6u %6u %6u",
+            frameStatsPhaseNames[phase],
+            (unsigned)frameStatsMin[phase],
+            (unsigned)frameStatsMedian[phase],
+            (unsigned)frameStatsP99[phase]
+        );
+
+        fixed_font->PrintString(12, y, buf);
+    }
+
+    StageFrameCounters counters;
+    host->stage()->getFrameCounters(&counters);
+    y += h;
+
+    sprintf(
+        buf,
+        "frames sent %llu shown %llu dropped %llu",
+        (unsigned long long)counters.sent,
+        (unsigned long long)counters.presented,
+        (unsigned long long)counters.dropped
+    );
+
+    fixed_font->PrintString(12, y, buf);
+}
+
+// graph is moved every frame, so it is drawn again every frame
+void FrameStats_Draw(void) {
+    if (!frameStatsOverlay) {
+        Overlay_Hide(OVERLAY_ITEM_FRAME_STATS);
+        return;
+    }
+
+    if (frameStatsRefreshCounter-- == 0) {
+        frameStatsRefreshCounter = FRAME_STATS_REFRESH_FRAMES;
+        FrameStats_CalcPercentiles();
+    }
+
+    Overlay_Custom(OVERLAY_ITEM_FRAME_STATS, FrameStats_Paint, true);
+}
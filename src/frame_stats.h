@@ -0,0 +1,31 @@
+#ifndef _FRAME_STATS_H_INCLUDED_
+#define _FRAME_STATS_H_INCLUDED_
+
+#include "zemu.h"
+
+#define FRAME_PHASE_CPU 0
+#define FRAME_PHASE_RENDER 1
+#define FRAME_PHASE_EXPAND 2 // palette indices to pixels, with antiflicker
+#define FRAME_PHASE_OSD 3
+#define FRAME_PHASE_PRESENT 4
+#define FRAME_PHASE_SOUND 5
+#define FRAME_PHASE_EVENTS 6
+#define FRAME_PHASE_WAIT 7
+#define FRAME_PHASES_COUNT 8
+
+#define FRAME_STATS_HISTORY 256
+
+// Checked at every call site, so instrumentation costs a single branch when disabled.
+#define FRAME_STATS_MARK(phase) do { if (frameStatsEnabled) { FrameStats_Mark(phase); } } while (0)
+
+extern bool frameStatsEnabled;
+
+void FrameStats_Init(const char* csvFileName);
+void FrameStats_Close(void);
+void FrameStats_ToggleOverlay(void);
+void FrameStats_Mark(int phase);
+void FrameStats_Move(int fromPhase, int toPhase, uint64_t micros);
+void FrameStats_EndFrame(bool isEmulated);
+void FrameStats_Draw(void);
+
+#endif
@@ -3,8 +3,39 @@
 
 #include "graphics.h"
 
+static uint32_t* drawTarget = nullptr;
+static int drawnFromLine = HEIGHT;
+static int drawnToLine = 0;
+
+void SetDrawTarget(uint32_t* pixels) {
+    drawTarget = pixels;
+    drawnFromLine = HEIGHT;
+    drawnToLine = 0;
+}
+
+uint32_t* GetDrawTarget(void) {
+    return (drawTarget ? drawTarget : screen);
+}
+
+void MarkDrawnLines(int fromLine, int toLine) {
+    drawnFromLine = std::max(0, std::min(drawnFromLine, fromLine));
+    drawnToLine = std::min(HEIGHT, std::max(drawnToLine, toLine));
+
+    if (!drawTarget) {
+        MarkScreenLines(fromLine, toLine);
+    }
+}
+
+bool GetDrawnLines(int* fromLine, int* toLine) {
+    *fromLine = drawnFromLine;
+    *toLine = drawnToLine;
+    return (drawnFromLine < drawnToLine);
+}
+
 void OutputGimpImage(int x, int y, s_GimpImage* img) {
     uint8_t* o = img->data;
+    uint32_t* target = GetDrawTarget();
+    MarkDrawnLines(y, y + (int)img->height);
 
     if (img->bpp == 3) {
         for (int i = 0, height = img->height; i < height; i++) {
@@ -12,7 +43,7 @@ void OutputGimpImage(int x, int y, s_GimpImage* img) {
                 int r = *(o++);
                 int g = *(o++);
                 int b = *(o++);
-                screen[(y + i) * WIDTH + x + j] = STAGE_MAKERGB(r, g, b);
+                target[(y + i) * WIDTH + x + j] = STAGE_MAKERGB(r, g, b);
             }
         }
     } else if (img->bpp == 4) {
@@ -24,7 +55,7 @@ void OutputGimpImage(int x, int y, s_GimpImage* img) {
                 int a = *(o++);
 
                 if (a > 128) {
-                    screen[(y + i) * WIDTH + x + j] = STAGE_MAKERGB(r, g, b);
+                    target[(y + i) * WIDTH + x + j] = STAGE_MAKERGB(r, g, b);
                 }
             }
         }
@@ -45,10 +76,12 @@ void Bar(int x1, int y1, int x2, int y2, int c) {
     sy = std::max(0, sy);
     ex = std::min(WIDTH - 1, ex);
     ey = std::min(HEIGHT - 1, ey);
+    uint32_t* target = GetDrawTarget();
+    MarkDrawnLines(sy, ey + 1);
 
     for (int y = sy; y <= ey; y++) {
         for (int x = sx; x <= ex; x++) {
-            screen[y * WIDTH + x] = c;
+            target[y * WIDTH + x] = c;
         }
     }
 }
@@ -11,6 +11,13 @@ struct s_GimpImage {
     unsigned char data[];
 };
 
+// Drawing functions (and C_Font) draw into the screen, or into another WIDTH x HEIGHT buffer (see overlay.h).
+// Lines touched since SetDrawTarget() are collected, so the caller knows what was changed.
+void SetDrawTarget(uint32_t* pixels); // nullptr - screen
+uint32_t* GetDrawTarget(void);
+void MarkDrawnLines(int fromLine, int toLine);
+bool GetDrawnLines(int* fromLine, int* toLine); // false if nothing was drawn
+
 void OutputGimpImage(int x, int y, s_GimpImage* img);
 void Bar(int x1, int y1, int x2, int y2, int c);
 
@@ -25,6 +25,9 @@
     #endif
 #endif
 
+// Never produced by STAGE_MAKERGB, so can mark transparent pixels of the overlay
+#define STAGE_OVERLAY_TRANSPARENT 0xFFFFFFFF
+
 #define STAGE_MOUSE_LMASK SDL_BUTTON_LMASK
 #define STAGE_MOUSE_RMASK SDL_BUTTON_RMASK
 #define STAGE_MOUSE_MMASK SDL_BUTTON_MMASK
@@ -33,13 +36,19 @@ enum StageSoundDriver {
     STAGE_SOUND_DRIVER_NONE,
     STAGE_SOUND_DRIVER_GENERIC,
     STAGE_SOUND_DRIVER_WIN32,
-    STAGE_SOUND_DRIVER_OSS
+    STAGE_SOUND_DRIVER_OSS,
+    STAGE_SOUND_DRIVER_WAV
 };
 
 enum StageRenderMode {
     STAGE_RENDER_MODE_1X,
     STAGE_RENDER_MODE_2X,
-    STAGE_RENDER_MODE_2X_SCANLINES
+    STAGE_RENDER_MODE_2X_SCANLINES,
+    STAGE_RENDER_MODE_3X,
+    STAGE_RENDER_MODE_3X_SCANLINES,
+    STAGE_RENDER_MODE_4X,
+    STAGE_RENDER_MODE_4X_SCANLINES,
+    STAGE_RENDER_MODE_2X_EPX // edge-aware Scale2x
 };
 
 enum StageHint {
@@ -49,6 +58,7 @@ enum StageHint {
 struct StageConfig {
     int hints = 0; // Implementation-specific
     std::string title;
+    bool headless = false;
 
     bool joystickEnabled = true;
     int joystickAxisThreshold = 3200;
@@ -62,6 +72,7 @@ struct StageConfig {
     bool soundEnabled = true;
     int soundFreq = 44100;
     int soundParams[3] = {0}; // Implementation-specific
+    std::string soundFileName; // For STAGE_SOUND_DRIVER_WAV
 
     #ifdef _WIN32
         WORD windowsIconResource = 0;
@@ -92,6 +103,12 @@ struct StageEvent {
     int mouseWheelDirection;
 };
 
+struct StageFrameCounters {
+    uint64_t sent = 0; // passed to renderFrame()
+    uint64_t presented = 0;
+    uint64_t dropped = 0; // replaced by a newer frame before it was presented
+};
+
 struct StageMouseState {
     int x;
     int y;
@@ -119,7 +136,19 @@ public:
     virtual bool pollEvent(StageEvent* into) = 0;
     virtual void getRelativeMouseState(StageMouseState* into) = 0;
 
-    virtual void renderFrame(uint32_t* pixels, int width, int height) = 0; // In ARGB format
+    // Frame buffer to draw the next frame into (ARGB), it already has pixels of the previously sent frame.
+    virtual uint32_t* getFrameBuffer(int width, int height) = 0;
+
+    // Sends the frame buffer, never waits for the presentation. Only lines with dirtyLines[y] set have changed
+    // since the previous frame (nullptr means all lines). Returns frame buffer for the next frame,
+    // the sent one must not be used after that.
+    virtual uint32_t* renderFrame(const bool* dirtyLines) = 0;
+
+    // Overlay (OSD) of the same size as the frame, is drawn over it on presentation, so frames stay untouched.
+    // Only lines with dirtyLines[y] set are taken from the pixels, both can be reused after the call.
+    virtual void renderOverlay(const uint32_t* pixels, const bool* dirtyLines) = 0;
+
+    virtual void getFrameCounters(StageFrameCounters* into) = 0;
     virtual void renderSound(uint32_t* buffer, int samples) = 0; // 2 x int16_t (stereo) for each sample
 
 private:
@@ -9,3 +9,16 @@ std::string Path::extensionLc() {
     boost::algorithm::to_lower(ext);
     return ext;
 }
+
+// Reads whole file with one readBlock() call, so callers can parse it from memory.
+void Path::readAll(std::vector<uint8_t>& into) {
+    if (!isFile()) {
+        throw StorageException(std::string("File \"") + string() + "\" not found");
+    }
+
+    into.resize((size_t)fileSize());
+
+    if (!into.empty() && dataReader()->readBlock(into.data(), into.size()) != into.size()) {
+        throw StorageException(std::string("Failed to read \"") + string() + "\"");
+    }
+}
@@ -78,9 +78,12 @@ public:
     virtual bool remove() = 0;
     virtual bool removeAll() = 0;
     virtual bool createDirectories() = 0;
+    virtual bool rename(const PathPtr& into) = 0; // replaces existing file
     virtual DataWriterPtr dataWriter() = 0;
+    virtual DataWriterPtr dataAppender() = 0;
 
     std::string extensionLc();
+    void readAll(std::vector<uint8_t>& into);
 
 private:
 
@@ -124,6 +127,7 @@ public:
     virtual bool writeBlock(void* buffer, uintmax_t size) = 0;
     virtual uintmax_t getPosition() = 0;
     virtual void setPosition(uintmax_t position) = 0;
+    virtual bool flush() = 0;
 
 private:
 
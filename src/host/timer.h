@@ -10,6 +10,7 @@ public:
     virtual ~Timer() {}
 
     virtual uint32_t getElapsedMillis() = 0;
+    virtual uint64_t getElapsedMicros() = 0;
     virtual void wait(uint32_t millis) = 0;
 
 private:
@@ -0,0 +1,73 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <stdexcept>
+#include "ZEmuConfig.h"
+#include "sound_driver_wav.h"
+
+static void soundDriverWavPutWord(uint8_t* into, uint16_t value) {
+    into[0] = (uint8_t)value;
+    into[1] = (uint8_t)(value >> 8);
+}
+
+static void soundDriverWavPutDword(uint8_t* into, uint32_t value) {
+    soundDriverWavPutWord(into, (uint16_t)value);
+    soundDriverWavPutWord(into + 2, (uint16_t)(value >> 16));
+}
+
+SoundDriverWav::SoundDriverWav(int soundFreq, const std::string& fileName) : soundFreq(soundFreq) {
+    if (fileName.empty()) {
+        throw std::logic_error("\"fileName\" should not be empty");
+    }
+
+    wavFile = fopen(fileName.c_str(), "wb");
+
+    if (!wavFile) {
+        throw std::runtime_error(std::string("Unable to open \"") + fileName + "\" for writing");
+    }
+
+    writeHeader(); // placeholder, sizes are written in destructor
+}
+
+SoundDriverWav::~SoundDriverWav() {
+    fseek(wavFile, 0, SEEK_SET);
+    writeHeader();
+    fclose(wavFile);
+}
+
+void SoundDriverWav::writeHeader() {
+    uint8_t header[44];
+
+    soundDriverWavPutDword(header, 0x46464952); // "RIFF"
+    soundDriverWavPutDword(header + 4, dataSize + 36);
+    soundDriverWavPutDword(header + 8, 0x45564157); // "WAVE"
+    soundDriverWavPutDword(header + 12, 0x20746D66); // "fmt "
+    soundDriverWavPutDword(header + 16, 16);
+    soundDriverWavPutWord(header + 20, 1); // PCM
+    soundDriverWavPutWord(header + 22, 2); // stereo
+    soundDriverWavPutDword(header + 24, soundFreq);
+    soundDriverWavPutDword(header + 28, soundFreq * 4);
+    soundDriverWavPutWord(header + 32, 4);
+    soundDriverWavPutWord(header + 34, 16);
+    soundDriverWavPutDword(header + 36, 0x61746164); // "data"
+    soundDriverWavPutDword(header + 40, dataSize);
+
+    fwrite(header, sizeof(header), 1, wavFile);
+}
+
+void SoundDriverWav::render(uint32_t* buffer, int samples) {
+    // samples are already in native 2 x int16_t format, WAV is little-endian
+    #ifdef ZEMU_BIG_ENDIAN
+        uint16_t* values = (uint16_t*)buffer;
+
+        for (int i = samples * 2; i--;) {
+            uint8_t value[2];
+            soundDriverWavPutWord(value, *(values++));
+            fwrite(value, sizeof(value), 1, wavFile);
+        }
+    #else
+        fwrite(buffer, sizeof(uint32_t), samples, wavFile);
+    #endif
+
+    dataSize += samples * sizeof(uint32_t);
+}
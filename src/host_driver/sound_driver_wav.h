@@ -0,0 +1,25 @@
+#ifndef HOST_DRIVER__SOUND_DRIVER_WAV_H__INCLUDED
+#define HOST_DRIVER__SOUND_DRIVER_WAV_H__INCLUDED
+
+#include <cstdio>
+#include <string>
+#include "sound_driver.h"
+
+class SoundDriverWav : public SoundDriver {
+public:
+
+    SoundDriverWav(int soundFreq, const std::string& fileName);
+    ~SoundDriverWav();
+
+    void render(uint32_t* buffer, int samples);
+
+private:
+
+    FILE* wavFile;
+    int soundFreq;
+    uint32_t dataSize = 0;
+
+    void writeHeader();
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include "config_impl.h"
 #include "timer_impl.h"
 #include "stage_impl.h"
+#include "stage_headless.h"
 
 HostImpl::HostImpl(int argc, char** argv, const std::string& applicationId) : applicationId(applicationId) {
     executablePathStr = std::string(argc ? argv[0] : "");
@@ -68,7 +69,11 @@ Stage* HostImpl::stage() {
             throw std::logic_error("setStageConfig() must be called before using stage()");
         }
 
-        stageInstance.reset(new StageImpl(*stageConfigInstance, logger()));
+        if (stageConfigInstance->headless) {
+            stageInstance.reset(new StageHeadless(*stageConfigInstance, logger()));
+        } else {
+            stageInstance.reset(new StageImpl(*stageConfigInstance, logger()));
+        }
     }
 
     return stageInstance.get();
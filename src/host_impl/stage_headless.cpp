@@ -0,0 +1,97 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "stage_headless.h"
+#include "host_driver/sound_driver_wav.h"
+
+StageHeadless::StageHeadless(const StageConfig& stageConfig, Logger* logger) {
+    renderMode = stageConfig.renderMode;
+
+    if (stageConfig.soundDriver == STAGE_SOUND_DRIVER_WAV) {
+        soundEnabled = stageConfig.soundEnabled;
+        soundDriver.reset(new SoundDriverWav(stageConfig.soundFreq, stageConfig.soundFileName));
+    }
+}
+
+StageHeadless::~StageHeadless() {
+    if (frameBuffer) {
+        delete[] frameBuffer;
+    }
+}
+
+StageRenderMode StageHeadless::getRenderMode() {
+    return renderMode;
+}
+
+void StageHeadless::setRenderMode(StageRenderMode renderMode) { //-V688
+    this->renderMode = renderMode;
+}
+
+bool StageHeadless::isKeyRepeat() {
+    return keyRepeat;
+}
+
+void StageHeadless::setKeyRepeat(bool keyRepeat) { //-V688
+    this->keyRepeat = keyRepeat;
+}
+
+bool StageHeadless::isFullscreen() {
+    return fullscreen;
+}
+
+void StageHeadless::setFullscreen(bool fullscreen) { //-V688
+    this->fullscreen = fullscreen;
+}
+
+bool StageHeadless::isSoundEnabled() {
+    return soundEnabled;
+}
+
+void StageHeadless::setSoundEnabled(bool soundEnabled) { //-V688
+    if (soundDriver) {
+        this->soundEnabled = soundEnabled;
+    }
+}
+
+bool StageHeadless::pollEvent(StageEvent* into) {
+    return false;
+}
+
+void StageHeadless::getRelativeMouseState(StageMouseState* into) {
+    into->x = 0;
+    into->y = 0;
+    into->buttons = 0;
+}
+
+uint32_t* StageHeadless::getFrameBuffer(int width, int height) {
+    if (frameBufferSize != width * height) {
+        if (frameBuffer) {
+            delete[] frameBuffer;
+        }
+
+        frameBufferSize = width * height;
+        frameBuffer = new uint32_t[frameBufferSize]();
+    }
+
+    return frameBuffer;
+}
+
+// there is nothing to present, so the same buffer is used for every frame
+uint32_t* StageHeadless::renderFrame(const bool* dirtyLines) {
+    frameCounters.sent++;
+    frameCounters.dropped++;
+    return frameBuffer;
+}
+
+void StageHeadless::renderOverlay(const uint32_t* pixels, const bool* dirtyLines) {
+}
+
+void StageHeadless::getFrameCounters(StageFrameCounters* into) {
+    *into = frameCounters;
+}
+
+void StageHeadless::renderSound(uint32_t* buffer, int samples) {
+    if (soundEnabled && soundDriver) {
+        soundDriver->render(buffer, samples);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef HOST_IMPL__STAGE_HEADLESS_H__INCLUDED
+#define HOST_IMPL__STAGE_HEADLESS_H__INCLUDED
+
+#include <memory>
+#include "host/stage.h"
+#include "host/logger.h"
+#include "host_driver/sound_driver.h"
+
+// Stage without window and input, for batch runs on display-less machines.
+// Frames are dropped, sound goes to STAGE_SOUND_DRIVER_WAV if it is selected.
+class StageHeadless : public Stage {
+public:
+    StageHeadless(const StageConfig& stageConfig, Logger* logger);
+    virtual ~StageHeadless();
+
+    StageRenderMode getRenderMode();
+    void setRenderMode(StageRenderMode mode);
+
+    bool isKeyRepeat();
+    void setKeyRepeat(bool keyRepeat);
+
+    bool isFullscreen();
+    void setFullscreen(bool fullscreen);
+
+    bool isSoundEnabled();
+    void setSoundEnabled(bool soundEnabled);
+
+    bool pollEvent(StageEvent* into);
+    void getRelativeMouseState(StageMouseState* into);
+
+    uint32_t* getFrameBuffer(int width, int height);
+    uint32_t* renderFrame(const bool* dirtyLines);
+    void renderOverlay(const uint32_t* pixels, const bool* dirtyLines);
+    void getFrameCounters(StageFrameCounters* into);
+    void renderSound(uint32_t* buffer, int samples);
+
+private:
+
+    StageRenderMode renderMode;
+    bool keyRepeat = false;
+    bool fullscreen = false;
+    bool soundEnabled = false;
+    uint32_t* frameBuffer = nullptr;
+    int frameBufferSize = 0;
+    StageFrameCounters frameCounters;
+
+    std::unique_ptr<SoundDriver> soundDriver;
+};
+
+#endif
@@ -3,8 +3,11 @@
 
 #include <string>
 #include <stdexcept>
+#include <thread>
+#include <algorithm>
 #include "stage_impl.h"
 #include "host_driver/sound_driver_generic.h"
+#include "host_driver/sound_driver_wav.h"
 
 #ifdef __unix__
     #include "host_driver/sound_driver_oss.h"
@@ -15,11 +18,22 @@
     #include "host_driver/sound_driver_win32.h"
 #endif
 
+#define STAGE_FRAME_INDEX_MASK 3
+#define STAGE_FRAME_FRESH 4 // ready buffer was not taken by the render thread yet
+
+#define STAGE_SCALER_MAX_WORKERS 3
+#define STAGE_SCALER_STRIPE_LINES 32 // source lines, smaller updates are scaled by the render thread alone
+
 int stageImplRenderThreadFunction(void* data) {
     static_cast<StageImpl*>(data)->renderThreadLoop();
     return 0;
 }
 
+int stageImplScalerThreadFunction(void* data) {
+    static_cast<StageImpl*>(data)->scalerThreadLoop();
+    return 0;
+}
+
 StageImpl::StageImpl(const StageConfig& stageConfig, Logger* logger) {
     if (stageConfig.desiredFrameWidth <= 0 || stageConfig.desiredFrameHeight <= 0) {
         throw std::logic_error(std::string("\"desiredFrameWidth\" and \"desiredFrameHeight\" must be greater than zero"));
@@ -60,12 +74,23 @@ StageImpl::StageImpl(const StageConfig& stageConfig, Logger* logger) {
         stageTitle = stageConfig.title;
     #endif
 
+    readyFrameState = 1;
+    presentedFrames = 0;
+    isRepaintRequired = true;
+    isOverlayChanged = false;
     renderThreadPixelsReadySem = SDL_CreateSemaphore(0);
 
     if (!renderThreadPixelsReadySem) {
         throw std::runtime_error(std::string("SDL_CreateSemaphore() failed: ") + SDL_GetError());
     }
 
+    overlayMutex = SDL_CreateMutex();
+
+    if (!overlayMutex) {
+        throw std::runtime_error(std::string("SDL_CreateMutex() failed: ") + SDL_GetError());
+    }
+
+    startScalerPool();
     refreshVideoSubsystem();
 
     #ifdef USE_SDL1
@@ -110,6 +135,11 @@ StageImpl::StageImpl(const StageConfig& stageConfig, Logger* logger) {
                 break;
         #endif
 
+        case STAGE_SOUND_DRIVER_WAV:
+            soundEnabled = stageConfig.soundEnabled;
+            soundDriver.reset(new SoundDriverWav(stageConfig.soundFreq, stageConfig.soundFileName));
+            break;
+
         default:
             soundEnabled = false;
             break;
@@ -185,16 +215,23 @@ StageImpl::~StageImpl() {
         SDL_DestroySemaphore(renderThreadPixelsReadySem);
     }
 
-    if (renderThreadPixels) {
-        delete[] renderThreadPixels;
-    }
+    stopScalerPool();
+    freeFrameBuffers();
 
-    if (nativeSurface) {
-        setFullscreen(false);
-        SDL_FreeSurface(nativeSurface);
+    if (overlayMutex) {
+        SDL_DestroyMutex(overlayMutex);
     }
 
-    #ifndef USE_SDL1
+    #ifdef USE_SDL1
+        if (nativeSurface) {
+            setFullscreen(false);
+            SDL_FreeSurface(nativeSurface);
+        }
+    #else
+        if (nativeWindow) {
+            setFullscreen(false);
+        }
+
         if (nativeTexture) {
             SDL_DestroyTexture(nativeTexture);
         }
@@ -227,10 +264,11 @@ void StageImpl::setRenderMode(StageRenderMode renderMode) { //-V688
     StageRenderMode prevRenderMode = this->renderMode;
     this->renderMode = renderMode;
 
-    if ((prevRenderMode == STAGE_RENDER_MODE_1X && renderMode != STAGE_RENDER_MODE_1X)
-        || (prevRenderMode != STAGE_RENDER_MODE_1X && renderMode == STAGE_RENDER_MODE_1X)
-    ) {
+    if (getStageScaler(prevRenderMode).scale != getStageScaler(renderMode).scale) {
         refreshVideoSubsystem();
+    } else {
+        // the same window, but every line looks different
+        isRepaintRequired = true;
     }
 }
 
@@ -444,6 +482,11 @@ bool StageImpl::pollEvent(StageEvent* into) {
                     SDL_SetRelativeMouseMode(SDL_FALSE);
                 }
 
+                // unchanged frames are not sent, so render thread presents the last one again
+                if (nativeEvent.window.event == SDL_WINDOWEVENT_EXPOSED && isRenderThreadActive) {
+                    SDL_SemPost(renderThreadPixelsReadySem);
+                }
+
                 break;
         #endif
     }
@@ -455,18 +498,79 @@ void StageImpl::getRelativeMouseState(StageMouseState* into) {
     into->buttons = SDL_GetRelativeMouseState(&into->x, &into->y);
 }
 
-void StageImpl::renderFrame(uint32_t* pixels, int width, int height) {
-    if (!isRenderThreadActive || !isRenderThreadPixelsConsumed || SDL_SemValue(renderThreadPixelsReadySem)) {
-        return;
+uint32_t* StageImpl::getFrameBuffer(int width, int height) {
+    if (lastFrameWidth != width || lastFrameHeight != height || !frameBuffers[0]) {
+        lastFrameWidth = width;
+        lastFrameHeight = height;
+        refreshVideoSubsystem();
     }
 
-    if (lastFrameWidth != width || lastFrameHeight != height) {
-        refreshVideoSubsystem();
+    return frameBuffers[backFrameIndex];
+}
+
+uint32_t* StageImpl::renderFrame(const bool* dirtyLines) {
+    int width = lastFrameWidth;
+    uint32_t frameNumber = (uint32_t)(++frameCounters.sent);
+
+    for (int y = 0; y < lastFrameHeight; y++) {
+        if (!dirtyLines || dirtyLines[y]) {
+            lineFrameNumbers[y].store(frameNumber, std::memory_order_relaxed);
+        }
+    }
+
+    int sentIndex = backFrameIndex;
+    frameBufferNumbers[sentIndex] = frameNumber;
+
+    int prevState = readyFrameState.exchange(sentIndex | STAGE_FRAME_FRESH);
+    backFrameIndex = prevState & STAGE_FRAME_INDEX_MASK;
+
+    if (prevState & STAGE_FRAME_FRESH) {
+        frameCounters.dropped++;
+    }
+
+    // New back buffer has an older frame, lines changed since then are taken from the sent one.
+    // Usually these are only few lines of the last two frames.
+    uint32_t* back = frameBuffers[backFrameIndex];
+    uint32_t* sent = frameBuffers[sentIndex];
+    uint32_t backFrameNumber = frameBufferNumbers[backFrameIndex];
+
+    for (int y = 0; y < lastFrameHeight; y++) {
+        if (lineFrameNumbers[y].load(std::memory_order_relaxed) > backFrameNumber) {
+            memcpy((void*)(back + y * width), (void*)(sent + y * width), width * sizeof(uint32_t));
+        }
+    }
+
+    frameBufferNumbers[backFrameIndex] = frameNumber;
+
+    if (isRenderThreadActive) {
+        SDL_SemPost(renderThreadPixelsReadySem);
     }
 
-    isRenderThreadPixelsConsumed = false;
-    memcpy((void*)renderThreadPixels, (void*)pixels, width * height * sizeof(uint32_t));
-    SDL_SemPost(renderThreadPixelsReadySem);
+    return back;
+}
+
+void StageImpl::renderOverlay(const uint32_t* pixels, const bool* dirtyLines) {
+    int width = frameBuffersWidth;
+    SDL_LockMutex(overlayMutex);
+
+    for (int y = 0; y < frameBuffersHeight; y++) {
+        if (dirtyLines[y]) {
+            memcpy((void*)(overlayPixels + y * width), (void*)(pixels + y * width), width * sizeof(uint32_t));
+            overlayChangedLines[y] = true;
+            isOverlayChanged = true;
+        }
+    }
+
+    SDL_UnlockMutex(overlayMutex);
+
+    if (isRenderThreadActive) {
+        SDL_SemPost(renderThreadPixelsReadySem);
+    }
+}
+
+void StageImpl::getFrameCounters(StageFrameCounters* into) {
+    *into = frameCounters;
+    into->presented = presentedFrames;
 }
 
 void StageImpl::renderSound(uint32_t* buffer, int samples) {
@@ -520,18 +624,13 @@ void StageImpl::refreshVideoSubsystem() {
         SDL_WaitThread(renderThread, nullptr);
     }
 
-    if (renderThreadPixels) {
-        delete[] renderThreadPixels;
-        renderThreadPixels = nullptr;
+    if (frameBuffersWidth != lastFrameWidth || frameBuffersHeight != lastFrameHeight) {
+        allocFrameBuffers();
     }
 
-    int width = lastFrameWidth;
-    int height = lastFrameHeight;
-
-    if (renderMode != STAGE_RENDER_MODE_1X) {
-        width *= 2;
-        height *= 2;
-    }
+    int scale = getStageScaler(renderMode).scale;
+    int width = lastFrameWidth * scale;
+    int height = lastFrameHeight * scale;
 
     #ifdef USE_SDL1
         if (nativeSurface) {
@@ -554,10 +653,6 @@ void StageImpl::refreshVideoSubsystem() {
             throw std::runtime_error(std::string("SDL_SetVideoMode() failed: ") + SDL_GetError());
         }
     #else
-        if (nativeSurface) {
-            SDL_FreeSurface(nativeSurface);
-        }
-
         if (nativeTexture) {
             SDL_DestroyTexture(nativeTexture);
         }
@@ -594,18 +689,13 @@ void StageImpl::refreshVideoSubsystem() {
         if (!nativeTexture) {
             throw std::runtime_error(std::string("SDL_CreateTexture() failed: ") + SDL_GetError());
         }
-
-        nativeSurface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
-
-        if (!nativeSurface) {
-            throw std::runtime_error(std::string("SDL_CreateRGBSurface() failed: ") + SDL_GetError());
-        }
     #endif
 
+    // new surface is empty
+    isRepaintRequired = true;
+
     if (wasRenderThreadActive) {
-        renderThreadPixels = new uint32_t[lastFrameWidth * lastFrameHeight];
         isRenderThreadActive = true;
-        isRenderThreadPixelsConsumed = true;
 
         #ifdef USE_SDL1
             renderThread = SDL_CreateThread(stageImplRenderThreadFunction, (void*)this);
@@ -619,31 +709,219 @@ void StageImpl::refreshVideoSubsystem() {
     }
 }
 
+// called while the render thread is stopped, all lines of the next frame are taken from the sent buffer
+void StageImpl::allocFrameBuffers() {
+    freeFrameBuffers();
+
+    frameBuffersWidth = lastFrameWidth;
+    frameBuffersHeight = lastFrameHeight;
+
+    for (int i = 0; i < 3; i++) {
+        frameBuffers[i] = new uint32_t[frameBuffersWidth * frameBuffersHeight]();
+        frameBufferNumbers[i] = 0;
+    }
+
+    lineFrameNumbers = new std::atomic<uint32_t>[frameBuffersHeight];
+
+    for (int y = 0; y < frameBuffersHeight; y++) {
+        lineFrameNumbers[y] = 0;
+    }
+
+    frontFrameIndex = 0;
+    readyFrameState = 1;
+    backFrameIndex = 2;
+    presentedFrameNumber = 0;
+
+    int size = frameBuffersWidth * frameBuffersHeight;
+    overlayPixels = new uint32_t[size];
+    renderThreadOverlay = new uint32_t[size];
+    composedPixels = new uint32_t[size];
+    overlayChangedLines = new bool[frameBuffersHeight]();
+    renderThreadOverlayLines = new bool[frameBuffersHeight]();
+    renderThreadOverlayChangedLines = new bool[frameBuffersHeight]();
+    renderThreadOverlayLinesCount = 0;
+    isOverlayChanged = false;
+
+    std::fill(overlayPixels, overlayPixels + size, STAGE_OVERLAY_TRANSPARENT);
+    std::fill(renderThreadOverlay, renderThreadOverlay + size, STAGE_OVERLAY_TRANSPARENT);
+}
+
+void StageImpl::freeFrameBuffers() {
+    for (int i = 0; i < 3; i++) {
+        if (frameBuffers[i]) {
+            delete[] frameBuffers[i];
+            frameBuffers[i] = nullptr;
+        }
+    }
+
+    if (lineFrameNumbers) {
+        delete[] lineFrameNumbers;
+        lineFrameNumbers = nullptr;
+    }
+
+    delete[] overlayPixels;
+    delete[] renderThreadOverlay;
+    delete[] composedPixels;
+    delete[] overlayChangedLines;
+    delete[] renderThreadOverlayLines;
+    delete[] renderThreadOverlayChangedLines;
+
+    overlayPixels = nullptr;
+    renderThreadOverlay = nullptr;
+    composedPixels = nullptr;
+    overlayChangedLines = nullptr;
+    renderThreadOverlayLines = nullptr;
+    renderThreadOverlayChangedLines = nullptr;
+}
+
+// Changed lines are marked in renderThreadOverlayChangedLines, they are presented again.
+void StageImpl::takeOverlayChanges() {
+    int width = frameBuffersWidth;
+    SDL_LockMutex(overlayMutex);
+
+    for (int y = 0; y < frameBuffersHeight; y++) {
+        if (!overlayChangedLines[y]) {
+            continue;
+        }
+
+        uint32_t* line = renderThreadOverlay + y * width;
+        memcpy((void*)line, (void*)(overlayPixels + y * width), width * sizeof(uint32_t));
+
+        bool isOpaque = (std::find_if(line, line + width, [](uint32_t c) {
+            return c != STAGE_OVERLAY_TRANSPARENT;
+        }) != line + width);
+
+        renderThreadOverlayLinesCount += (int)isOpaque - (int)renderThreadOverlayLines[y];
+        renderThreadOverlayLines[y] = isOpaque;
+        renderThreadOverlayChangedLines[y] = true;
+        overlayChangedLines[y] = false;
+    }
+
+    SDL_UnlockMutex(overlayMutex);
+}
+
+void StageImpl::composeLines(int fromLine, int toLine) {
+    int width = lastFrameWidth;
+    const uint32_t* frame = frameBuffers[frontFrameIndex];
+
+    for (int y = fromLine; y < toLine; y++) {
+        uint32_t* dst = composedPixels + y * width;
+        memcpy((void*)dst, (void*)(frame + y * width), width * sizeof(uint32_t));
+
+        if (!renderThreadOverlayLines[y]) {
+            continue;
+        }
+
+        const uint32_t* overlay = renderThreadOverlay + y * width;
+
+        for (int x = 0; x < width; x++) {
+            if (overlay[x] != STAGE_OVERLAY_TRANSPARENT) {
+                dst[x] = overlay[x];
+            }
+        }
+    }
+}
+
 void StageImpl::renderThreadLoop() {
     while (isRenderThreadActive) {
         SDL_SemWait(renderThreadPixelsReadySem);
 
-        if (!renderThreadPixels || (SDL_MUSTLOCK(nativeSurface) && SDL_LockSurface(nativeSurface) < 0)) {
+        // several frames could be sent since the last wake up, only the newest one is presented
+        while (SDL_SemTryWait(renderThreadPixelsReadySem) == 0) {
+        }
+
+        if (!isRenderThreadActive) {
             return;
         }
 
-        switch (renderMode) {
-            case STAGE_RENDER_MODE_1X:
-                renderThreadUpdateSurface1x();
-                break;
+        #ifdef USE_SDL1
+            if (SDL_MUSTLOCK(nativeSurface) && SDL_LockSurface(nativeSurface) < 0) {
+                return;
+            }
+        #endif
 
-            case STAGE_RENDER_MODE_2X:
-                renderThreadUpdateSurface2x();
-                break;
+        const StageScaler& scaler = getStageScaler(renderMode);
+        int scale = scaler.scale;
+        bool isFresh = (readyFrameState & STAGE_FRAME_FRESH);
 
-            case STAGE_RENDER_MODE_2X_SCANLINES:
-                renderThreadUpdateSurface2xScanlines();
-                break;
+        if (isFresh) {
+            frontFrameIndex = readyFrameState.exchange(frontFrameIndex) & STAGE_FRAME_INDEX_MASK;
+            presentedFrames++;
+        }
+
+        // Lines changed after the previously presented frame. Numbers may be already updated by the newer frames,
+        // which only makes some lines scaled twice.
+        uint32_t prevFrameNumber = presentedFrameNumber;
+        bool isRepaint = isRepaintRequired.exchange(false);
+        bool isOverlayFresh = isOverlayChanged.exchange(false);
+
+        if (isOverlayFresh) {
+            takeOverlayChanges();
         }
 
-        isRenderThreadPixelsConsumed = true;
+        presentedFrameNumber = frameBufferNumbers[frontFrameIndex];
+        renderThreadDirtyRuns.clear();
 
         #ifdef USE_SDL1
+            // flipped surfaces are double buffered, so partial update would leave the other buffer stale
+            bool isWholeFrame = (hints & STAGE_HINT_FLIP_SURFACE);
+        #else
+            bool isWholeFrame = false;
+        #endif
+
+        for (int y = 0; (isFresh || isRepaint || isOverlayFresh) && y < lastFrameHeight; y++) {
+            bool isDirty = (isWholeFrame || isRepaint);
+
+            // with edge-aware scalers, changed line also changes its neighbours
+            int fromY = std::max(0, y - scaler.neighbourLines);
+            int toY = std::min(lastFrameHeight - 1, y + scaler.neighbourLines);
+
+            for (int i = fromY; !isDirty && i <= toY; i++) {
+                isDirty = (lineFrameNumbers[i].load(std::memory_order_relaxed) > prevFrameNumber
+                    || renderThreadOverlayChangedLines[i]
+                );
+            }
+
+            if (!isDirty) {
+                continue;
+            }
+
+            if (!renderThreadDirtyRuns.empty() && renderThreadDirtyRuns.back().second == y) {
+                renderThreadDirtyRuns.back().second = y + 1;
+            } else {
+                renderThreadDirtyRuns.push_back(std::make_pair(y, y + 1));
+            }
+        }
+
+        if (isOverlayFresh) {
+            std::fill(renderThreadOverlayChangedLines, renderThreadOverlayChangedLines + lastFrameHeight, false);
+        }
+
+        // without overlay frame is scaled directly, scalers also read neighbours of the dirty lines
+        if (renderThreadOverlayLinesCount) {
+            renderThreadSource = composedPixels;
+
+            for (const auto& run : renderThreadDirtyRuns) {
+                composeLines(
+                    std::max(0, run.first - scaler.neighbourLines),
+                    std::min((int)lastFrameHeight, run.second + scaler.neighbourLines)
+                );
+            }
+        } else {
+            renderThreadSource = frameBuffers[frontFrameIndex];
+        }
+
+        #ifdef USE_SDL1
+            for (const auto& run : renderThreadDirtyRuns) {
+                scaleLines(
+                    scaler,
+                    (uint8_t*)nativeSurface->pixels + run.first * scale * nativeSurface->pitch,
+                    nativeSurface->pitch,
+                    run.first,
+                    run.second
+                );
+            }
+
             if (SDL_MUSTLOCK(nativeSurface)) {
                 SDL_UnlockSurface(nativeSurface);
             }
@@ -651,13 +929,29 @@ void StageImpl::renderThreadLoop() {
             if (hints & STAGE_HINT_FLIP_SURFACE) {
                 SDL_Flip(nativeSurface);
             } else {
-                SDL_UpdateRect(nativeSurface, 0, 0, 0, 0);
+                for (const auto& run : renderThreadDirtyRuns) {
+                    SDL_UpdateRect(
+                        nativeSurface,
+                        0,
+                        run.first * scale,
+                        lastFrameWidth * scale,
+                        (run.second - run.first) * scale
+                    );
+                }
             }
         #else
-            SDL_UpdateTexture(nativeTexture, nullptr, nativeSurface->pixels, nativeSurface->pitch);
+            // scaled directly into the streaming texture, every locked rect is written whole
+            for (const auto& run : renderThreadDirtyRuns) {
+                SDL_Rect rect = { 0, run.first * scale, lastFrameWidth * scale, (run.second - run.first) * scale };
+                void* pixels;
+                int pitch;
+
+                if (SDL_LockTexture(nativeTexture, &rect, &pixels, &pitch) < 0) {
+                    continue;
+                }
 
-            if (SDL_MUSTLOCK(nativeSurface)) {
-                SDL_UnlockSurface(nativeSurface);
+                scaleLines(scaler, (uint8_t*)pixels, pitch, run.first, run.second);
+                SDL_UnlockTexture(nativeTexture);
             }
 
             SDL_RenderClear(nativeRenderer);
@@ -667,57 +961,118 @@ void StageImpl::renderThreadLoop() {
     }
 }
 
-void StageImpl::renderThreadUpdateSurface1x() {
-    uint32_t* src = renderThreadPixels;
-    uint8_t* dst = (uint8_t*)nativeSurface->pixels;
+void StageImpl::startScalerPool() {
+    int workers = std::min((int)std::thread::hardware_concurrency() - 1, STAGE_SCALER_MAX_WORKERS);
+
+    if (workers <= 0) {
+        return;
+    }
+
+    scalerStartSem = SDL_CreateSemaphore(0);
+    scalerDoneSem = SDL_CreateSemaphore(0);
 
-    for (int y = lastFrameHeight; y--;) {
-        memcpy((void*)dst, (void*)src, lastFrameWidth * sizeof(uint32_t));
-        dst += nativeSurface->pitch;
+    if (!scalerStartSem || !scalerDoneSem) {
+        throw std::runtime_error(std::string("SDL_CreateSemaphore() failed: ") + SDL_GetError());
+    }
+
+    for (int i = 0; i < workers; i++) {
+        #ifdef USE_SDL1
+            SDL_Thread* thread = SDL_CreateThread(stageImplScalerThreadFunction, (void*)this);
+        #else
+            SDL_Thread* thread = SDL_CreateThread(stageImplScalerThreadFunction, nullptr, (void*)this);
+        #endif
+
+        if (!thread) {
+            throw std::runtime_error(std::string("SDL_CreateThread() failed: ") + SDL_GetError());
+        }
+
+        scalerThreads.push_back(thread);
     }
 }
 
-void StageImpl::renderThreadUpdateSurface2x() {
-    uint32_t* src = renderThreadPixels;
-    uint8_t* dst = (uint8_t*)nativeSurface->pixels;
+void StageImpl::stopScalerPool() {
+    isScalerPoolActive = false;
+
+    for (size_t i = 0; i < scalerThreads.size(); i++) {
+        SDL_SemPost(scalerStartSem);
+    }
 
-    for (int y = lastFrameHeight; y--;) {
-        uint32_t* dstA = (uint32_t*)dst;
-        uint32_t* dstB = (uint32_t*)(dst + nativeSurface->pitch);
+    for (SDL_Thread* thread : scalerThreads) {
+        SDL_WaitThread(thread, nullptr);
+    }
 
-        for (int x = lastFrameWidth; x--;) {
-            int c = *(src++);
+    scalerThreads.clear();
 
-            *(dstA++) = c;
-            *(dstA++) = c;
+    if (scalerStartSem) {
+        SDL_DestroySemaphore(scalerStartSem);
+        scalerStartSem = nullptr;
+    }
 
-            *(dstB++) = c;
-            *(dstB++) = c;
+    if (scalerDoneSem) {
+        SDL_DestroySemaphore(scalerDoneSem);
+        scalerDoneSem = nullptr;
+    }
+}
+
+void StageImpl::scalerThreadLoop() {
+    for (;;) {
+        SDL_SemWait(scalerStartSem);
+
+        if (!isScalerPoolActive) {
+            return;
         }
 
-        dst += nativeSurface->pitch * 2;
+        scaleJobStripes();
+        SDL_SemPost(scalerDoneSem);
     }
 }
 
-void StageImpl::renderThreadUpdateSurface2xScanlines() {
-    uint32_t* src = renderThreadPixels;
-    uint8_t* dst = (uint8_t*)nativeSurface->pixels;
+// Lines are split to stripes, which are taken by the render thread and workers until none left.
+// Semaphores order the job fields between threads.
+void StageImpl::scaleLines(const StageScaler& scaler, uint8_t* dst, int dstPitch, int fromLine, int toLine) {
+    int stripes = (toLine - fromLine + STAGE_SCALER_STRIPE_LINES - 1) / STAGE_SCALER_STRIPE_LINES;
+    int workers = std::min((int)scalerThreads.size(), stripes - 1);
 
-    for (int y = lastFrameHeight; y--;) {
-        uint32_t* dstA = (uint32_t*)dst;
-        uint32_t* dstB = (uint32_t*)(dst + nativeSurface->pitch);
+    if (workers <= 0) {
+        scaler.function(dst, dstPitch, renderThreadSource, lastFrameWidth, lastFrameHeight, fromLine, toLine);
+        return;
+    }
+
+    scalerJobScaler = &scaler;
+    scalerJobDst = dst;
+    scalerJobPitch = dstPitch;
+    scalerJobFromLine = fromLine;
+    scalerJobToLine = toLine;
+    scalerJobNextStripe = 0;
+
+    for (int i = 0; i < workers; i++) {
+        SDL_SemPost(scalerStartSem);
+    }
 
-        for (int x = lastFrameWidth; x--;) {
-            int ca = *(src++);
-            int cb = (ca & 0xFEFEFE) >> 1;
+    scaleJobStripes();
 
-            *(dstA++) = ca;
-            *(dstA++) = ca;
+    for (int i = 0; i < workers; i++) {
+        SDL_SemWait(scalerDoneSem);
+    }
+}
+
+void StageImpl::scaleJobStripes() {
+    for (;;) {
+        int stripe = scalerJobNextStripe++;
+        int fromLine = scalerJobFromLine + stripe * STAGE_SCALER_STRIPE_LINES;
 
-            *(dstB++) = cb;
-            *(dstB++) = cb;
+        if (fromLine >= scalerJobToLine) {
+            return;
         }
 
-        dst += nativeSurface->pitch * 2;
+        scalerJobScaler->function(
+            scalerJobDst + (fromLine - scalerJobFromLine) * scalerJobScaler->scale * scalerJobPitch,
+            scalerJobPitch,
+            renderThreadSource,
+            lastFrameWidth,
+            lastFrameHeight,
+            fromLine,
+            std::min(scalerJobToLine, fromLine + STAGE_SCALER_STRIPE_LINES)
+        );
     }
 }
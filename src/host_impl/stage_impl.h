@@ -5,8 +5,12 @@
 #include <SDL_thread.h>
 #include <SDL_mutex.h>
 #include <map>
+#include <vector>
+#include <utility>
+#include <atomic>
 #include "ZEmuConfig.h"
 #include "host/stage.h"
+#include "stage_scalers.h"
 #include "host/logger.h"
 #include "host_driver/sound_driver.h"
 
@@ -34,7 +38,10 @@ public:
     bool pollEvent(StageEvent* into);
     void getRelativeMouseState(StageMouseState* into);
 
-    void renderFrame(uint32_t* pixels, int width, int height);
+    uint32_t* getFrameBuffer(int width, int height);
+    uint32_t* renderFrame(const bool* dirtyLines);
+    void renderOverlay(const uint32_t* pixels, const bool* dirtyLines);
+    void getFrameCounters(StageFrameCounters* into);
     void renderSound(uint32_t* buffer, int samples);
 
 private:
@@ -51,14 +58,54 @@ private:
     int joystickPressedButtonsMask = 0;
     int joystickPendingButtonsMask = 0;
     bool isMouseGrabbed = false;
-    SDL_Surface* nativeSurface = nullptr;
     SDL_Event nativeEvent;
 
     volatile bool isRenderThreadActive = true;
-    volatile bool isRenderThreadPixelsConsumed = true;
-    SDL_sem* renderThreadPixelsReadySem = nullptr;
+    SDL_sem* renderThreadPixelsReadySem = nullptr; // only wakes up the render thread, emulator never waits for it
     SDL_Thread* renderThread = nullptr;
-    uint32_t* volatile renderThreadPixels = nullptr;
+    std::vector<std::pair<int, int>> renderThreadDirtyRuns;
+    std::atomic<bool> isRepaintRequired; // all lines are scaled again (new texture, another scaler)
+
+    // Triple buffer: emulator draws into the back buffer, render thread presents the front one.
+    // Sent frame becomes ready, exchanging with the previous ready one, render thread takes the newest ready frame.
+    // Buffers are swapped by index, frame pixels are never copied.
+    uint32_t* frameBuffers[3] = { nullptr, nullptr, nullptr };
+    uint32_t frameBufferNumbers[3] = { 0, 0, 0 }; // number of the frame in the buffer
+    int frameBuffersWidth = 0;
+    int frameBuffersHeight = 0;
+    int backFrameIndex = 2;
+    int frontFrameIndex = 0;
+    std::atomic<int> readyFrameState; // index of the ready buffer with STAGE_FRAME_FRESH
+    std::atomic<uint32_t>* lineFrameNumbers = nullptr; // number of the last frame which changed the line
+    uint32_t presentedFrameNumber = 0;
+    StageFrameCounters frameCounters; // sent and dropped are updated by the emulator thread
+    std::atomic<uint64_t> presentedFrames;
+
+    // Emulator copies changed lines of the overlay under the mutex, render thread takes them into its own copy.
+    // While overlay is not empty, dirty lines (with their scaler neighbours) are composed with the frame
+    // into composedPixels, and scaled from there.
+    SDL_mutex* overlayMutex = nullptr;
+    uint32_t* overlayPixels = nullptr;
+    bool* overlayChangedLines = nullptr;
+    std::atomic<bool> isOverlayChanged;
+    uint32_t* renderThreadOverlay = nullptr;
+    bool* renderThreadOverlayLines = nullptr; // line has opaque pixels
+    bool* renderThreadOverlayChangedLines = nullptr;
+    int renderThreadOverlayLinesCount = 0;
+    uint32_t* composedPixels = nullptr;
+    const uint32_t* renderThreadSource = nullptr; // front frame or composedPixels
+
+    // scaler workers, render thread splits big updates to stripes and scales one of them itself
+    volatile bool isScalerPoolActive = true;
+    std::vector<SDL_Thread*> scalerThreads;
+    SDL_sem* scalerStartSem = nullptr;
+    SDL_sem* scalerDoneSem = nullptr;
+    const StageScaler* scalerJobScaler = nullptr;
+    uint8_t* scalerJobDst = nullptr;
+    int scalerJobPitch = 0;
+    int scalerJobFromLine = 0;
+    int scalerJobToLine = 0;
+    std::atomic<int> scalerJobNextStripe;
 
     std::unique_ptr<SoundDriver> soundDriver;
 
@@ -68,7 +115,9 @@ private:
         std::map<SDL_JoystickID, SDL_Joystick*> openedJoysticksMap;
     #endif
 
-    #ifndef USE_SDL1
+    #ifdef USE_SDL1
+        SDL_Surface* nativeSurface = nullptr;
+    #else
         std::string stageTitle;
         SDL_Window* nativeWindow = nullptr;
         SDL_Renderer* nativeRenderer = nullptr;
@@ -83,11 +132,18 @@ private:
     bool processPendingSingleJoystickButton(StageEvent* into, StageJoystickButton joyButton);
     void refreshVideoSubsystem();
     void renderThreadLoop();
-    void renderThreadUpdateSurface1x();
-    void renderThreadUpdateSurface2x();
-    void renderThreadUpdateSurface2xScanlines();
+    void allocFrameBuffers();
+    void freeFrameBuffers();
+    void takeOverlayChanges();
+    void composeLines(int fromLine, int toLine);
+    void startScalerPool();
+    void stopScalerPool();
+    void scalerThreadLoop();
+    void scaleLines(const StageScaler& scaler, uint8_t* dst, int dstPitch, int fromLine, int toLine);
+    void scaleJobStripes();
 
     friend int stageImplRenderThreadFunction(void* data);
+    friend int stageImplScalerThreadFunction(void* data);
 };
 
 #endif
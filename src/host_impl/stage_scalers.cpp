@@ -0,0 +1,195 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <algorithm>
+#include "stage_scalers.h"
+
+#if defined(__SSE2__)
+    #define STAGE_SCALERS_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+    #define STAGE_SCALERS_NEON
+    #include <arm_neon.h>
+#endif
+
+// half of the brightness, the unused byte is cleared
+#define STAGE_SCALERS_DARK_MASK STAGE_MAKERGB(0x7F, 0x7F, 0x7F)
+
+// Every pixel is repeated scale times, dark lines are used for scanlines.
+// SIMD parts are selected at compile time, since SSE2 and NEON are baseline for x86-64 and AArch64.
+template <int scale, bool isDark>
+static inline void expandLine(uint32_t* dst, const uint32_t* src, int width) {
+    #if defined(STAGE_SCALERS_SSE2)
+        const __m128i darkMask = _mm_set1_epi32((int)STAGE_SCALERS_DARK_MASK);
+
+        for (; width >= 4; width -= 4, src += 4, dst += 4 * scale) {
+            __m128i v = _mm_loadu_si128((const __m128i*)src);
+
+            if (isDark) {
+                v = _mm_and_si128(_mm_srli_epi32(v, 1), darkMask);
+            }
+
+            if (scale == 1) {
+                _mm_storeu_si128((__m128i*)dst, v);
+            } else if (scale == 2) {
+                _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi32(v, v));
+                _mm_storeu_si128((__m128i*)(dst + 4), _mm_unpackhi_epi32(v, v));
+            } else if (scale == 3) {
+                _mm_storeu_si128((__m128i*)dst, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 0, 0)));
+                _mm_storeu_si128((__m128i*)(dst + 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 1, 1)));
+                _mm_storeu_si128((__m128i*)(dst + 8), _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 2)));
+            } else {
+                _mm_storeu_si128((__m128i*)dst, _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0)));
+                _mm_storeu_si128((__m128i*)(dst + 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+                _mm_storeu_si128((__m128i*)(dst + 8), _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 2, 2)));
+                _mm_storeu_si128((__m128i*)(dst + 12), _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)));
+            }
+        }
+    #elif defined(STAGE_SCALERS_NEON)
+        const uint32x4_t darkMask = vdupq_n_u32(STAGE_SCALERS_DARK_MASK);
+
+        // interleaving stores put every pixel scale times in a row
+        for (; width >= 4; width -= 4, src += 4, dst += 4 * scale) {
+            uint32x4_t v = vld1q_u32(src);
+
+            if (isDark) {
+                v = vandq_u32(vshrq_n_u32(v, 1), darkMask);
+            }
+
+            if (scale == 1) {
+                vst1q_u32(dst, v);
+            } else if (scale == 2) {
+                uint32x4x2_t pixels = { { v, v } };
+                vst2q_u32(dst, pixels);
+            } else if (scale == 3) {
+                uint32x4x3_t pixels = { { v, v, v } };
+                vst3q_u32(dst, pixels);
+            } else {
+                uint32x4x4_t pixels = { { v, v, v, v } };
+                vst4q_u32(dst, pixels);
+            }
+        }
+    #endif
+
+    for (; width > 0; width--) {
+        uint32_t c = *(src++);
+
+        if (isDark) {
+            c = (c >> 1) & STAGE_SCALERS_DARK_MASK;
+        }
+
+        for (int i = 0; i < scale; i++) {
+            *(dst++) = c;
+        }
+    }
+}
+
+// every output line is expanded from the source, since reading back from the texture memory may be slow
+template <int scale, bool isScanlines>
+static void scaleLines(uint8_t* dst, int dstPitch, const uint32_t* src, int width, int, int fromLine, int toLine) {
+    src += fromLine * width;
+
+    for (int y = fromLine; y < toLine; y++, src += width) {
+        for (int i = 0; i < scale; i++, dst += dstPitch) {
+            if (isScanlines && i == scale - 1) {
+                expandLine<scale, true>((uint32_t*)dst, src, width);
+            } else {
+                expandLine<scale, false>((uint32_t*)dst, src, width);
+            }
+        }
+    }
+}
+
+// Scale2x (EPX): B is above the pixel E, D is to the left, F is to the right, H is below
+static inline void scale2xPixel(uint32_t* dstA, uint32_t* dstB, uint32_t b, uint32_t d, uint32_t e, uint32_t f, uint32_t h) {
+    if (b != h && d != f) {
+        dstA[0] = (d == b ? d : e);
+        dstA[1] = (b == f ? f : e);
+        dstB[0] = (d == h ? d : e);
+        dstB[1] = (h == f ? f : e);
+    } else {
+        dstA[0] = e;
+        dstA[1] = e;
+        dstB[0] = e;
+        dstB[1] = e;
+    }
+}
+
+static void scaleLines2xEpx(uint8_t* dst, int dstPitch, const uint32_t* src, int width, int height, int fromLine, int toLine) {
+    for (int y = fromLine; y < toLine; y++, dst += dstPitch * 2) {
+        const uint32_t* up = src + std::max(0, y - 1) * width;
+        const uint32_t* line = src + y * width;
+        const uint32_t* down = src + std::min(height - 1, y + 1) * width;
+        uint32_t* dstA = (uint32_t*)dst;
+        uint32_t* dstB = (uint32_t*)(dst + dstPitch);
+
+        scale2xPixel(dstA, dstB, up[0], line[0], line[0], line[std::min(1, width - 1)], down[0]);
+        int x = 1;
+
+        #if defined(STAGE_SCALERS_SSE2)
+            for (; x + 4 < width; x += 4) {
+                __m128i b = _mm_loadu_si128((const __m128i*)(up + x));
+                __m128i d = _mm_loadu_si128((const __m128i*)(line + x - 1));
+                __m128i e = _mm_loadu_si128((const __m128i*)(line + x));
+                __m128i f = _mm_loadu_si128((const __m128i*)(line + x + 1));
+                __m128i h = _mm_loadu_si128((const __m128i*)(down + x));
+
+                // andnot(a, b) is ~a & b
+                __m128i cond = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f)), _mm_set1_epi32(-1));
+                __m128i m0 = _mm_and_si128(_mm_cmpeq_epi32(d, b), cond);
+                __m128i m1 = _mm_and_si128(_mm_cmpeq_epi32(b, f), cond);
+                __m128i m2 = _mm_and_si128(_mm_cmpeq_epi32(d, h), cond);
+                __m128i m3 = _mm_and_si128(_mm_cmpeq_epi32(h, f), cond);
+
+                __m128i e0 = _mm_or_si128(_mm_and_si128(m0, d), _mm_andnot_si128(m0, e));
+                __m128i e1 = _mm_or_si128(_mm_and_si128(m1, f), _mm_andnot_si128(m1, e));
+                __m128i e2 = _mm_or_si128(_mm_and_si128(m2, d), _mm_andnot_si128(m2, e));
+                __m128i e3 = _mm_or_si128(_mm_and_si128(m3, f), _mm_andnot_si128(m3, e));
+
+                _mm_storeu_si128((__m128i*)(dstA + x * 2), _mm_unpacklo_epi32(e0, e1));
+                _mm_storeu_si128((__m128i*)(dstA + x * 2 + 4), _mm_unpackhi_epi32(e0, e1));
+                _mm_storeu_si128((__m128i*)(dstB + x * 2), _mm_unpacklo_epi32(e2, e3));
+                _mm_storeu_si128((__m128i*)(dstB + x * 2 + 4), _mm_unpackhi_epi32(e2, e3));
+            }
+        #elif defined(STAGE_SCALERS_NEON)
+            for (; x + 4 < width; x += 4) {
+                uint32x4_t b = vld1q_u32(up + x);
+                uint32x4_t d = vld1q_u32(line + x - 1);
+                uint32x4_t e = vld1q_u32(line + x);
+                uint32x4_t f = vld1q_u32(line + x + 1);
+                uint32x4_t h = vld1q_u32(down + x);
+
+                uint32x4_t cond = vmvnq_u32(vorrq_u32(vceqq_u32(b, h), vceqq_u32(d, f)));
+                uint32x4x2_t top;
+                uint32x4x2_t bottom;
+
+                top.val[0] = vbslq_u32(vandq_u32(vceqq_u32(d, b), cond), d, e);
+                top.val[1] = vbslq_u32(vandq_u32(vceqq_u32(b, f), cond), f, e);
+                bottom.val[0] = vbslq_u32(vandq_u32(vceqq_u32(d, h), cond), d, e);
+                bottom.val[1] = vbslq_u32(vandq_u32(vceqq_u32(h, f), cond), f, e);
+
+                vst2q_u32(dstA + x * 2, top);
+                vst2q_u32(dstB + x * 2, bottom);
+            }
+        #endif
+
+        for (; x < width; x++) {
+            scale2xPixel(dstA + x * 2, dstB + x * 2, up[x], line[x - 1], line[x], line[std::min(x + 1, width - 1)], down[x]);
+        }
+    }
+}
+
+const StageScaler& getStageScaler(StageRenderMode mode) {
+    static const StageScaler scalers[] = {
+        { 1, 0, scaleLines<1, false> }, // STAGE_RENDER_MODE_1X
+        { 2, 0, scaleLines<2, false> }, // STAGE_RENDER_MODE_2X
+        { 2, 0, scaleLines<2, true> }, // STAGE_RENDER_MODE_2X_SCANLINES
+        { 3, 0, scaleLines<3, false> }, // STAGE_RENDER_MODE_3X
+        { 3, 0, scaleLines<3, true> }, // STAGE_RENDER_MODE_3X_SCANLINES
+        { 4, 0, scaleLines<4, false> }, // STAGE_RENDER_MODE_4X
+        { 4, 0, scaleLines<4, true> }, // STAGE_RENDER_MODE_4X_SCANLINES
+        { 2, 1, scaleLines2xEpx }, // STAGE_RENDER_MODE_2X_EPX
+    };
+
+    return scalers[mode];
+}
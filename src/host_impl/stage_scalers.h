@@ -0,0 +1,28 @@
+#ifndef HOST_IMPL__STAGE_SCALERS_H__INCLUDED
+#define HOST_IMPL__STAGE_SCALERS_H__INCLUDED
+
+#include <cstdint>
+#include "host/stage.h"
+
+// Scales lines [fromLine, toLine) of the frame into dst, which points to the first output line of fromLine.
+// Whole frame is passed, since edge-aware scalers look at neighbour lines. Lines are independent,
+// so the range can be split into stripes and scaled in parallel.
+typedef void (* StageScalerFunction)(
+    uint8_t* dst,
+    int dstPitch,
+    const uint32_t* src,
+    int width,
+    int height,
+    int fromLine,
+    int toLine
+);
+
+struct StageScaler {
+    int scale;
+    int neighbourLines; // output of the line depends on this number of lines above and below it
+    StageScalerFunction function;
+};
+
+const StageScaler& getStageScaler(StageRenderMode mode);
+
+#endif
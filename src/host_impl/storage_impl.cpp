@@ -1,35 +1,13 @@
 // This is an open source non-commercial project. Dear PVS-Studio, please check it.
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
-#ifdef __APPLE__
-    // Fix compilation error due to bug in the boost.process 1.69.x - https://github.com/boostorg/process/issues/55
-    // This "fix" will broke timed functions (eg. wait_for / wait_until), but we don't use them, so it's ok for us.
-    #include <signal.h>
-
-    #ifdef sigemptyset
-        #undef sigemptyset
-    #endif
-
-    #ifdef sigaddset
-        #undef sigaddset
-    #endif
-
-    #ifdef sigtimedwait
-        #undef sigtimedwait
-    #endif
-
-    int sigemptyset(sigset_t *);
-    int sigaddset(sigset_t *, int);
-    int sigtimedwait(const sigset_t *set, siginfo_t *info, const struct timespec *timeout);
-#endif
-
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdexcept>
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
-#include <boost/process.hpp>
+#include "boost_process.h"
 #include "storage_impl.h"
 
 #ifdef _WIN32
@@ -459,10 +437,18 @@ bool EmptyPathImpl::createDirectories() {
     return false;
 }
 
+bool EmptyPathImpl::rename(const PathPtr& into) {
+    return false;
+}
+
 DataWriterPtr EmptyPathImpl::dataWriter() {
     throw std::domain_error("Writing for empty path is not supported");
 }
 
+DataWriterPtr EmptyPathImpl::dataAppender() {
+    throw std::domain_error("Writing for empty path is not supported");
+}
+
 //
 // FilePathImpl
 //
@@ -733,11 +719,37 @@ bool FilePathImpl::createDirectories() {
     return result && !ec;
 }
 
+bool FilePathImpl::rename(const PathPtr& into) {
+    auto intoFile = std::dynamic_pointer_cast<FilePathImpl>(into);
+
+    if (!intoFile) {
+        return false;
+    }
+
+    boost::system::error_code ec;
+
+    #ifdef _WIN32
+        boost::filesystem::rename(platformPath, intoFile->platformPath, ec);
+    #else
+        boost::filesystem::rename(nativePath, intoFile->nativePath, ec);
+    #endif
+
+    return !ec;
+}
+
 DataWriterPtr FilePathImpl::dataWriter() {
     #ifdef _WIN32
-        return DataWriterPtr(new DataWriterImpl(platformPath));
+        return DataWriterPtr(new DataWriterImpl(platformPath, false));
+    #else
+        return DataWriterPtr(new DataWriterImpl(nativePath, false));
+    #endif
+}
+
+DataWriterPtr FilePathImpl::dataAppender() {
+    #ifdef _WIN32
+        return DataWriterPtr(new DataWriterImpl(platformPath, true));
     #else
-        return DataWriterPtr(new DataWriterImpl(nativePath));
+        return DataWriterPtr(new DataWriterImpl(nativePath, true));
     #endif
 }
 
@@ -929,10 +941,18 @@ bool ArchivePathImpl::createDirectories() {
     return false;
 }
 
+bool ArchivePathImpl::rename(const PathPtr& into) {
+    return false;
+}
+
 DataWriterPtr ArchivePathImpl::dataWriter() {
     throw std::domain_error("Writing into archives is not supported");
 }
 
+DataWriterPtr ArchivePathImpl::dataAppender() {
+    throw std::domain_error("Writing into archives is not supported");
+}
+
 std::shared_ptr<ArchiveEntries>& ArchivePathImpl::entries() {
     if (!entriesInstance) {
         entriesInstance = storage->listArchiveEntries(pluginPath, archivePath);
@@ -1086,9 +1106,9 @@ void ArchiveDataReaderImpl::setPosition(uintmax_t position) {
 // DataWriterImpl
 //
 
-DataWriterImpl::DataWriterImpl(const boost::filesystem::path& path) {
+DataWriterImpl::DataWriterImpl(const boost::filesystem::path& path, bool isAppend) {
     fmtBuffer[0] = '\0';
-    ofs.open(path.string(), std::ifstream::out | std::ifstream::binary | std::ifstream::trunc);
+    ofs.open(path.string(), std::ifstream::out | std::ifstream::binary | (isAppend ? std::ifstream::app : std::ifstream::trunc));
 
     if (ofs.fail()) {
         throw StorageException((boost::format("Failed to write into \"%s\"") % path).str());
@@ -1139,3 +1159,8 @@ uintmax_t DataWriterImpl::getPosition() {
 void DataWriterImpl::setPosition(uintmax_t position) {
     ofs.seekp(position);
 }
+
+bool DataWriterImpl::flush() {
+    ofs.flush();
+    return !ofs.fail();
+}
@@ -82,7 +82,9 @@ public:
     bool remove();
     bool removeAll();
     bool createDirectories();
+    bool rename(const PathPtr& into);
     DataWriterPtr dataWriter();
+    DataWriterPtr dataAppender();
 
 private:
 
@@ -121,7 +123,9 @@ public:
     bool remove();
     bool removeAll();
     bool createDirectories();
+    bool rename(const PathPtr& into);
     DataWriterPtr dataWriter();
+    DataWriterPtr dataAppender();
 
 private:
 
@@ -181,7 +185,9 @@ public:
     bool remove();
     bool removeAll();
     bool createDirectories();
+    bool rename(const PathPtr& into);
     DataWriterPtr dataWriter();
+    DataWriterPtr dataAppender();
 
 private:
 
@@ -312,13 +318,14 @@ public:
     bool writeBlock(void* buf, uintmax_t size);
     uintmax_t getPosition();
     void setPosition(uintmax_t position);
+    bool flush();
 
 private:
 
     std::ofstream ofs;
     char fmtBuffer[0x400];
 
-    DataWriterImpl(const boost::filesystem::path& path);
+    DataWriterImpl(const boost::filesystem::path& path, bool isAppend);
 
     friend class FilePathImpl;
 };
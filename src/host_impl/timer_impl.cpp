@@ -4,10 +4,17 @@
 #include <SDL_timer.h>
 #include "timer_impl.h"
 
+TimerImpl::TimerImpl() : startTime(std::chrono::steady_clock::now()) {
+}
+
 uint32_t TimerImpl::getElapsedMillis() {
     return SDL_GetTicks();
 }
 
+uint64_t TimerImpl::getElapsedMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
 void TimerImpl::wait(uint32_t millis) {
     SDL_Delay(millis);
 }
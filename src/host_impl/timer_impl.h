@@ -1,13 +1,21 @@
 #ifndef HOST_IMPL__TIMER_IMPL_H__INCLUDED
 #define HOST_IMPL__TIMER_IMPL_H__INCLUDED
 
+#include <chrono>
 #include "host/timer.h"
 
 class TimerImpl : public Timer {
 public:
 
+    TimerImpl();
+
     uint32_t getElapsedMillis();
+    uint64_t getElapsedMicros();
     void wait(uint32_t millis);
+
+private:
+
+    std::chrono::steady_clock::time_point startTime;
 };
 
 #endif
@@ -0,0 +1,399 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include "zemu_env.h"
+#include "journal.h"
+#include "state.h"
+
+#define JOURNAL_FORMAT_VERSION 1
+#define JOURNAL_BLOCK_SIZE 256
+#define JOURNAL_HEADER_SIZE 12
+#define JOURNAL_RECORD_HEADER_SIZE 16
+#define JOURNAL_RECORD_BASE 'B'
+#define JOURNAL_RECORD_DELTA 'D'
+
+static std::string journalFileName;
+static DataWriterPtr journalWriter;
+static unsigned journalInterval = JOURNAL_DEFAULT_INTERVAL;
+static unsigned journalMaxPoints = JOURNAL_DEFAULT_POINTS;
+static unsigned journalFrames = 0;
+static std::vector<uint8_t> journalLast;
+static std::vector<uint8_t> journalCurrent;
+static std::deque<std::vector<uint8_t>> journalRecords; // same as in the file, so compaction doesn't read it back
+
+static void Journal_PutDword(std::vector<uint8_t>& into, uint32_t value) {
+    into.push_back((uint8_t)value);
+    into.push_back((uint8_t)(value >> 8));
+    into.push_back((uint8_t)(value >> 16));
+    into.push_back((uint8_t)(value >> 24));
+}
+
+static uint32_t Journal_GetDword(const uint8_t* ptr) {
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+// FNV-1a
+static uint32_t Journal_Checksum(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261U;
+
+    while (size--) {
+        hash = (hash ^ *(data++)) * 16777619U;
+    }
+
+    return hash;
+}
+
+static void Journal_AppendHeader(std::vector<uint8_t>& into) {
+    into.insert(into.end(), { 'Z', 'J', 'L', 0x1A });
+    Journal_PutDword(into, JOURNAL_FORMAT_VERSION);
+    Journal_PutDword(into, JOURNAL_BLOCK_SIZE);
+}
+
+// Appends the base record when there is no previous state (or it has different size), delta record otherwise.
+static void Journal_AppendRecord(
+    std::vector<uint8_t>& into,
+    uint32_t frame,
+    const std::vector<uint8_t>& older,
+    const std::vector<uint8_t>& newer
+) {
+    bool isBase = (older.size() != newer.size());
+    size_t recordStart = into.size();
+
+    into.insert(into.end(), { 'Z', 'J', 'R', (uint8_t)(isBase ? JOURNAL_RECORD_BASE : JOURNAL_RECORD_DELTA) });
+    Journal_PutDword(into, frame);
+    Journal_PutDword(into, (uint32_t)newer.size());
+    Journal_PutDword(into, 0); // payload size, updated below
+
+    size_t payloadStart = into.size();
+
+    if (isBase) {
+        into.insert(into.end(), newer.begin(), newer.end());
+    } else {
+        size_t blocks = (newer.size() + JOURNAL_BLOCK_SIZE - 1) / JOURNAL_BLOCK_SIZE;
+        size_t block = 0;
+
+        while (block < blocks) {
+            size_t offset = block * JOURNAL_BLOCK_SIZE;
+            size_t size = std::min((size_t)JOURNAL_BLOCK_SIZE, newer.size() - offset);
+
+            if (!memcmp(&older[offset], &newer[offset], size)) {
+                block++;
+                continue;
+            }
+
+            size_t first = block;
+
+            while (block < blocks) {
+                offset = block * JOURNAL_BLOCK_SIZE;
+                size = std::min((size_t)JOURNAL_BLOCK_SIZE, newer.size() - offset);
+
+                if (!memcmp(&older[offset], &newer[offset], size)) {
+                    break;
+                }
+
+                block++;
+            }
+
+            offset = first * JOURNAL_BLOCK_SIZE;
+            size = std::min(block * JOURNAL_BLOCK_SIZE, newer.size()) - offset;
+
+            Journal_PutDword(into, (uint32_t)first);
+            Journal_PutDword(into, (uint32_t)(block - first));
+            into.insert(into.end(), newer.begin() + offset, newer.begin() + offset + size);
+        }
+    }
+
+    size_t payloadSize = into.size() - payloadStart;
+
+    into[recordStart + 12] = (uint8_t)payloadSize;
+    into[recordStart + 13] = (uint8_t)(payloadSize >> 8);
+    into[recordStart + 14] = (uint8_t)(payloadSize >> 16);
+    into[recordStart + 15] = (uint8_t)(payloadSize >> 24);
+
+    Journal_PutDword(into, Journal_Checksum(&into[payloadStart], payloadSize));
+}
+
+static bool Journal_ApplyDelta(const uint8_t* ptr, const uint8_t* end, std::vector<uint8_t>& state) {
+    while (ptr < end) {
+        if (end - ptr < 8) {
+            return false;
+        }
+
+        size_t offset = (size_t)Journal_GetDword(ptr) * JOURNAL_BLOCK_SIZE;
+        size_t size = (size_t)Journal_GetDword(ptr + 4) * JOURNAL_BLOCK_SIZE;
+        ptr += 8;
+
+        if (offset >= state.size()) {
+            return false;
+        }
+
+        size = std::min(size, state.size() - offset);
+
+        if ((size_t)(end - ptr) < size) {
+            return false;
+        }
+
+        memcpy(&state[offset], ptr, size);
+        ptr += size;
+    }
+
+    return true;
+}
+
+// Reconstructs every point of the journal and passes it to the callback, until callback returns false.
+// Returns false only if the file can't be read or it is not a journal.
+static bool Journal_Read(
+    const char* fileName,
+    const std::function<bool(uint32_t frame, const std::vector<uint8_t>& state)>& onPoint
+) {
+    std::vector<uint8_t> data;
+
+    try {
+        host->storage()->path(fileName)->readAll(data);
+    } catch (StorageException& e) {
+        printf("Journal: %s\n", e.what());
+        return false;
+    }
+
+    if (data.size() < JOURNAL_HEADER_SIZE
+        || memcmp(data.data(), "ZJL\x1A", 4)
+        || Journal_GetDword(&data[4]) != JOURNAL_FORMAT_VERSION
+        || Journal_GetDword(&data[8]) != JOURNAL_BLOCK_SIZE
+    ) {
+        printf("Journal: \"%s\" is not a journal or has unsupported version\n", fileName);
+        return false;
+    }
+
+    std::vector<uint8_t> state;
+    const uint8_t* ptr = &data[JOURNAL_HEADER_SIZE];
+    const uint8_t* end = data.data() + data.size();
+
+    while (ptr < end) {
+        if (end - ptr < JOURNAL_RECORD_HEADER_SIZE || memcmp(ptr, "ZJR", 3)) {
+            break;
+        }
+
+        uint8_t type = ptr[3];
+        uint32_t frame = Journal_GetDword(ptr + 4);
+        size_t stateSize = Journal_GetDword(ptr + 8);
+        size_t payloadSize = Journal_GetDword(ptr + 12);
+        const uint8_t* payload = ptr + JOURNAL_RECORD_HEADER_SIZE;
+
+        if ((size_t)(end - payload) < payloadSize + 4
+            || Journal_Checksum(payload, payloadSize) != Journal_GetDword(payload + payloadSize)
+        ) {
+            break;
+        }
+
+        if (type == JOURNAL_RECORD_BASE && payloadSize == stateSize) {
+            state.assign(payload, payload + payloadSize);
+        } else if (type != JOURNAL_RECORD_DELTA
+            || state.size() != stateSize
+            || !Journal_ApplyDelta(payload, payload + payloadSize, state)
+        ) {
+            break;
+        }
+
+        ptr = payload + payloadSize + 4;
+
+        if (!onPoint(frame, state)) {
+            return true;
+        }
+    }
+
+    if (ptr < end) {
+        printf("Journal: ignoring broken or incomplete data at offset %u\n", (unsigned)(ptr - data.data()));
+    }
+
+    return true;
+}
+
+// Record is valid, since it was made by Journal_AppendRecord().
+static void Journal_ApplyRecord(const std::vector<uint8_t>& record, std::vector<uint8_t>& state) {
+    const uint8_t* payload = &record[JOURNAL_RECORD_HEADER_SIZE];
+    size_t payloadSize = Journal_GetDword(&record[12]);
+
+    if (record[3] == JOURNAL_RECORD_BASE) {
+        state.assign(payload, payload + payloadSize);
+    } else {
+        Journal_ApplyDelta(payload, payload + payloadSize, state);
+    }
+}
+
+static bool Journal_WriteData(DataWriterPtr& writer, const std::vector<uint8_t>& data) {
+    return writer->writeBlock((void*)data.data(), data.size()) && writer->flush();
+}
+
+static void Journal_Stop(const char* reason) {
+    printf("Journal: %s, journal is stopped\n", reason);
+    SetMessage("Journal is stopped");
+    journalWriter.reset();
+}
+
+// Writes the header, the base and records from firstRecord into the temporary file and renames it over the journal.
+// Returns false when the journal is not changed.
+static bool Journal_WriteCompacted(const std::vector<uint8_t>& base, size_t firstRecord) {
+    auto path = host->storage()->path(journalFileName);
+    auto tempPath = host->storage()->path(journalFileName + ".tmp");
+
+    try {
+        std::vector<uint8_t> header;
+        Journal_AppendHeader(header);
+
+        // closed at the end of the scope, otherwise it can't be renamed on Windows
+        DataWriterPtr writer = tempPath->dataWriter();
+
+        if (!Journal_WriteData(writer, header) || !Journal_WriteData(writer, base)) {
+            throw StorageException("Write error");
+        }
+
+        for (size_t i = firstRecord; i < journalRecords.size(); i++) {
+            if (!Journal_WriteData(writer, journalRecords[i])) {
+                throw StorageException("Write error");
+            }
+        }
+    } catch (StorageException& e) {
+        printf("Journal: compaction failed: %s\n", e.what());
+        tempPath->remove();
+        return false;
+    }
+
+    journalWriter.reset();
+    bool isRenamed = tempPath->rename(path);
+
+    if (!isRenamed) {
+        printf("Journal: compaction failed: can't rename \"%s\"\n", tempPath->string().c_str());
+        tempPath->remove();
+    }
+
+    try {
+        journalWriter = path->dataAppender();
+    } catch (StorageException& e) {
+        Journal_Stop(e.what());
+    }
+
+    return isRenamed;
+}
+
+// State of the oldest kept point becomes the new base. Following records are deltas from the previous point,
+// so they are written as is.
+static void Journal_Compact(void) {
+    size_t baseRecord = journalRecords.size() - std::max(1U, journalMaxPoints / 2);
+    std::vector<uint8_t> state;
+
+    for (size_t i = 0; i <= baseRecord; i++) {
+        Journal_ApplyRecord(journalRecords[i], state);
+    }
+
+    std::vector<uint8_t> base;
+    Journal_AppendRecord(base, Journal_GetDword(&journalRecords[baseRecord][4]), std::vector<uint8_t>(), state);
+
+    if (!Journal_WriteCompacted(base, baseRecord + 1)) {
+        return;
+    }
+
+    journalRecords.erase(journalRecords.begin(), journalRecords.begin() + baseRecord + 1);
+    journalRecords.push_front(std::move(base));
+}
+
+static void Journal_WritePoint(void) {
+    journalCurrent.clear();
+    State_Save(journalCurrent);
+
+    std::vector<uint8_t> record;
+    Journal_AppendRecord(record, (uint32_t)frames, journalLast, journalCurrent);
+
+    if (!Journal_WriteData(journalWriter, record)) {
+        Journal_Stop("write failed");
+        return;
+    }
+
+    journalLast.swap(journalCurrent);
+    journalRecords.push_back(std::move(record));
+
+    if (journalRecords.size() > journalMaxPoints) {
+        Journal_Compact();
+    }
+}
+
+static void Journal_OnFrameStart(void) {
+    if (!journalWriter || ++journalFrames < journalInterval) {
+        return;
+    }
+
+    journalFrames = 0;
+    Journal_WritePoint();
+}
+
+bool Journal_Init(const char* fileName) {
+    auto config = host->config();
+
+    journalInterval = (unsigned)std::max(1, config->getInt("core", "journal_interval", JOURNAL_DEFAULT_INTERVAL));
+    journalMaxPoints = (unsigned)std::max(2, config->getInt("core", "journal_points", JOURNAL_DEFAULT_POINTS));
+    journalFileName = fileName;
+
+    std::vector<uint8_t> header;
+    Journal_AppendHeader(header);
+
+    try {
+        journalWriter = host->storage()->path(journalFileName)->dataWriter();
+
+        if (!Journal_WriteData(journalWriter, header)) {
+            throw StorageException("Write error");
+        }
+    } catch (StorageException& e) {
+        printf("Journal: %s\n", e.what());
+        journalWriter.reset();
+        return false;
+    }
+
+    journalFrames = journalInterval - 1; // first point (base) is written at the first frame
+    journalLast.clear();
+    journalRecords.clear();
+
+    AttachFrameStartHandler(Journal_OnFrameStart);
+    return true;
+}
+
+void Journal_Close(void) {
+    journalWriter.reset();
+    journalLast.clear();
+    journalCurrent.clear();
+    journalRecords.clear();
+}
+
+bool Journal_Restore(const char* fileName, int point) {
+    std::vector<uint8_t> restored;
+    uint32_t restoredFrame = 0;
+    int index = 0;
+    int restoredIndex = -1;
+
+    bool isRead = Journal_Read(fileName, [&](uint32_t frame, const std::vector<uint8_t>& state) {
+        if (point == JOURNAL_POINT_LAST || index == point) {
+            restored = state;
+            restoredFrame = frame;
+            restoredIndex = index;
+        }
+
+        return (index++ != point);
+    });
+
+    if (!isRead) {
+        return false;
+    }
+
+    if (restoredIndex < 0) {
+        printf("Journal: point %d not found in \"%s\"\n", point, fileName);
+        return false;
+    }
+
+    printf("Journal: restoring point %d (frame %u)\n", restoredIndex, (unsigned)restoredFrame);
+    return State_Load(restored.data(), restored.size());
+}
@@ -0,0 +1,30 @@
+#ifndef _JOURNAL_H_INCLUDED_
+#define _JOURNAL_H_INCLUDED_
+
+#include "zemu.h"
+
+// Append-only journal of full machine states (see state.h), file extension ".zjl".
+//
+// "ZJL" + 0x1A, dword format version, dword block size
+// records until the end of file:
+//   "ZJR" + type ('B' - base, 'D' - delta), dword frame, dword state size, dword payload size, payload,
+//   dword checksum of the payload
+//
+// Base payload is the full state. Delta payload is the list of (dword first block, dword block count, data)
+// runs of blocks which differ from the previous point. States are compared block by block with memcmp,
+// so the journal doesn't depend on dirty tracking in the memory manager and also catches devices memory.
+// Record is flushed after writing, incomplete record at the end (after a crash) is ignored on restore.
+// When journal has too many points, it is compacted: state of the oldest kept point becomes the new base.
+// Records are kept in memory, so compaction doesn't read the file. Compacted journal is written into "<file>.tmp",
+// which is renamed over the journal, so failed compaction doesn't lose it.
+
+#define JOURNAL_EXTENSION ".zjl"
+#define JOURNAL_DEFAULT_INTERVAL 250
+#define JOURNAL_DEFAULT_POINTS 120
+#define JOURNAL_POINT_LAST (-1)
+
+bool Journal_Init(const char* fileName);
+void Journal_Close(void);
+bool Journal_Restore(const char* fileName, int point);
+
+#endif
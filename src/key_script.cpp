@@ -0,0 +1,117 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include "key_script.h"
+#include "devs.h"
+#include "tape/tape.h"
+
+struct s_KeyScriptItem {
+    int frame;
+    bool isTapeStart;
+    int keyboardMask[8];
+};
+
+static std::vector<s_KeyScriptItem> keyScriptItems;
+
+static void KeyScript_OnFrameStart(void) {
+    for (const auto& item : keyScriptItems) {
+        if (item.isTapeStart) {
+            if (item.frame == frames) {
+                C_Tape::Start();
+            }
+
+            continue;
+        }
+
+        if (item.frame == frames) {
+            for (int i = 0; i < 8; i++) {
+                C_Keyboard::keyboard[i] &= ~item.keyboardMask[i];
+            }
+        } else if (item.frame + KEY_SCRIPT_HOLD_FRAMES == frames) {
+            for (int i = 0; i < 8; i++) {
+                C_Keyboard::keyboard[i] |= item.keyboardMask[i];
+            }
+        }
+    }
+}
+
+bool KeyScript_Parse(const char* script) {
+    std::string value(script);
+    size_t pos = 0;
+
+    keyScriptItems.clear();
+
+    while (pos < value.length()) {
+        size_t end = value.find(',', pos);
+
+        if (end == std::string::npos) {
+            end = value.length();
+        }
+
+        std::string entry = value.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (entry.empty()) {
+            continue;
+        }
+
+        size_t colon = entry.find(':');
+
+        if (colon == std::string::npos || colon == 0) {
+            printf("Bad key script item \"%s\"\n", entry.c_str());
+            return false;
+        }
+
+        s_KeyScriptItem item;
+        item.frame = atoi(entry.substr(0, colon).c_str());
+        item.isTapeStart = false;
+
+        for (int i = 0; i < 8; i++) {
+            item.keyboardMask[i] = 0;
+        }
+
+        std::string keys = entry.substr(colon + 1);
+
+        if (keys == "tape") {
+            item.isTapeStart = true;
+            keyScriptItems.push_back(item);
+            continue;
+        }
+
+        size_t keyPos = 0;
+
+        while (keyPos <= keys.length()) {
+            size_t keyEnd = keys.find('+', keyPos);
+
+            if (keyEnd == std::string::npos) {
+                keyEnd = keys.length();
+            }
+
+            std::string key = keys.substr(keyPos, keyEnd - keyPos);
+            keyPos = keyEnd + 1;
+
+            int portnum;
+            int bitmask;
+
+            if (!C_Keyboard::FindZxKey(key.c_str(), portnum, bitmask)) {
+                printf("ZX key \"%s\" not found in key script\n", key.c_str());
+                return false;
+            }
+
+            item.keyboardMask[portnum] |= bitmask;
+        }
+
+        keyScriptItems.push_back(item);
+    }
+
+    return true;
+}
+
+void KeyScript_Init(void) {
+    if (!keyScriptItems.empty()) {
+        AttachFrameStartHandler(KeyScript_OnFrameStart);
+    }
+}
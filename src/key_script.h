@@ -0,0 +1,16 @@
+#ifndef _KEY_SCRIPT_H_INCLUDED_
+#define _KEY_SCRIPT_H_INCLUDED_
+
+#include "zemu.h"
+
+// Scripted input for unattended runs. Script is comma-separated list of "frame:action" items,
+// where action is "+"-separated list of ZX keys (same names as in keys.config), or "tape" to start the tape.
+// For example "100:j,110:ss+p,120:ss+p,130:ent,140:tape" types LOAD "" in 48k BASIC and starts the tape.
+// Keys are held for KEY_SCRIPT_HOLD_FRAMES frames.
+
+#define KEY_SCRIPT_HOLD_FRAMES 5
+
+bool KeyScript_Parse(const char* script);
+void KeyScript_Init(void);
+
+#endif
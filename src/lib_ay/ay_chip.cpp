@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "ay_chip.h"
+#include "state.h"
 
 const unsigned MULT_C_1 = 14; // fixed point precision for 'system tick -> ay tick'
 
@@ -208,6 +209,85 @@ void C_AyChip::Reset(unsigned devClk) {
     ApplyRegs(devClk);
 }
 
+// volume tables and timings are not saved, since they depend only on configuration
+void C_AyChip::SaveState(C_StateWriter& writer) {
+    writer.WriteDword(t);
+    writer.WriteDword(ta);
+    writer.WriteDword(tb);
+    writer.WriteDword(tc);
+    writer.WriteDword(tn);
+    writer.WriteDword(te);
+    writer.WriteDword(env);
+    writer.WriteDword(denv);
+    writer.WriteDword(bitA);
+    writer.WriteDword(bitB);
+    writer.WriteDword(bitC);
+    writer.WriteDword(bitN);
+    writer.WriteDword(ns);
+    writer.WriteDword(bit0);
+    writer.WriteDword(bit1);
+    writer.WriteDword(bit2);
+    writer.WriteDword(bit3);
+    writer.WriteDword(bit4);
+    writer.WriteDword(bit5);
+    writer.WriteDword(ea);
+    writer.WriteDword(eb);
+    writer.WriteDword(ec);
+    writer.WriteDword(va);
+    writer.WriteDword(vb);
+    writer.WriteDword(vc);
+    writer.WriteDword(fa);
+    writer.WriteDword(fb);
+    writer.WriteDword(fc);
+    writer.WriteDword(fn);
+    writer.WriteDword(fe);
+    writer.WriteByte(r13Reloaded);
+    writer.WriteByte(selectedReg);
+    writer.WriteBlock(regs, sizeof(regs));
+    writer.WriteQword(passedChipTicks);
+    writer.WriteQword(passedClkTicks);
+    sndRenderer.SaveState(writer);
+}
+
+void C_AyChip::LoadState(C_StateReader& reader) {
+    t = reader.ReadDword();
+    ta = reader.ReadDword();
+    tb = reader.ReadDword();
+    tc = reader.ReadDword();
+    tn = reader.ReadDword();
+    te = reader.ReadDword();
+    env = reader.ReadDword();
+    denv = reader.ReadDword();
+    bitA = reader.ReadDword();
+    bitB = reader.ReadDword();
+    bitC = reader.ReadDword();
+    bitN = reader.ReadDword();
+    ns = reader.ReadDword();
+    bit0 = reader.ReadDword();
+    bit1 = reader.ReadDword();
+    bit2 = reader.ReadDword();
+    bit3 = reader.ReadDword();
+    bit4 = reader.ReadDword();
+    bit5 = reader.ReadDword();
+    ea = reader.ReadDword();
+    eb = reader.ReadDword();
+    ec = reader.ReadDword();
+    va = reader.ReadDword();
+    vb = reader.ReadDword();
+    vc = reader.ReadDword();
+    fa = reader.ReadDword();
+    fb = reader.ReadDword();
+    fc = reader.ReadDword();
+    fn = reader.ReadDword();
+    fe = reader.ReadDword();
+    r13Reloaded = reader.ReadByte();
+    selectedReg = reader.ReadByte();
+    reader.ReadBlock(regs, sizeof(regs));
+    passedChipTicks = reader.ReadQword();
+    passedClkTicks = reader.ReadQword();
+    sndRenderer.LoadState(reader);
+}
+
 void C_AyChip::ApplyRegs(unsigned devClk) {
     for (uint8_t r = 0; r < 16; r++) {
         Select(r);
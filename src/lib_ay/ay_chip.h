@@ -73,6 +73,9 @@ public:
 
     void Reset(unsigned devClk = 0); // call with default parameter, when context outside StartFrame/EndFrame block
 
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader);
+
 protected:
 
     void Flush(unsigned tick);
@@ -15,6 +15,7 @@
 #include "SAASound.h"
 #include "types.h"
 #include "SAAEnv.h"
+#include "state.h"
 
 
 //////////////////////////////////////////////////////////////////////
@@ -322,3 +323,42 @@ bool CSAAEnv::IsActive(void) const
 {
 	return m_bEnabled;
 }
+
+// envelope control is buffered by the chip, so everything is saved instead of being restored from registers
+void CSAAEnv::SaveState(C_StateWriter& writer) const
+{
+	writer.WriteByte((uint8_t)(m_pEnvData - cs_EnvData));
+	writer.WriteWord(m_nLeftLevel);
+	writer.WriteWord(m_nRightLevel);
+	writer.WriteBool(m_bEnabled);
+	writer.WriteBool(m_bInvertRightChannel);
+	writer.WriteByte(m_nPhase);
+	writer.WriteByte(m_nPhasePosition);
+	writer.WriteBool(m_bEnvelopeEnded);
+	writer.WriteBool(m_bLooping);
+	writer.WriteByte((uint8_t)m_nNumberOfPhases);
+	writer.WriteByte((uint8_t)m_nResolution);
+	writer.WriteBool(m_bNewData);
+	writer.WriteByte(m_nNextData);
+	writer.WriteBool(m_bOkForNewData);
+	writer.WriteBool(m_bClockExternally);
+}
+
+void CSAAEnv::LoadState(C_StateReader& reader)
+{
+	m_pEnvData = &(cs_EnvData[reader.ReadByte() & 0x07]);
+	m_nLeftLevel = reader.ReadWord();
+	m_nRightLevel = reader.ReadWord();
+	m_bEnabled = reader.ReadBool();
+	m_bInvertRightChannel = reader.ReadBool();
+	m_nPhase = reader.ReadByte() & 0x01;
+	m_nPhasePosition = reader.ReadByte() & 0x0F;
+	m_bEnvelopeEnded = reader.ReadBool();
+	m_bLooping = reader.ReadBool();
+	m_nNumberOfPhases = (reader.ReadByte() == 2 ? 2 : 1);
+	m_nResolution = (reader.ReadByte() == 2 ? 2 : 1);
+	m_bNewData = reader.ReadBool();
+	m_nNextData = reader.ReadByte();
+	m_bOkForNewData = reader.ReadBool();
+	m_bClockExternally = reader.ReadBool();
+}
@@ -48,6 +48,8 @@ public:
     unsigned short RightLevel(void) const;
     bool IsActive(void) const;
 
+    void SaveState(C_StateWriter& writer) const;
+    void LoadState(C_StateReader& reader);
 };
 
 #endif  // SAAENV_H_INCLUDED
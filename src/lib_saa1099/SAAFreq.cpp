@@ -18,6 +18,7 @@
 #include "SAANoise.h"
 #include "SAAEnv.h"
 #include "SAAFreq.h"
+#include "state.h"
 
 // 'load in' the data for the static frequency lookup table:
 const unsigned long CSAAFreq::m_FreqTable[2048] =
@@ -238,3 +239,29 @@ void CSAAFreq::Sync(bool bSync)
 		SetAdd();
 	}
 }
+
+// sync flag and sample rate are restored from registers and parameters
+void CSAAFreq::SaveState(C_StateWriter& writer) const
+{
+	writer.WriteDword((uint32_t)m_nCounter);
+	writer.WriteWord(m_nLevel);
+	writer.WriteByte((uint8_t)m_nCurrentOffset);
+	writer.WriteByte((uint8_t)m_nCurrentOctave);
+	writer.WriteByte((uint8_t)m_nNextOffset);
+	writer.WriteByte((uint8_t)m_nNextOctave);
+	writer.WriteBool(m_bIgnoreOffsetData);
+	writer.WriteBool(m_bNewData);
+}
+
+void CSAAFreq::LoadState(C_StateReader& reader)
+{
+	m_nCounter = reader.ReadDword();
+	m_nLevel = reader.ReadWord();
+	m_nCurrentOffset = reader.ReadByte();
+	m_nCurrentOctave = reader.ReadByte() & 0x07;
+	m_nNextOffset = reader.ReadByte();
+	m_nNextOctave = reader.ReadByte() & 0x07;
+	m_bIgnoreOffsetData = reader.ReadBool();
+	m_bNewData = reader.ReadBool();
+	SetAdd();
+}
@@ -48,6 +48,8 @@ public:
     unsigned short Tick(void);
     unsigned short Level(void) const;
 
+    void SaveState(C_StateWriter& writer) const;
+    void LoadState(C_StateReader& reader);
 };
 
 #endif  // SAAFREQ_H_INCLUDE
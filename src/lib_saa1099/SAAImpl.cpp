@@ -33,6 +33,7 @@
 #include "SAAAmp.h"
 #include "SAASound.h"
 #include "SAAImpl.h"
+#include "state.h"
 
 //////////////////////////////////////////////////////////////////////
 // Globals
@@ -721,6 +722,36 @@ void CSAASoundInternal::GenerateManyUsingSndRenderer(C_SndRenderer *sr, unsigned
 }
 
 
+// registers (and so amplifiers) are restored by the caller before loading
+void CSAASoundInternal::SaveState(C_StateWriter& writer)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		Osc[i]->SaveState(writer);
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		Noise[i]->SaveState(writer);
+		Env[i]->SaveState(writer);
+	}
+}
+
+void CSAASoundInternal::LoadState(C_StateReader& reader)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		Osc[i]->LoadState(reader);
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		Noise[i]->LoadState(reader);
+		Env[i]->LoadState(reader);
+	}
+}
+
+
 int CSAASoundInternal::SendCommand(SAACMD nCommandID, long nData)
 {
 	/********************/
@@ -48,6 +48,8 @@ public:
 
     void GenerateMany(BYTE * pBuffer, unsigned long nSamples);
     void GenerateManyUsingSndRenderer(C_SndRenderer *sr, unsigned devClk);
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader);
 
     int SendCommand(SAACMD nCommandID, long nData);
 
@@ -22,6 +22,7 @@
 
 #include "types.h"
 #include "SAANoise.h"
+#include "state.h"
 
 
 //////////////////////////////////////////////////////////////////////
@@ -173,3 +174,16 @@ inline void CSAANoise::ChangeLevel(void)
 		m_nRand<<=1;
 	}
 }
+
+// source mode, sync flag and sample rate are restored from registers and parameters
+void CSAANoise::SaveState(C_StateWriter& writer) const
+{
+	writer.WriteDword((uint32_t)m_nCounter);
+	writer.WriteDword((uint32_t)m_nRand);
+}
+
+void CSAANoise::LoadState(C_StateReader& reader)
+{
+	m_nCounter = reader.ReadDword();
+	m_nRand = reader.ReadDword();
+}
@@ -42,6 +42,8 @@ public:
     unsigned short LevelTimesTwo(void) const;
     void Sync(bool bSync);
 
+    void SaveState(C_StateWriter& writer) const;
+    void LoadState(C_StateReader& reader);
 };
 
 #endif  // SAANOISE_H_INCLUDED
@@ -57,6 +57,9 @@ typedef unsigned long SAACMD;
 
 #include "sound/snd_renderer.h"
 
+class C_StateWriter;
+class C_StateReader;
+
 #ifndef BYTE
 #define BYTE unsigned char
 #endif
@@ -89,6 +92,8 @@ public:
 
     virtual void GenerateMany (BYTE * pBuffer, unsigned long nSamples) = 0;
     virtual void GenerateManyUsingSndRenderer (C_SndRenderer *sr, unsigned devClk) = 0;
+    virtual void SaveState (C_StateWriter& writer) = 0;
+    virtual void LoadState (C_StateReader& reader) = 0;
 
     virtual int SendCommand (SAACMD nCommandID, long nData) = 0;
 
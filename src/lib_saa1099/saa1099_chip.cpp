@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "saa1099_chip.h"
+#include "state.h"
 
 C_Saa1099Chip::C_Saa1099Chip() {
     chip = CreateCSAASound();
@@ -14,10 +15,12 @@ C_Saa1099Chip::~C_Saa1099Chip() {
 }
 
 void C_Saa1099Chip::WriteAddress(unsigned char reg) {
+    selectedReg = reg & 0x1F;
     chip->WriteAddress(reg);
 }
 
 void C_Saa1099Chip::WriteData(unsigned char data) {
+    regs[selectedReg] = data;
     chip->WriteData(data);
 }
 
@@ -25,6 +28,32 @@ void C_Saa1099Chip::Reset(void) {
     chip->Clear();
 }
 
+void C_Saa1099Chip::SaveState(C_StateWriter& writer) {
+    writer.WriteByte(selectedReg);
+    writer.WriteBlock(regs, sizeof(regs));
+    sndRenderer.SaveState(writer);
+    chip->SaveState(writer);
+}
+
+void C_Saa1099Chip::LoadState(C_StateReader& reader) {
+    unsigned char reg = reader.ReadByte() & 0x1F;
+    unsigned char values[0x20];
+
+    reader.ReadBlock(values, sizeof(values));
+    sndRenderer.LoadState(reader);
+
+    Reset();
+
+    for (int i = 0; i < 0x20; i++) {
+        WriteAddress(i);
+        WriteData(values[i]);
+    }
+
+    // frequencies and envelopes are buffered until the next generator cycle, so they are loaded over registers
+    chip->LoadState(reader);
+    WriteAddress(reg);
+}
+
 void C_Saa1099Chip::Render(unsigned devClk) {
     chip->GenerateManyUsingSndRenderer(&sndRenderer, devClk);
 }
@@ -3,6 +3,9 @@
 
 #include "SAASound.h"
 
+class C_StateWriter;
+class C_StateReader;
+
 class C_Saa1099Chip {
 public:
 
@@ -17,9 +20,16 @@ public:
     void Reset(void);
     void Render(unsigned devClk);
 
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader);
+
 protected:
 
     LPCSAASOUND chip;
+
+    // registers are cached, because emulator doesn't provide a way to read them back
+    unsigned char selectedReg = 0;
+    unsigned char regs[0x20] = {0};
 };
 
 #endif
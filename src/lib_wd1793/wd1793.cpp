@@ -5,6 +5,7 @@
 #include <string.h>
 #include "wd1793.h"
 #include "wd1793_crc_utils.h"
+#include "state.h"
 
 extern bool wdDebug;
 
@@ -109,6 +110,77 @@ int C_Wd1793::get_drive_head(int drive) {
     return fdd[drive].track;
 }
 
+void C_Wd1793::save_state(C_StateWriter& writer) {
+    writer.WriteQword(next);
+    writer.WriteQword(time);
+    writer.WriteByte((uint8_t)(seldrive - fdd));
+    writer.WriteByte(tshift);
+    writer.WriteByte(state);
+    writer.WriteByte(state2);
+    writer.WriteByte(cmd);
+    writer.WriteByte(data);
+    writer.WriteByte(track);
+    writer.WriteByte(sector);
+    writer.WriteByte(rqs);
+    writer.WriteByte(status);
+    writer.WriteByte((uint8_t)stepdirection);
+    writer.WriteByte(system);
+    writer.WriteByte(side);
+    writer.WriteQword(end_waiting_am);
+    writer.WriteDword(foundid);
+    writer.WriteDword(rwptr);
+    writer.WriteDword(rwlen);
+    writer.WriteDword(start_crc);
+
+    // track cache is rebuilt on load
+    writer.WriteByte(trkcache.drive ? (uint8_t)(trkcache.drive - fdd) : 0xFF);
+    writer.WriteByte(trkcache.cyl);
+    writer.WriteByte(trkcache.side);
+    writer.WriteByte(trkcache.sf);
+
+    for (int i = 0; i < 4; i++) {
+        fdd[i].save_state(writer);
+    }
+}
+
+void C_Wd1793::load_state(C_StateReader& reader) {
+    next = (int64_t)reader.ReadQword();
+    time = (int64_t)reader.ReadQword();
+    seldrive = &fdd[reader.ReadByte() & 3];
+    tshift = reader.ReadByte();
+    state = reader.ReadByte();
+    state2 = reader.ReadByte();
+    cmd = reader.ReadByte();
+    data = reader.ReadByte();
+    track = reader.ReadByte();
+    sector = reader.ReadByte();
+    rqs = reader.ReadByte();
+    status = reader.ReadByte();
+    stepdirection = (int8_t)reader.ReadByte();
+    system = reader.ReadByte();
+    side = reader.ReadByte();
+    end_waiting_am = (int64_t)reader.ReadQword();
+    foundid = reader.ReadDword();
+    rwptr = reader.ReadDword();
+    rwlen = reader.ReadDword();
+    start_crc = reader.ReadDword();
+
+    uint8_t cacheDrive = reader.ReadByte();
+    unsigned cacheCyl = reader.ReadByte();
+    unsigned cacheSide = reader.ReadByte();
+    SEEK_MODE cacheSf = (SEEK_MODE)reader.ReadByte();
+
+    for (int i = 0; i < 4; i++) {
+        fdd[i].load_state(reader);
+    }
+
+    trkcache.clear();
+
+    if (cacheDrive < 4) {
+        trkcache.seek(&fdd[cacheDrive], cacheCyl, cacheSide, cacheSf);
+    }
+}
+
 int C_Wd1793::process() {
     static bool is_index = false;
     static bool read_track = false;
@@ -142,6 +142,9 @@ public:
     // get current track for a drive
     int get_drive_head(int drive);
 
+    void save_state(C_StateWriter& writer);
+    void load_state(C_StateReader& reader);
+
     C_Wd1793();
 };
 
@@ -98,3 +98,11 @@ enum DRIVE_STATE wd1793_get_drive_state(int drive, uint64_t time) {
 int wd1793_get_drive_head(int drive) {
     return wd.get_drive_head(drive);
 }
+
+void wd1793_save_state(C_StateWriter& writer) {
+    wd.save_state(writer);
+}
+
+void wd1793_load_state(C_StateReader& reader) {
+    wd.load_state(reader);
+}
@@ -1,6 +1,9 @@
 #ifndef _WD1793_CHIP_INCLUDED_
 #define _WD1793_CHIP_INCLUDED_
 
+class C_StateWriter;
+class C_StateReader;
+
 enum DIMAGE_TYPE {
     imgTRD,
     imgFDI,
@@ -104,4 +107,14 @@ wd1793_get_drive_head: get current track for drive
 */
 int wd1793_get_drive_head(int drive);
 
+/*
+wd1793_save_state: save controller and drives state (including disk contents)
+*/
+void wd1793_save_state(C_StateWriter& writer);
+
+/*
+wd1793_load_state: load state, saved by wd1793_save_state
+*/
+void wd1793_load_state(C_StateReader& reader);
+
 #endif
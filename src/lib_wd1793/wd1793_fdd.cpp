@@ -6,6 +6,7 @@
 #include "wd1793_fdd.h"
 #include "defines.h"
 #include "zemu_env.h"
+#include "state.h"
 
 uint8_t snbuf[SNBUF_LEN]; // large temporary buffer
 
@@ -64,6 +65,88 @@ void C_Fdd::eject() {
     free();
 }
 
+// track pointers are stored as offsets in rawdata
+#define FDD_NO_TRACK (0xFFFFFFFF)
+
+void C_Fdd::save_state(C_StateWriter& writer) {
+    writer.WriteQword(motor);
+    writer.WriteByte(track);
+    writer.WriteBool(rawdata != nullptr);
+
+    if (!rawdata) {
+        return;
+    }
+
+    writer.WriteDword(rawsize);
+    writer.WriteBlock(rawdata, rawsize);
+    writer.WriteByte(cyls);
+    writer.WriteByte(sides);
+
+    for (unsigned i = 0; i < cyls; i++) {
+        for (unsigned j = 0; j < sides; j++) {
+            writer.WriteDword(trklen[i][j]);
+            writer.WriteDword(trkd[i][j] ? (uint32_t)(trkd[i][j] - rawdata) : FDD_NO_TRACK);
+            writer.WriteDword(trki[i][j] ? (uint32_t)(trki[i][j] - rawdata) : FDD_NO_TRACK);
+        }
+    }
+
+    writer.WriteByte(optype);
+    writer.WriteByte(snaptype);
+    writer.WriteBool(is_wp);
+    writer.WriteString(name);
+}
+
+void C_Fdd::load_state(C_StateReader& reader) {
+    free();
+
+    motor = (int64_t)reader.ReadQword();
+    track = reader.ReadByte();
+
+    if (!reader.ReadBool()) {
+        return;
+    }
+
+    size_t size = reader.ReadDword();
+
+    if (reader.IsFailed() || !size) {
+        return;
+    }
+
+    rawsize = size;
+    rawdata = (uint8_t*)malloc(rawsize);
+
+    if (!rawdata) {
+        StrikeError("Failed to allocate %zu bytes of memory", rawsize);
+    }
+
+    reader.ReadBlock(rawdata, rawsize);
+    cyls = reader.ReadByte();
+    sides = reader.ReadByte();
+
+    if (cyls > MAX_CYLS || sides > 2) {
+        free();
+        return;
+    }
+
+    for (unsigned i = 0; i < cyls; i++) {
+        for (unsigned j = 0; j < sides; j++) {
+            trklen[i][j] = reader.ReadDword();
+            uint32_t offsetD = reader.ReadDword();
+            uint32_t offsetI = reader.ReadDword();
+
+            trkd[i][j] = (offsetD < rawsize ? rawdata + offsetD : nullptr);
+            trki[i][j] = (offsetI < rawsize ? rawdata + offsetI : nullptr);
+        }
+    }
+
+    optype = reader.ReadByte();
+    snaptype = reader.ReadByte();
+    set_wprotected(reader.ReadBool());
+
+    std::string fileName = reader.ReadString();
+    strncpy(name, fileName.c_str(), sizeof(name) - 1);
+}
+
 int C_Fdd::save_dimage(const char* filename, enum DIMAGE_TYPE type) {
     auto path = host->storage()->path(filename);
 
@@ -87,6 +87,9 @@ public:
     int is_disk_loaded();
     void eject();
 
+    void save_state(C_StateWriter& writer);
+    void load_state(C_StateReader& reader);
+
     C_Fdd();
     ~C_Fdd();
 };
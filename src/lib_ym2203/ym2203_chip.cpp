@@ -2,6 +2,7 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "ym2203_chip.h"
+#include "state.h"
 
 C_Ym2203Chip::C_Ym2203Chip() {
     chip = YM2203Init(YM2203_CHIP_CLOCK, YM2203_SND_FQ);
@@ -44,6 +45,22 @@ void C_Ym2203Chip::Reset(void) {
     YM2203Write(chip, 1, 0);
 }
 
+void C_Ym2203Chip::SaveState(C_StateWriter& writer) {
+    writer.WriteByte(selectedReg);
+    writer.WriteBlock(regs, sizeof(regs));
+    sndRenderer.SaveState(writer);
+    YM2203SaveState(chip, writer);
+}
+
+void C_Ym2203Chip::LoadState(C_StateReader& reader) {
+    selectedReg = reader.ReadByte();
+    reader.ReadBlock(regs, sizeof(regs));
+    sndRenderer.LoadState(reader);
+
+    Reset();
+    YM2203LoadState(chip, reader, regs);
+}
+
 void C_Ym2203Chip::Render(unsigned devClk) {
     YM2203UpdateOne(chip, &sndRenderer, devClk);
 }
@@ -4,6 +4,9 @@
 #include "ym2203_emu.h"
 #include "params.h"
 
+class C_StateWriter;
+class C_StateReader;
+
 #define YM2203_SND_FQ SOUND_FREQ
 #define YM2203_CHIP_CLOCK (MAX_FRAME_TACTS * 50)
 
@@ -23,6 +26,9 @@ public:
     void Reset(void);
     void Render(unsigned devClk);
 
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader);
+
 protected:
 
     void* chip;
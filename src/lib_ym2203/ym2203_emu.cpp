@@ -109,6 +109,7 @@
 #include <math.h>
 
 #include "ym2203_emu.h"
+#include "state.h"
 
 #ifndef UINT8
 typedef unsigned char   UINT8;
@@ -2004,6 +2005,103 @@ int YM2203TimerOver(void *chip,int c)
 }
 
 
+/* registers are saved by the caller, here goes state which can't be restored from them */
+void YM2203SaveState(void *chip, C_StateWriter& writer)
+{
+  YM2203 *F2203 = (YM2203*)chip;
+  FM_OPN *OPN = &F2203->OPN;
+
+  writer.WriteByte(OPN->ST.prescaler_sel);
+  writer.WriteByte(OPN->ST.status);
+  writer.WriteByte(OPN->ST.irq);
+  writer.WriteDword((UINT32)OPN->ST.TAC);
+  writer.WriteDword((UINT32)OPN->ST.TBC);
+  writer.WriteByte(OPN->ST.fn_h);
+  writer.WriteByte(OPN->SL3.fn_h);
+  writer.WriteDword(OPN->eg_cnt);
+  writer.WriteDword(OPN->eg_timer);
+
+  for (int c = 0; c < 3; c++)
+  {
+    FM_CH *CH = &F2203->CH[c];
+
+    writer.WriteDword((UINT32)CH->op1_out[0]);
+    writer.WriteDword((UINT32)CH->op1_out[1]);
+    writer.WriteDword((UINT32)CH->mem_value);
+
+    for (int s = 0; s < 4; s++)
+    {
+      FM_SLOT *SLOT = &CH->SLOT[s];
+
+      writer.WriteDword(SLOT->phase);
+      writer.WriteByte(SLOT->state);
+      writer.WriteDword((UINT32)SLOT->volume);
+      writer.WriteDword(SLOT->vol_out);
+      writer.WriteByte(SLOT->ssgn);
+      writer.WriteBool(SLOT->key != 0);
+    }
+  }
+}
+
+/* chip must be reset before, registers are replayed after prescaler (it affects frequency tables) */
+void YM2203LoadState(void *chip, C_StateReader& reader, const unsigned char *regs)
+{
+  YM2203 *F2203 = (YM2203*)chip;
+  FM_OPN *OPN = &F2203->OPN;
+
+  OPN->ST.prescaler_sel = reader.ReadByte() & 3;
+  OPNPrescaler_w(OPN, 1, 1);
+
+  for (int r = 0x20; r < 0x100; r++)
+  {
+    /* key on / off is restored with envelopes, high part of frequency is latched before the low one */
+    if (r == 0x28 || (r >= 0x2d && r <= 0x2f) || (r >= 0xa4 && r <= 0xa6) || (r >= 0xac && r <= 0xae))
+    {
+      F2203->REGS[r] = regs[r];
+      continue;
+    }
+
+    if ((r >= 0xa0 && r <= 0xa2) || (r >= 0xa8 && r <= 0xaa))
+    {
+      YM2203Write(chip, 0, r + 4);
+      YM2203Write(chip, 1, regs[r + 4]);
+    }
+
+    YM2203Write(chip, 0, r);
+    YM2203Write(chip, 1, regs[r]);
+  }
+
+  OPN->ST.status = reader.ReadByte();
+  OPN->ST.irq = reader.ReadByte();
+  OPN->ST.TAC = (INT32)reader.ReadDword();
+  OPN->ST.TBC = (INT32)reader.ReadDword();
+  OPN->ST.fn_h = reader.ReadByte();
+  OPN->SL3.fn_h = reader.ReadByte();
+  OPN->eg_cnt = reader.ReadDword();
+  OPN->eg_timer = reader.ReadDword();
+
+  for (int c = 0; c < 3; c++)
+  {
+    FM_CH *CH = &F2203->CH[c];
+
+    CH->op1_out[0] = (INT32)reader.ReadDword();
+    CH->op1_out[1] = (INT32)reader.ReadDword();
+    CH->mem_value = (INT32)reader.ReadDword();
+
+    for (int s = 0; s < 4; s++)
+    {
+      FM_SLOT *SLOT = &CH->SLOT[s];
+
+      SLOT->phase = reader.ReadDword();
+      SLOT->state = reader.ReadByte();
+      SLOT->volume = (INT32)reader.ReadDword();
+      SLOT->vol_out = reader.ReadDword();
+      SLOT->ssgn = reader.ReadByte();
+      SLOT->key = (reader.ReadBool() ? 1 : 0);
+    }
+  }
+}
+
 void YM2203SetMute(void *chip,int mask)
 {
   YM2203 *F2203=(YM2203*)chip;
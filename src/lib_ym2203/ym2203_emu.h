@@ -1,5 +1,8 @@
 #include "sound/snd_renderer.h"
 
+class C_StateWriter;
+class C_StateReader;
+
 void* YM2203Init(int baseclock, int rate);
 void YM2203Shutdown(void* chip);
 void YM2203ResetChip(void* chip);
@@ -8,3 +11,5 @@ int YM2203Write(void* chip, int a, unsigned char v);
 void YM2203SetMute(void* chip, int mask);
 void YM2203GetAllTL(void* chip, int* levels);
 unsigned char YM2203Read(void* chip, int a);
+void YM2203SaveState(void* chip, C_StateWriter& writer);
+void YM2203LoadState(void* chip, C_StateReader& reader, const unsigned char* regs);
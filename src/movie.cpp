@@ -0,0 +1,288 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <string.h>
+#include <string>
+#include "zemu_env.h"
+#include "movie.h"
+#include "devs.h"
+#include "dialog.h"
+#include "state.h"
+#include "tape/tape.h"
+
+// Movie file format (all values are little-endian):
+//
+// "ZMV" + version byte
+// 5 x (word length + chars) - disk A..D image and tape file names
+// events until the end marker:
+//   byte device, dword frame, dword clk, device state (8 bytes for keyboard, 1 for kempston, 3 for mouse)
+//   end marker is device 0xFF with frame and clk of the moment when recording was stopped
+//
+// Starting state is saved as full machine state alongside the movie (movie file name + ".zst"),
+// it also contains clocks and turbo mode.
+// Input is logged at the moment when device port is read, so replay doesn't depend on host timing.
+
+#define MOVIE_VERSION 2
+#define MOVIE_DEVICE_END 0xFF
+#define MOVIE_MAX_STATE_SIZE 8
+
+static const unsigned movieStateSize[MOVIE_DEVICES_COUNT] = { 8, 1, 3 };
+
+struct s_MovieEvent {
+    int device;
+    uint32_t frame;
+    uint32_t clk;
+    uint8_t state[MOVIE_MAX_STATE_SIZE];
+};
+
+int movieState = MOVIE_STATE_NONE;
+
+static int moviePendingState = MOVIE_STATE_NONE;
+static std::string moviePendingFileName;
+static std::string movieFileName;
+static DataWriterPtr movieWriter;
+static DataReaderPtr movieReader;
+static uint32_t movieFrame;
+static bool movieHasState[MOVIE_DEVICES_COUNT];
+static uint8_t movieDeviceState[MOVIE_DEVICES_COUNT][MOVIE_MAX_STATE_SIZE];
+static s_MovieEvent movieNextEvent;
+
+static void Movie_WriteString(const std::string& value) {
+    movieWriter->writeWord((uint16_t)value.length());
+    movieWriter->writeBlock((void*)value.c_str(), value.length());
+}
+
+static std::string Movie_ReadString(void) {
+    char buffer[MAX_PATH];
+    unsigned length = movieReader->readWord();
+
+    if (length >= MAX_PATH) {
+        throw StorageException("Too long file name in movie");
+    }
+
+    movieReader->readBlock(buffer, length);
+    buffer[length] = 0;
+
+    return std::string(buffer);
+}
+
+static void Movie_ReadNextEvent(void) {
+    if (movieReader->isEof()) {
+        movieNextEvent.device = MOVIE_DEVICE_END;
+        movieNextEvent.frame = 0;
+        movieNextEvent.clk = 0;
+        return;
+    }
+
+    movieNextEvent.device = movieReader->readByte();
+    movieNextEvent.frame = movieReader->readDword();
+    movieNextEvent.clk = movieReader->readDword();
+
+    if (movieNextEvent.device == MOVIE_DEVICE_END) {
+        return;
+    }
+
+    if (movieNextEvent.device >= MOVIE_DEVICES_COUNT) {
+        throw StorageException("Unknown device in movie");
+    }
+
+    movieReader->readBlock(movieNextEvent.state, movieStateSize[movieNextEvent.device]);
+}
+
+static bool Movie_IsEventReached(void) {
+    return (movieNextEvent.frame < movieFrame
+        || (movieNextEvent.frame == movieFrame && movieNextEvent.clk <= (uint32_t)cpuClk)
+    );
+}
+
+static void Movie_StartRecording(void) {
+    std::string stateFileName = movieFileName + STATE_EXTENSION;
+
+    if (!State_SaveFile(stateFileName.c_str())) {
+        SetMessage("Error saving movie state");
+        return;
+    }
+
+    try {
+        movieWriter = host->storage()->path(movieFileName)->dataWriter();
+
+        movieWriter->writeBlock((void*)"ZMV", 3);
+        movieWriter->writeByte(MOVIE_VERSION);
+
+        for (int i = 0; i < 4; i++) {
+            Movie_WriteString(oldFileName[i]);
+        }
+
+        Movie_WriteString(C_Tape::fileName);
+    } catch (StorageException& e) {
+        printf("Movie recording failed: %s\n", e.what());
+        movieWriter.reset();
+        SetMessage("Error recording movie");
+        return;
+    }
+
+    for (int i = 0; i < MOVIE_DEVICES_COUNT; i++) {
+        movieHasState[i] = false;
+    }
+
+    movieFrame = 0;
+    movieState = MOVIE_STATE_RECORDING;
+    SetMessage("Movie recording started");
+}
+
+static void Movie_StartReplay(void) {
+    char magic[3];
+    std::string mediaFileName[4];
+
+    try {
+        movieReader = host->storage()->path(movieFileName)->dataReader();
+        movieReader->readBlock(magic, 3);
+
+        if (memcmp(magic, "ZMV", 3) || movieReader->readByte() != MOVIE_VERSION) {
+            throw StorageException("Unsupported movie format");
+        }
+
+        for (int i = 0; i < 4; i++) {
+            mediaFileName[i] = Movie_ReadString();
+        }
+
+        Movie_ReadString(); // tape file name, tape is restored from the state
+        Movie_ReadNextEvent();
+    } catch (StorageException& e) {
+        printf("Movie replay failed: %s\n", e.what());
+        movieReader.reset();
+        SetMessage("Error loading movie");
+        return;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (!mediaFileName[i].empty() && mediaFileName[i] != oldFileName[i]) {
+            TryNLoadFile(mediaFileName[i].c_str(), i);
+        }
+    }
+
+    // disk contents and tape position are restored from the state, media names are kept for the file dialogs
+    std::string stateFileName = movieFileName + STATE_EXTENSION;
+
+    if (!State_LoadFile(stateFileName.c_str())) {
+        movieReader.reset();
+        SetMessage("Error loading movie state");
+        return;
+    }
+
+    memset(movieDeviceState[MOVIE_DEVICE_KEYBOARD], 0xFF, MOVIE_MAX_STATE_SIZE);
+    memset(movieDeviceState[MOVIE_DEVICE_KEMPSTON], 0, MOVIE_MAX_STATE_SIZE);
+    movieDeviceState[MOVIE_DEVICE_MOUSE][0] = C_Mouse::portFBDF;
+    movieDeviceState[MOVIE_DEVICE_MOUSE][1] = C_Mouse::portFFDF;
+    movieDeviceState[MOVIE_DEVICE_MOUSE][2] = C_Mouse::portFADF;
+
+    movieFrame = 0;
+    movieState = MOVIE_STATE_REPLAYING;
+    SetMessage("Movie replay started");
+}
+
+static void Movie_OnFrameStart(void) {
+    if (movieState != MOVIE_STATE_NONE) {
+        movieFrame++;
+    }
+
+    if (movieState == MOVIE_STATE_REPLAYING
+        && movieNextEvent.device == MOVIE_DEVICE_END
+        && Movie_IsEventReached()
+    ) {
+        Movie_Stop();
+    }
+
+    if (moviePendingState == MOVIE_STATE_NONE) {
+        return;
+    }
+
+    // start at frame boundary, where machine state is consistent
+    Movie_Stop();
+
+    movieFileName = moviePendingFileName;
+    int state = moviePendingState;
+    moviePendingState = MOVIE_STATE_NONE;
+
+    if (state == MOVIE_STATE_RECORDING) {
+        Movie_StartRecording();
+    } else {
+        Movie_StartReplay();
+    }
+}
+
+void Movie_Init(void) {
+    AttachFrameStartHandler(Movie_OnFrameStart);
+}
+
+void Movie_Close(void) {
+    Movie_Stop();
+}
+
+void Movie_Record(const char* fileName) {
+    moviePendingFileName = fileName;
+    moviePendingState = MOVIE_STATE_RECORDING;
+}
+
+void Movie_Replay(const char* fileName) {
+    moviePendingFileName = fileName;
+    moviePendingState = MOVIE_STATE_REPLAYING;
+}
+
+bool Movie_IsPending(void) {
+    return (moviePendingState != MOVIE_STATE_NONE);
+}
+
+void Movie_Stop(void) {
+    if (movieState == MOVIE_STATE_RECORDING) {
+        movieWriter->writeByte(MOVIE_DEVICE_END);
+        movieWriter->writeDword(movieFrame);
+        movieWriter->writeDword((uint32_t)cpuClk);
+        movieWriter.reset();
+
+        printf("Movie recorded to \"%s\"\n", movieFileName.c_str());
+        SetMessage("Movie recording stopped");
+    } else if (movieState == MOVIE_STATE_REPLAYING) {
+        movieReader.reset();
+
+        printf("Movie \"%s\" replayed, %u frames\n", movieFileName.c_str(), movieFrame);
+        SetMessage("Movie replay finished");
+    }
+
+    movieState = MOVIE_STATE_NONE;
+}
+
+void Movie_SyncInput(int device, uint8_t* state) {
+    unsigned size = movieStateSize[device];
+
+    if (movieState == MOVIE_STATE_RECORDING) {
+        if (movieHasState[device] && !memcmp(movieDeviceState[device], state, size)) {
+            return;
+        }
+
+        memcpy(movieDeviceState[device], state, size);
+        movieHasState[device] = true;
+
+        movieWriter->writeByte((uint8_t)device);
+        movieWriter->writeDword(movieFrame);
+        movieWriter->writeDword((uint32_t)cpuClk);
+        movieWriter->writeBlock(state, size);
+        return;
+    }
+
+    if (movieState != MOVIE_STATE_REPLAYING) {
+        return;
+    }
+
+    try {
+        while (movieNextEvent.device != MOVIE_DEVICE_END && Movie_IsEventReached()) {
+            memcpy(movieDeviceState[movieNextEvent.device], movieNextEvent.state, movieStateSize[movieNextEvent.device]);
+            Movie_ReadNextEvent();
+        }
+    } catch (StorageException& e) {
+        printf("Movie replay failed: %s\n", e.what());
+        movieNextEvent.device = MOVIE_DEVICE_END;
+    }
+
+    memcpy(state, movieDeviceState[device], size);
+}
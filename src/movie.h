@@ -0,0 +1,25 @@
+#ifndef _MOVIE_H_INCLUDED_
+#define _MOVIE_H_INCLUDED_
+
+#include "zemu.h"
+
+#define MOVIE_DEVICE_KEYBOARD 0
+#define MOVIE_DEVICE_KEMPSTON 1
+#define MOVIE_DEVICE_MOUSE 2
+#define MOVIE_DEVICES_COUNT 3
+
+#define MOVIE_STATE_NONE 0
+#define MOVIE_STATE_RECORDING 1
+#define MOVIE_STATE_REPLAYING 2
+
+extern int movieState;
+
+void Movie_Init(void);
+void Movie_Close(void);
+void Movie_Record(const char* fileName);
+void Movie_Replay(const char* fileName);
+void Movie_Stop(void);
+bool Movie_IsPending(void);
+void Movie_SyncInput(int device, uint8_t* state);
+
+#endif
@@ -0,0 +1,188 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <string>
+#include <algorithm>
+#include "zemu_env.h"
+#include "overlay.h"
+
+#define OVERLAY_TYPE_NONE 0
+#define OVERLAY_TYPE_TEXT 1
+#define OVERLAY_TYPE_IMAGE 2
+#define OVERLAY_TYPE_CUSTOM 3
+
+struct s_OverlayItem {
+    int type = OVERLAY_TYPE_NONE;
+    int x = 0;
+    int y = 0;
+    C_Font* font = nullptr;
+    std::string text;
+    s_GimpImage* image = nullptr;
+    void (* draw)(void) = nullptr;
+
+    bool isChanged = false;
+    int drawnFromLine = 0; // lines touched by the last drawing, they are cleared when item is changed
+    int drawnToLine = 0;
+};
+
+static s_OverlayItem overlayItems[OVERLAY_ITEMS_COUNT];
+static uint32_t overlayPixels[WIDTH * HEIGHT];
+static bool overlayDirtyLines[HEIGHT];
+static bool overlayClearedLines[HEIGHT];
+static bool isOverlayChanged = false;
+static bool isOverlaySuspended = false;
+
+static void Overlay_MarkChanged(s_OverlayItem& item) {
+    item.isChanged = true;
+    isOverlayChanged = true;
+}
+
+static bool Overlay_IsIntersected(const s_OverlayItem& item) {
+    return (std::find(overlayClearedLines + item.drawnFromLine, overlayClearedLines + item.drawnToLine, true)
+        != overlayClearedLines + item.drawnToLine
+    );
+}
+
+void Overlay_Init(void) {
+    std::fill(overlayPixels, overlayPixels + WIDTH * HEIGHT, STAGE_OVERLAY_TRANSPARENT);
+}
+
+void Overlay_Text(int item, int x, int y, C_Font* font, const char* text) {
+    s_OverlayItem& it = overlayItems[item];
+
+    if (it.type == OVERLAY_TYPE_TEXT && it.x == x && it.y == y && it.font == font && it.text == text) {
+        return;
+    }
+
+    it.type = OVERLAY_TYPE_TEXT;
+    it.x = x;
+    it.y = y;
+    it.font = font;
+    it.text = text;
+    Overlay_MarkChanged(it);
+}
+
+void Overlay_Image(int item, int x, int y, s_GimpImage* image) {
+    s_OverlayItem& it = overlayItems[item];
+
+    if (it.type == OVERLAY_TYPE_IMAGE && it.x == x && it.y == y && it.image == image) {
+        return;
+    }
+
+    it.type = OVERLAY_TYPE_IMAGE;
+    it.x = x;
+    it.y = y;
+    it.image = image;
+    Overlay_MarkChanged(it);
+}
+
+void Overlay_Custom(int item, void (* draw)(void), bool isChanged) {
+    s_OverlayItem& it = overlayItems[item];
+
+    if (it.type == OVERLAY_TYPE_CUSTOM && it.draw == draw && !isChanged) {
+        return;
+    }
+
+    it.type = OVERLAY_TYPE_CUSTOM;
+    it.draw = draw;
+    Overlay_MarkChanged(it);
+}
+
+void Overlay_Hide(int item) {
+    s_OverlayItem& it = overlayItems[item];
+
+    if (it.type == OVERLAY_TYPE_NONE) {
+        return;
+    }
+
+    it.type = OVERLAY_TYPE_NONE;
+    Overlay_MarkChanged(it);
+}
+
+// Lines of changed items are cleared, then changed items and items which were partially cleared are drawn again.
+void Overlay_Flush(void) {
+    if (isOverlaySuspended) {
+        isOverlaySuspended = false;
+
+        for (auto& it : overlayItems) {
+            it.isChanged = (it.type != OVERLAY_TYPE_NONE);
+            it.drawnFromLine = 0;
+            it.drawnToLine = 0;
+        }
+
+        isOverlayChanged = true;
+    }
+
+    if (!isOverlayChanged) {
+        return;
+    }
+
+    isOverlayChanged = false;
+    std::fill(overlayClearedLines, overlayClearedLines + HEIGHT, false);
+
+    for (auto& it : overlayItems) {
+        if (!it.isChanged) {
+            continue;
+        }
+
+        for (int y = it.drawnFromLine; y < it.drawnToLine; y++) {
+            if (!overlayClearedLines[y]) {
+                std::fill(overlayPixels + y * WIDTH, overlayPixels + (y + 1) * WIDTH, STAGE_OVERLAY_TRANSPARENT);
+                overlayClearedLines[y] = true;
+                overlayDirtyLines[y] = true;
+            }
+        }
+
+        it.drawnFromLine = 0;
+        it.drawnToLine = 0;
+    }
+
+    for (auto& it : overlayItems) {
+        if (it.type == OVERLAY_TYPE_NONE || (!it.isChanged && !Overlay_IsIntersected(it))) {
+            it.isChanged = false;
+            continue;
+        }
+
+        it.isChanged = false;
+        SetDrawTarget(overlayPixels);
+
+        switch (it.type) {
+            case OVERLAY_TYPE_TEXT:
+                it.font->PrintString(it.x, it.y, it.text.c_str());
+                break;
+
+            case OVERLAY_TYPE_IMAGE:
+                OutputGimpImage(it.x, it.y, it.image);
+                break;
+
+            default:
+                it.draw();
+                break;
+        }
+
+        if (!GetDrawnLines(&it.drawnFromLine, &it.drawnToLine)) {
+            it.drawnFromLine = 0;
+            it.drawnToLine = 0;
+        }
+
+        std::fill(overlayDirtyLines + it.drawnFromLine, overlayDirtyLines + it.drawnToLine, true);
+    }
+
+    SetDrawTarget(nullptr);
+    host->stage()->renderOverlay(overlayPixels, overlayDirtyLines);
+    std::fill(overlayDirtyLines, overlayDirtyLines + HEIGHT, false);
+}
+
+void Overlay_Suspend(void) {
+    if (isOverlaySuspended) {
+        return;
+    }
+
+    isOverlaySuspended = true;
+
+    std::fill(overlayPixels, overlayPixels + WIDTH * HEIGHT, STAGE_OVERLAY_TRANSPARENT);
+    std::fill(overlayDirtyLines, overlayDirtyLines + HEIGHT, true);
+
+    host->stage()->renderOverlay(overlayPixels, overlayDirtyLines);
+    std::fill(overlayDirtyLines, overlayDirtyLines + HEIGHT, false);
+}
@@ -0,0 +1,30 @@
+#ifndef _OVERLAY_H_INCLUDED_
+#define _OVERLAY_H_INCLUDED_
+
+#include "zemu.h"
+#include "font.h"
+#include "graphics.h"
+
+// OSD is drawn into the separate plane, which the stage composes with the frame on presentation,
+// so the screen contains only the emulated picture (for antiflicker, change detection, hashes and capture).
+// Items are retained: every frame OSD code tells what should be shown, but item is drawn again only when
+// it is changed, and only changed lines are sent to the stage. Static OSD costs a few comparisons per frame.
+
+#define OVERLAY_ITEM_FLOPPY 0
+#define OVERLAY_ITEM_TURBO 1
+#define OVERLAY_ITEM_TAPE 2
+#define OVERLAY_ITEM_MESSAGE 3
+#define OVERLAY_ITEM_CAPTURE 4
+#define OVERLAY_ITEM_FRAME_STATS 5
+#define OVERLAY_ITEM_WATCHES 6 // MAX_WATCHES items
+#define OVERLAY_ITEMS_COUNT (OVERLAY_ITEM_WATCHES + MAX_WATCHES)
+
+void Overlay_Init(void);
+void Overlay_Text(int item, int x, int y, C_Font* font, const char* text);
+void Overlay_Image(int item, int x, int y, s_GimpImage* image);
+void Overlay_Custom(int item, void (* draw)(void), bool isChanged); // draw() uses usual drawing functions
+void Overlay_Hide(int item);
+void Overlay_Flush(void);
+void Overlay_Suspend(void); // dialogs draw into the screen, so OSD is hidden until the next Overlay_Flush()
+
+#endif
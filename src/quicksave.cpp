@@ -0,0 +1,213 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <stdio.h>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "zemu_env.h"
+#include "quicksave.h"
+#include "state.h"
+#include "snap_z80.h"
+#include "snap_sna.h"
+#include "devs.h"
+
+struct s_QuickSaveJob {
+    std::string fileName;
+    std::vector<uint8_t> data;
+    int format;
+    unsigned slot;
+};
+
+static unsigned quickSaveSlots = QUICKSAVE_DEFAULT_SLOTS;
+static unsigned quickSaveSlot = 0;
+
+static std::thread quickSaveThread;
+static std::mutex quickSaveMutex;
+static std::condition_variable quickSaveCondition;
+static std::deque<s_QuickSaveJob> quickSaveJobs;
+static std::vector<std::string> quickSaveMessages;
+static bool quickSaveIsBusy = false;
+static bool quickSaveIsClosing = false;
+
+static std::string QuickSave_FileName(unsigned slot) {
+    std::string fileName = "snap";
+
+    if (slot) {
+        fileName += std::to_string(slot);
+    }
+
+    switch (params.snapFormat) {
+        case SNAP_FORMAT_SNA:
+            return fileName + ".sna";
+
+        case SNAP_FORMAT_ZST:
+            return fileName + STATE_EXTENSION;
+
+        default:
+            return fileName + ".z80";
+    }
+}
+
+static void QuickSave_Write(s_QuickSaveJob& job) {
+    if (job.format == SNAP_FORMAT_Z80) {
+        pack_z80_snap(job.data);
+    }
+
+    std::string message;
+
+    try {
+        auto writer = host->storage()->path(job.fileName)->dataWriter();
+
+        if (!writer->writeBlock(job.data.data(), job.data.size())) {
+            throw StorageException("Write error");
+        }
+
+        message = (job.format == SNAP_FORMAT_ZST ? "State saved" : "Snapshot saved");
+    } catch (StorageException& e) {
+        printf("Write failed: %s\n", e.what());
+        message = (job.format == SNAP_FORMAT_ZST ? "Error saving state" : "Error saving snapshot");
+    }
+
+    if (job.slot) {
+        message += " to slot " + std::to_string(job.slot);
+    }
+
+    std::lock_guard<std::mutex> lock(quickSaveMutex);
+    quickSaveMessages.push_back(message);
+}
+
+static void QuickSave_Worker(void) {
+    std::unique_lock<std::mutex> lock(quickSaveMutex);
+
+    for (;;) {
+        quickSaveCondition.wait(lock, [] { return quickSaveIsClosing || !quickSaveJobs.empty(); });
+
+        if (quickSaveJobs.empty()) {
+            return;
+        }
+
+        s_QuickSaveJob job = std::move(quickSaveJobs.front());
+        quickSaveJobs.pop_front();
+        quickSaveIsBusy = true;
+
+        lock.unlock();
+        QuickSave_Write(job);
+        lock.lock();
+
+        quickSaveIsBusy = false;
+        quickSaveCondition.notify_all();
+    }
+}
+
+// Waits until all pending snapshots are written.
+static void QuickSave_Flush(void) {
+    std::unique_lock<std::mutex> lock(quickSaveMutex);
+    quickSaveCondition.wait(lock, [] { return quickSaveJobs.empty() && !quickSaveIsBusy; });
+}
+
+static void QuickSave_OnFrameStart(void) {
+    std::vector<std::string> messages;
+
+    {
+        std::lock_guard<std::mutex> lock(quickSaveMutex);
+
+        if (quickSaveMessages.empty()) {
+            return;
+        }
+
+        messages.swap(quickSaveMessages);
+    }
+
+    SetMessage(messages.back().c_str());
+}
+
+void QuickSave_Init(void) {
+    quickSaveSlots = (unsigned)std::max(1, host->config()->getInt("core", "quicksave_slots", QUICKSAVE_DEFAULT_SLOTS));
+
+    quickSaveIsClosing = false;
+    quickSaveThread = std::thread(QuickSave_Worker);
+
+    AttachFrameStartHandler(QuickSave_OnFrameStart);
+}
+
+void QuickSave_Close(void) {
+    if (!quickSaveThread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(quickSaveMutex);
+        quickSaveIsClosing = true;
+    }
+
+    // worker writes everything what is left in the queue before exiting
+    quickSaveCondition.notify_all();
+    quickSaveThread.join();
+}
+
+void QuickSave_Save(void) {
+    s_QuickSaveJob job;
+
+    job.fileName = QuickSave_FileName(quickSaveSlot);
+    job.format = params.snapFormat;
+    job.slot = quickSaveSlot;
+
+    switch (job.format) {
+        case SNAP_FORMAT_SNA:
+            capture_sna_snap(job.data, cpu, dev_mman, dev_border);
+            break;
+
+        case SNAP_FORMAT_ZST:
+            State_Save(job.data);
+            break;
+
+        default:
+            capture_z80_snap(job.data, cpu, dev_mman, dev_border);
+            break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(quickSaveMutex);
+        quickSaveJobs.push_back(std::move(job));
+    }
+
+    quickSaveCondition.notify_all();
+}
+
+void QuickSave_Load(void) {
+    // snapshot for this slot can be still in the queue
+    QuickSave_Flush();
+
+    std::string fileName = QuickSave_FileName(quickSaveSlot);
+    std::string message;
+
+    if (params.snapFormat == SNAP_FORMAT_ZST) {
+        message = (State_LoadFile(fileName.c_str()) ? "State loaded" : "Error loading state");
+    } else {
+        bool (* loadSnap)(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
+        loadSnap = (params.snapFormat == SNAP_FORMAT_SNA ? load_sna_snap : load_z80_snap);
+
+        message = (loadSnap(fileName.c_str(), cpu, dev_mman, dev_border) ? "Snapshot loaded" : "Error loading snapshot");
+    }
+
+    if (quickSaveSlot) {
+        message += " from slot " + std::to_string(quickSaveSlot);
+    }
+
+    SetMessage(message.c_str());
+}
+
+void QuickSave_NextSlot(void) {
+    quickSaveSlot = (quickSaveSlot + 1) % quickSaveSlots;
+    SetMessage(("Quick save slot " + std::to_string(quickSaveSlot)).c_str());
+}
+
+void QuickSave_PrevSlot(void) {
+    quickSaveSlot = (quickSaveSlot + quickSaveSlots - 1) % quickSaveSlots;
+    SetMessage(("Quick save slot " + std::to_string(quickSaveSlot)).c_str());
+}
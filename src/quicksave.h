@@ -0,0 +1,19 @@
+#ifndef _QUICKSAVE_H_INCLUDED_
+#define _QUICKSAVE_H_INCLUDED_
+
+#include "zemu.h"
+
+// Quick save captures snapshot into memory between frames (copy of RAM is much cheaper than disk I/O),
+// then background thread packs and writes it. Result is reported with SetMessage() on the next frame.
+// Slot 0 is "snap.<ext>" (as before slots were added), other slots are "snap<N>.<ext>".
+
+#define QUICKSAVE_DEFAULT_SLOTS 10
+
+void QuickSave_Init(void);
+void QuickSave_Close(void);
+void QuickSave_Save(void);
+void QuickSave_Load(void);
+void QuickSave_NextSlot(void);
+void QuickSave_PrevSlot(void);
+
+#endif
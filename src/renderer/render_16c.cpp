@@ -2,41 +2,31 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include "render_16c.h"
-#include "render_common.h"
-
-void Render16c(unsigned long nextClk) {
-    int scrA;
-    int scrB;
-    int b1;
-    int b2;
-    int b3;
-    int b4;
-
-    #include "render_common_a.h"
-
-    if ((dev_mman.port7FFD & 8) ^ screensHack) {
-        scrA = RAM_BANK7;
-        scrB = RAM_BANK6;
-    } else {
-        scrA = RAM_BANK5;
-        scrB = RAM_BANK4;
+#include "render_raster.h"
+#include "render_kernels.h"
+
+// collects IiGRBgrb bytes of chunks (4 bytes per chunk, 2 pixels per byte), then the whole span is expanded by the kernel
+static void Render16cPaper(const s_RasterState& state, uint8_t* into, int zxLine, int fromChunk, int toChunk) {
+    uint8_t dataRun[RASTER_LINE_CHUNKS * 4];
+    const uint8_t* bitmapA = state.screenPage + rasterBitmapOffsets[zxLine];
+    const uint8_t* bitmapB = state.screenPageB + rasterBitmapOffsets[zxLine];
+
+    for (int pos = fromChunk; pos < toChunk; pos++) {
+        dataRun[pos * 4] = bitmapB[pos];
+        dataRun[pos * 4 + 1] = bitmapA[pos];
+        dataRun[pos * 4 + 2] = bitmapB[pos + 0x2000];
+        dataRun[pos * 4 + 3] = bitmapA[pos + 0x2000];
     }
 
-    b1 = dev_mman.ram[ scrB + ((zxLine & 0xC0) << 5) + ((zxLine & 7) << 8) + ((zxLine & 0x38) << 2) + pos ];
-    b2 = dev_mman.ram[ scrA + ((zxLine & 0xC0) << 5) + ((zxLine & 7) << 8) + ((zxLine & 0x38) << 2) + pos ];
-    b3 = dev_mman.ram[ scrB + 0x2000 + ((zxLine & 0xC0) << 5) + ((zxLine & 7) << 8) + ((zxLine & 0x38) << 2) + pos ];
-    b4 = dev_mman.ram[ scrA + 0x2000 + ((zxLine & 0xC0) << 5) + ((zxLine & 7) << 8) + ((zxLine & 0x38) << 2) + pos ];
-
-    // IiGRBgrb
+    renderKernels.expand16c(into, dataRun + fromChunk * 4, (toChunk - fromChunk) * 4);
+}
 
-    *(scr++) = colors[((b1 & 0x40) >> 3) | (b1 & 7)];
-    *(scr++) = colors[((b1 & 0x80) >> 4) | ((b1 & 0x38) >> 3)];
-    *(scr++) = colors[((b2 & 0x40) >> 3) | (b2 & 7)];
-    *(scr++) = colors[((b2 & 0x80) >> 4) | ((b2 & 0x38) >> 3)];
-    *(scr++) = colors[((b3 & 0x40) >> 3) | (b3 & 7)];
-    *(scr++) = colors[((b3 & 0x80) >> 4) | ((b3 & 0x38) >> 3)];
-    *(scr++) = colors[((b4 & 0x40) >> 3) | (b4 & 7)];
-    *(scr++) = colors[((b4 & 0x80) >> 4) | ((b4 & 0x38) >> 3)];
+static const s_RasterMode mode16c = {
+    32, 32 + 192,
+    16, 16 + 128,
+    Render16cPaper
+};
 
-    #include "render_common_b.h"
+void Render16c(s_RasterState& state, unsigned long nextClk) {
+    Raster_Render(mode16c, state, nextClk);
 }
@@ -1,6 +1,8 @@
 #ifndef _RENDER_16C_H_INCLUDED_
 #define _RENDER_16C_H_INCLUDED_
 
-void Render16c(unsigned long nextClk);
+#include "render_raster.h"
+
+void Render16c(s_RasterState& state, unsigned long nextClk);
 
 #endif
@@ -0,0 +1,134 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <algorithm>
+#include "zemu_env.h"
+#include "zemu.h"
+#include "devs.h"
+#include "render_bench.h"
+#include "render_kernels.h"
+#include "render_speccy.h"
+#include "render_16c.h"
+
+#define RENDER_BENCH_ROUNDS 5
+
+static uint32_t* renderBenchPixels = nullptr;
+
+// presentation is measured on the last rendered frame, blend is done with the same frame shifted by one (two) lines
+static void RenderBench_Present(s_RasterState& state, unsigned long) {
+    renderKernels.expandIndexed(renderBenchPixels, state.into, screenPalette, WIDTH * HEIGHT);
+}
+
+static void RenderBench_PresentBlend(s_RasterState& state, unsigned long) {
+    renderKernels.expandIndexedBlend(renderBenchPixels, state.into, state.into + WIDTH, screenPalette, WIDTH * (HEIGHT - 1));
+}
+
+static void RenderBench_PresentBlend3(s_RasterState& state, unsigned long) {
+    renderKernels.expandIndexedBlend3(
+        renderBenchPixels,
+        state.into,
+        state.into + WIDTH,
+        state.into + WIDTH * 2,
+        screenPalette,
+        WIDTH * (HEIGHT - 2)
+    );
+}
+
+// attribute colors are selected for every frame, as in Render()
+static void RenderBench_Speccy(s_RasterState& state, unsigned long nextClk) {
+    RenderSpeccy_Prepare(false, state)(state, nextClk);
+}
+
+static void RenderBench_Multicolor(s_RasterState& state, unsigned long nextClk) {
+    RenderSpeccy_Prepare(true, state)(state, nextClk);
+}
+
+struct s_RenderBenchRenderer {
+    const char* name;
+    ptrRenderFunc render;
+};
+
+static const s_RenderBenchRenderer renderBenchRenderers[] = {
+    { "speccy", RenderBench_Speccy },
+    { "multicolor", RenderBench_Multicolor },
+    { "16c", Render16c },
+    { "present", RenderBench_Present },
+    { "present-af", RenderBench_PresentBlend },
+    { "present-3f", RenderBench_PresentBlend3 },
+};
+
+static uint64_t RenderBench_Hash(const uint8_t* indices) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        hash = (hash ^ indices[i]) * 0x100000001B3ULL;
+        hash = (hash ^ renderBenchPixels[i]) * 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+bool RenderBench_Run(unsigned frames) {
+    s_RenderKernels savedKernels = renderKernels;
+    s_RasterState state;
+    bool isMatched = true;
+
+    frames = std::max(1U, frames);
+    renderBenchPixels = new uint32_t[WIDTH * HEIGHT]();
+
+    state.into = new uint8_t[WIDTH * HEIGHT];
+    Raster_ApplyFlags(state, dev_mman.ram + RAM_BANK4, Raster_GetMachineFlags());
+
+    for (const auto& renderer : renderBenchRenderers) {
+        uint64_t scalarMicros = 0;
+        uint64_t scalarHash = 0;
+
+        for (int kind = 0; kind < RENDER_KERNELS_COUNT; kind++) {
+            const s_RenderKernels* kernels = RenderKernels_Get(kind);
+
+            if (!kernels) {
+                continue;
+            }
+
+            renderKernels = *kernels;
+            uint64_t micros = UINT64_MAX;
+
+            // best of several rounds, to filter out the noise from other processes
+            for (int round = 0; round < RENDER_BENCH_ROUNDS; round++) {
+                uint64_t startMicros = host->timer()->getElapsedMicros();
+
+                for (unsigned i = 0; i < frames; i++) {
+                    state.prevClk = 0;
+                    renderer.render(state, MAX_FRAME_TACTS);
+                }
+
+                micros = std::min(micros, std::max((uint64_t)1, host->timer()->getElapsedMicros() - startMicros));
+            }
+
+            uint64_t hash = RenderBench_Hash(state.into);
+
+            if (kind == RENDER_KERNELS_SCALAR) {
+                scalarMicros = micros;
+                scalarHash = hash;
+            }
+
+            printf(
+                "Render %-10s %-6s %8.2f us/frame  x%.2f%s\n",
+                renderer.name,
+                kernels->name,
+                (double)micros / frames,
+                (double)scalarMicros / micros,
+                (hash == scalarHash ? "" : "  MISMATCH")
+            );
+
+            isMatched = isMatched && (hash == scalarHash);
+        }
+    }
+
+    delete[] renderBenchPixels;
+    delete[] state.into;
+    renderBenchPixels = nullptr;
+    renderKernels = savedKernels;
+
+    return isMatched;
+}
@@ -0,0 +1,10 @@
+#ifndef _RENDER_BENCH_H_INCLUDED_
+#define _RENDER_BENCH_H_INCLUDED_
+
+// Renders current machine memory as full frames with every renderer and every kernels set supported by the CPU,
+// then expands the last frame to pixels (with and without antiflicker). Prints time per frame
+// and checks that all kernels produce the same result as the scalar ones.
+// Returns false if some kernels differ.
+bool RenderBench_Run(unsigned frames);
+
+#endif
@@ -0,0 +1,456 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "render_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define RENDER_KERNELS_X86
+    #include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+    #define RENDER_KERNELS_ARM
+    #include <arm_neon.h>
+#endif
+
+s_RenderKernels renderKernels;
+
+//--------------------------------------------------------------------------------------------------------------
+
+static void Scalar_ExpandBitmap(uint8_t* into, const uint8_t* bitmap, const uint8_t* ink, const uint8_t* paper, int count) {
+    for (int i = 0; i < count; i++) {
+        int bt = bitmap[i];
+        uint8_t ci = ink[i];
+        uint8_t cp = paper[i];
+
+        *(into++) = (bt & 128 ? ci : cp);
+        *(into++) = (bt &  64 ? ci : cp);
+        *(into++) = (bt &  32 ? ci : cp);
+        *(into++) = (bt &  16 ? ci : cp);
+        *(into++) = (bt &   8 ? ci : cp);
+        *(into++) = (bt &   4 ? ci : cp);
+        *(into++) = (bt &   2 ? ci : cp);
+        *(into++) = (bt &   1 ? ci : cp);
+    }
+}
+
+static void Scalar_Expand16c(uint8_t* into, const uint8_t* data, int count) {
+    for (int i = 0; i < count; i++) {
+        int b = data[i];
+
+        *(into++) = (uint8_t)(((b & 0x40) >> 3) | (b & 7));
+        *(into++) = (uint8_t)(((b & 0x80) >> 4) | ((b & 0x38) >> 3));
+    }
+}
+
+static void Scalar_ExpandIndexed(uint32_t* into, const uint8_t* indices, const uint32_t* palette, int count) {
+    for (int i = 0; i < count; i++) {
+        into[i] = palette[indices[i]];
+    }
+}
+
+// average of every byte, rounded down: (a + b) / 2 = (a & b) + (a ^ b) / 2
+static void Scalar_ExpandIndexedBlend(uint32_t* into, const uint8_t* indicesA, const uint8_t* indicesB, const uint32_t* palette, int count) {
+    for (int i = 0; i < count; i++) {
+        uint32_t a = palette[indicesA[i]];
+        uint32_t b = palette[indicesB[i]];
+
+        into[i] = (a & b) + (((a ^ b) >> 1) & 0x7F7F7F7F);
+    }
+}
+
+// every byte is (a + b + c) / 3, rounded down. Averages are per byte, so they don't depend on the pixel layout
+// (STAGE_FLIPPED_ARGB included), and the unused byte stays zero.
+static void Scalar_ExpandIndexedBlend3(
+    uint32_t* into,
+    const uint8_t* indicesA,
+    const uint8_t* indicesB,
+    const uint8_t* indicesC,
+    const uint32_t* palette,
+    int count
+) {
+    for (int i = 0; i < count; i++) {
+        uint32_t a = palette[indicesA[i]];
+        uint32_t b = palette[indicesB[i]];
+        uint32_t c = palette[indicesC[i]];
+        uint32_t result = 0;
+
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF);
+            result |= (sum / 3) << shift;
+        }
+
+        into[i] = result;
+    }
+}
+
+static const s_RenderKernels scalarKernels = {
+    "scalar",
+    Scalar_ExpandBitmap,
+    Scalar_Expand16c,
+    Scalar_ExpandIndexed,
+    Scalar_ExpandIndexedBlend,
+    Scalar_ExpandIndexedBlend3
+};
+
+//--------------------------------------------------------------------------------------------------------------
+
+#ifdef RENDER_KERNELS_X86
+
+static inline long long SpreadByte(uint8_t value) {
+    return (long long)(value * 0x0101010101010101ULL);
+}
+
+// every bitmap byte is spread to 8 bytes, mask is (byte & bit) == bit, then index = paper ^ ((ink ^ paper) & mask)
+__attribute__((target("sse2")))
+static void Sse2_ExpandBitmap(uint8_t* into, const uint8_t* bitmap, const uint8_t* ink, const uint8_t* paper, int count) {
+    const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128);
+
+    for (; count >= 2; count -= 2, bitmap += 2, ink += 2, paper += 2, into += 16) {
+        __m128i bt = _mm_set_epi64x(SpreadByte(bitmap[1]), SpreadByte(bitmap[0]));
+        __m128i cp = _mm_set_epi64x(SpreadByte(paper[1]), SpreadByte(paper[0]));
+        __m128i diff = _mm_xor_si128(_mm_set_epi64x(SpreadByte(ink[1]), SpreadByte(ink[0])), cp);
+        __m128i mask = _mm_cmpeq_epi8(_mm_and_si128(bt, bits), bits);
+
+        _mm_storeu_si128((__m128i*)into, _mm_xor_si128(cp, _mm_and_si128(diff, mask)));
+    }
+
+    Scalar_ExpandBitmap(into, bitmap, ink, paper, count);
+}
+
+// there is no 8-bit shift, but 16-bit one is fine, since bits which came from the neighbour byte are masked out
+__attribute__((target("sse2")))
+static void Sse2_Expand16c(uint8_t* into, const uint8_t* data, int count) {
+    const __m128i mask7 = _mm_set1_epi8(7);
+    const __m128i mask8 = _mm_set1_epi8(8);
+
+    for (; count >= 16; count -= 16, data += 16, into += 32) {
+        __m128i b = _mm_loadu_si128((const __m128i*)data);
+        __m128i b3 = _mm_srli_epi16(b, 3);
+        __m128i left = _mm_or_si128(_mm_and_si128(b3, mask8), _mm_and_si128(b, mask7));
+        __m128i right = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(b, 4), mask8), _mm_and_si128(b3, mask7));
+
+        _mm_storeu_si128((__m128i*)into, _mm_unpacklo_epi8(left, right));
+        _mm_storeu_si128((__m128i*)(into + 16), _mm_unpackhi_epi8(left, right));
+    }
+
+    Scalar_Expand16c(into, data, count);
+}
+
+// SSE2 has no gather, so palette lookups are scalar, but the blending is not
+__attribute__((target("sse2")))
+static inline __m128i Sse2_Lookup(const uint8_t* indices, const uint32_t* palette) {
+    return _mm_set_epi32(
+        (int)palette[indices[3]],
+        (int)palette[indices[2]],
+        (int)palette[indices[1]],
+        (int)palette[indices[0]]
+    );
+}
+
+__attribute__((target("sse2")))
+static void Sse2_ExpandIndexedBlend(uint32_t* into, const uint8_t* indicesA, const uint8_t* indicesB, const uint32_t* palette, int count) {
+    const __m128i mask7F = _mm_set1_epi8(0x7F);
+
+    for (; count >= 4; count -= 4, indicesA += 4, indicesB += 4, into += 4) {
+        __m128i a = Sse2_Lookup(indicesA, palette);
+        __m128i b = Sse2_Lookup(indicesB, palette);
+        __m128i half = _mm_and_si128(_mm_srli_epi32(_mm_xor_si128(a, b), 1), mask7F);
+
+        _mm_storeu_si128((__m128i*)into, _mm_add_epi8(_mm_and_si128(a, b), half));
+    }
+
+    Scalar_ExpandIndexedBlend(into, indicesA, indicesB, palette, count);
+}
+
+// bytes are summed as 16-bit words, and divided by 3 as (sum * 0x5556) >> 16, which is exact for sum <= 765
+__attribute__((target("sse2")))
+static inline __m128i Sse2_Average3(__m128i a, __m128i b, __m128i c) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i third = _mm_set1_epi16(0x5556);
+
+    __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)), _mm_unpacklo_epi8(c, zero));
+    __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)), _mm_unpackhi_epi8(c, zero));
+
+    return _mm_packus_epi16(_mm_mulhi_epu16(lo, third), _mm_mulhi_epu16(hi, third));
+}
+
+__attribute__((target("sse2")))
+static void Sse2_ExpandIndexedBlend3(
+    uint32_t* into,
+    const uint8_t* indicesA,
+    const uint8_t* indicesB,
+    const uint8_t* indicesC,
+    const uint32_t* palette,
+    int count
+) {
+    for (; count >= 4; count -= 4, indicesA += 4, indicesB += 4, indicesC += 4, into += 4) {
+        __m128i a = Sse2_Lookup(indicesA, palette);
+        __m128i b = Sse2_Lookup(indicesB, palette);
+        __m128i c = Sse2_Lookup(indicesC, palette);
+
+        _mm_storeu_si128((__m128i*)into, Sse2_Average3(a, b, c));
+    }
+
+    Scalar_ExpandIndexedBlend3(into, indicesA, indicesB, indicesC, palette, count);
+}
+
+static const s_RenderKernels sse2Kernels = {
+    "sse2",
+    Sse2_ExpandBitmap,
+    Sse2_Expand16c,
+    Scalar_ExpandIndexed,
+    Sse2_ExpandIndexedBlend,
+    Sse2_ExpandIndexedBlend3
+};
+
+__attribute__((target("avx2")))
+static void Avx2_ExpandBitmap(uint8_t* into, const uint8_t* bitmap, const uint8_t* ink, const uint8_t* paper, int count) {
+    const __m256i bits = _mm256_set1_epi64x(0x0102040810204080LL);
+
+    for (; count >= 4; count -= 4, bitmap += 4, ink += 4, paper += 4, into += 32) {
+        __m256i bt = _mm256_set_epi64x(SpreadByte(bitmap[3]), SpreadByte(bitmap[2]), SpreadByte(bitmap[1]), SpreadByte(bitmap[0]));
+        __m256i cp = _mm256_set_epi64x(SpreadByte(paper[3]), SpreadByte(paper[2]), SpreadByte(paper[1]), SpreadByte(paper[0]));
+        __m256i ci = _mm256_set_epi64x(SpreadByte(ink[3]), SpreadByte(ink[2]), SpreadByte(ink[1]), SpreadByte(ink[0]));
+        __m256i mask = _mm256_cmpeq_epi8(_mm256_and_si256(bt, bits), bits);
+
+        _mm256_storeu_si256((__m256i*)into, _mm256_blendv_epi8(cp, ci, mask));
+    }
+
+    Sse2_ExpandBitmap(into, bitmap, ink, paper, count);
+}
+
+// unpack works inside of 128-bit lanes, so halves are put back in order with permute
+__attribute__((target("avx2")))
+static void Avx2_Expand16c(uint8_t* into, const uint8_t* data, int count) {
+    const __m256i mask7 = _mm256_set1_epi8(7);
+    const __m256i mask8 = _mm256_set1_epi8(8);
+
+    for (; count >= 32; count -= 32, data += 32, into += 64) {
+        __m256i b = _mm256_loadu_si256((const __m256i*)data);
+        __m256i b3 = _mm256_srli_epi16(b, 3);
+        __m256i left = _mm256_or_si256(_mm256_and_si256(b3, mask8), _mm256_and_si256(b, mask7));
+        __m256i right = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(b, 4), mask8), _mm256_and_si256(b3, mask7));
+        __m256i lo = _mm256_unpacklo_epi8(left, right);
+        __m256i hi = _mm256_unpackhi_epi8(left, right);
+
+        _mm256_storeu_si256((__m256i*)into, _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(into + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    Sse2_Expand16c(into, data, count);
+}
+
+__attribute__((target("avx2")))
+static void Avx2_ExpandIndexed(uint32_t* into, const uint8_t* indices, const uint32_t* palette, int count) {
+    for (; count >= 8; count -= 8, indices += 8, into += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)indices));
+        _mm256_storeu_si256((__m256i*)into, _mm256_i32gather_epi32((const int*)palette, index, 4));
+    }
+
+    Scalar_ExpandIndexed(into, indices, palette, count);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i Avx2_Lookup(const uint8_t* indices, const uint32_t* palette) {
+    return _mm256_i32gather_epi32((const int*)palette, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)indices)), 4);
+}
+
+__attribute__((target("avx2")))
+static void Avx2_ExpandIndexedBlend(uint32_t* into, const uint8_t* indicesA, const uint8_t* indicesB, const uint32_t* palette, int count) {
+    const __m256i mask7F = _mm256_set1_epi8(0x7F);
+
+    for (; count >= 8; count -= 8, indicesA += 8, indicesB += 8, into += 8) {
+        __m256i a = Avx2_Lookup(indicesA, palette);
+        __m256i b = Avx2_Lookup(indicesB, palette);
+        __m256i half = _mm256_and_si256(_mm256_srli_epi32(_mm256_xor_si256(a, b), 1), mask7F);
+
+        _mm256_storeu_si256((__m256i*)into, _mm256_add_epi8(_mm256_and_si256(a, b), half));
+    }
+
+    Scalar_ExpandIndexedBlend(into, indicesA, indicesB, palette, count);
+}
+
+// the same as Sse2_Average3, unpack and pack both work inside of 128-bit lanes, so the order is kept
+__attribute__((target("avx2")))
+static void Avx2_ExpandIndexedBlend3(
+    uint32_t* into,
+    const uint8_t* indicesA,
+    const uint8_t* indicesB,
+    const uint8_t* indicesC,
+    const uint32_t* palette,
+    int count
+) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i third = _mm256_set1_epi16(0x5556);
+
+    for (; count >= 8; count -= 8, indicesA += 8, indicesB += 8, indicesC += 8, into += 8) {
+        __m256i a = Avx2_Lookup(indicesA, palette);
+        __m256i b = Avx2_Lookup(indicesB, palette);
+        __m256i c = Avx2_Lookup(indicesC, palette);
+
+        __m256i lo = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)),
+            _mm256_unpacklo_epi8(c, zero)
+        );
+
+        __m256i hi = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)),
+            _mm256_unpackhi_epi8(c, zero)
+        );
+
+        _mm256_storeu_si256((__m256i*)into, _mm256_packus_epi16(_mm256_mulhi_epu16(lo, third), _mm256_mulhi_epu16(hi, third)));
+    }
+
+    Scalar_ExpandIndexedBlend3(into, indicesA, indicesB, indicesC, palette, count);
+}
+
+static const s_RenderKernels avx2Kernels = {
+    "avx2",
+    Avx2_ExpandBitmap,
+    Avx2_Expand16c,
+    Avx2_ExpandIndexed,
+    Avx2_ExpandIndexedBlend,
+    Avx2_ExpandIndexedBlend3
+};
+
+#endif
+
+//--------------------------------------------------------------------------------------------------------------
+
+#ifdef RENDER_KERNELS_ARM
+
+static void Neon_ExpandBitmap(uint8_t* into, const uint8_t* bitmap, const uint8_t* ink, const uint8_t* paper, int count) {
+    static const uint8_t bitsData[16] = { 128, 64, 32, 16, 8, 4, 2, 1, 128, 64, 32, 16, 8, 4, 2, 1 };
+    const uint8x16_t bits = vld1q_u8(bitsData);
+
+    for (; count >= 2; count -= 2, bitmap += 2, ink += 2, paper += 2, into += 16) {
+        uint8x16_t bt = vcombine_u8(vdup_n_u8(bitmap[0]), vdup_n_u8(bitmap[1]));
+        uint8x16_t ci = vcombine_u8(vdup_n_u8(ink[0]), vdup_n_u8(ink[1]));
+        uint8x16_t cp = vcombine_u8(vdup_n_u8(paper[0]), vdup_n_u8(paper[1]));
+
+        vst1q_u8(into, vbslq_u8(vtstq_u8(bt, bits), ci, cp));
+    }
+
+    Scalar_ExpandBitmap(into, bitmap, ink, paper, count);
+}
+
+static void Neon_Expand16c(uint8_t* into, const uint8_t* data, int count) {
+    const uint8x16_t mask7 = vdupq_n_u8(7);
+    const uint8x16_t mask8 = vdupq_n_u8(8);
+
+    for (; count >= 16; count -= 16, data += 16, into += 32) {
+        uint8x16_t b = vld1q_u8(data);
+        uint8x16_t b3 = vshrq_n_u8(b, 3);
+        uint8x16x2_t pair;
+
+        pair.val[0] = vorrq_u8(vandq_u8(b3, mask8), vandq_u8(b, mask7));
+        pair.val[1] = vorrq_u8(vandq_u8(vshrq_n_u8(b, 4), mask8), vandq_u8(b3, mask7));
+
+        vst2q_u8(into, pair); // stores left and right indices interleaved
+    }
+
+    Scalar_Expand16c(into, data, count);
+}
+
+// NEON has no gather (and table lookups are limited to 64 bytes), so palette lookups are scalar,
+// but the blending is not
+static inline uint8x16_t Neon_Lookup(const uint8_t* indices, const uint32_t* palette) {
+    const uint32_t pixels[4] = { palette[indices[0]], palette[indices[1]], palette[indices[2]], palette[indices[3]] };
+    return vreinterpretq_u8_u32(vld1q_u32(pixels));
+}
+
+static void Neon_ExpandIndexedBlend(uint32_t* into, const uint8_t* indicesA, const uint8_t* indicesB, const uint32_t* palette, int count) {
+    for (; count >= 4; count -= 4, indicesA += 4, indicesB += 4, into += 4) {
+        uint8x16_t average = vhaddq_u8(Neon_Lookup(indicesA, palette), Neon_Lookup(indicesB, palette));
+        vst1q_u32(into, vreinterpretq_u32_u8(average));
+    }
+
+    Scalar_ExpandIndexedBlend(into, indicesA, indicesB, palette, count);
+}
+
+// sum of 8 bytes is divided by 3 as (sum * 0x5556) >> 16, which is exact for sum <= 765
+static inline uint8x8_t Neon_Divide3(uint16x8_t sum) {
+    const uint16x4_t third = vdup_n_u16(0x5556);
+
+    uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(sum), third), 16);
+    uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(sum), third), 16);
+
+    return vmovn_u16(vcombine_u16(lo, hi));
+}
+
+static void Neon_ExpandIndexedBlend3(
+    uint32_t* into,
+    const uint8_t* indicesA,
+    const uint8_t* indicesB,
+    const uint8_t* indicesC,
+    const uint32_t* palette,
+    int count
+) {
+    for (; count >= 4; count -= 4, indicesA += 4, indicesB += 4, indicesC += 4, into += 4) {
+        uint8x16_t a = Neon_Lookup(indicesA, palette);
+        uint8x16_t b = Neon_Lookup(indicesB, palette);
+        uint8x16_t c = Neon_Lookup(indicesC, palette);
+
+        uint16x8_t lo = vaddw_u8(vaddl_u8(vget_low_u8(a), vget_low_u8(b)), vget_low_u8(c));
+        uint16x8_t hi = vaddw_u8(vaddl_u8(vget_high_u8(a), vget_high_u8(b)), vget_high_u8(c));
+
+        vst1q_u32(into, vreinterpretq_u32_u8(vcombine_u8(Neon_Divide3(lo), Neon_Divide3(hi))));
+    }
+
+    Scalar_ExpandIndexedBlend3(into, indicesA, indicesB, indicesC, palette, count);
+}
+
+static const s_RenderKernels neonKernels = {
+    "neon",
+    Neon_ExpandBitmap,
+    Neon_Expand16c,
+    Scalar_ExpandIndexed,
+    Neon_ExpandIndexedBlend,
+    Neon_ExpandIndexedBlend3
+};
+
+#endif
+
+//--------------------------------------------------------------------------------------------------------------
+
+const s_RenderKernels* RenderKernels_Get(int kind) {
+    switch (kind) {
+        case RENDER_KERNELS_SCALAR:
+            return &scalarKernels;
+
+        #ifdef RENDER_KERNELS_X86
+            case RENDER_KERNELS_SSE2:
+                __builtin_cpu_init();
+                return (__builtin_cpu_supports("sse2") ? &sse2Kernels : nullptr);
+
+            case RENDER_KERNELS_AVX2:
+                __builtin_cpu_init();
+                return (__builtin_cpu_supports("avx2") ? &avx2Kernels : nullptr);
+        #endif
+
+        #ifdef RENDER_KERNELS_ARM
+            case RENDER_KERNELS_NEON:
+                return &neonKernels;
+        #endif
+
+        default:
+            return nullptr;
+    }
+}
+
+void RenderKernels_Init(void) {
+    static const int preferred[] = {
+        RENDER_KERNELS_AVX2,
+        RENDER_KERNELS_NEON,
+        RENDER_KERNELS_SSE2,
+        RENDER_KERNELS_SCALAR
+    };
+
+    for (int kind : preferred) {
+        const s_RenderKernels* kernels = RenderKernels_Get(kind);
+
+        if (kernels) {
+            renderKernels = *kernels;
+            return;
+        }
+    }
+}
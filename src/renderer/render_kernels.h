@@ -0,0 +1,48 @@
+#ifndef _RENDER_KERNELS_H_INCLUDED_
+#define _RENDER_KERNELS_H_INCLUDED_
+
+#include <stdint.h>
+
+// Kernels expand runs of video memory bytes to palette indices (see PALETTE_* in zemu.h), and palette indices
+// to pixels on presentation. Renderers collect a run (one line of paper, or its part up to the next change)
+// and expand it with a single call. Best set is selected at runtime by the CPU features,
+// all sets produce exactly the same result.
+
+#define RENDER_KERNELS_SCALAR 0
+#define RENDER_KERNELS_SSE2 1
+#define RENDER_KERNELS_AVX2 2
+#define RENDER_KERNELS_NEON 3
+#define RENDER_KERNELS_COUNT 4
+
+struct s_RenderKernels {
+    const char* name;
+
+    // expands count bitmap bytes to 8 indices each, set bits are ink[i], reset bits are paper[i]
+    void (* expandBitmap)(uint8_t* into, const uint8_t* bitmap, const uint8_t* ink, const uint8_t* paper, int count);
+
+    // expands count 16 colors bytes (IiGRBgrb) to 2 indices each
+    void (* expand16c)(uint8_t* into, const uint8_t* data, int count);
+
+    // looks up count indices in the palette
+    void (* expandIndexed)(uint32_t* into, const uint8_t* indices, const uint32_t* palette, int count);
+
+    // looks up count indices from both buffers in the palette and averages the pixels (antiflicker, gigascreen)
+    void (* expandIndexedBlend)(uint32_t* into, const uint8_t* indicesA, const uint8_t* indicesB, const uint32_t* palette, int count);
+
+    // the same for three buffers (three-frame antiflicker, three-color modes)
+    void (* expandIndexedBlend3)(
+        uint32_t* into,
+        const uint8_t* indicesA,
+        const uint8_t* indicesB,
+        const uint8_t* indicesC,
+        const uint32_t* palette,
+        int count
+    );
+};
+
+extern s_RenderKernels renderKernels;
+
+void RenderKernels_Init(void);
+const s_RenderKernels* RenderKernels_Get(int kind); // nullptr if not supported by this CPU
+
+#endif
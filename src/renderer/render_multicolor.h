@@ -1,6 +0,0 @@
-#ifndef _RENDER_MULTICOLOR_H_INCLUDED_
-#define _RENDER_MULTICOLOR_H_INCLUDED_
-
-void RenderMulticolor(unsigned long nextClk);
-
-#endif
@@ -0,0 +1,206 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "zemu_env.h"
+#include "zemu.h"
+#include "devs.h"
+#include "render_pipeline.h"
+
+#define RENDER_EVENT_WRITE 0x10
+#define RENDER_EVENTS_RESERVE 0x4000
+
+struct s_RenderEvent {
+    uint32_t clk;
+    uint16_t offset; // in the pages
+    uint8_t value;
+    uint8_t flags; // RASTER_FLAGS_* before the change, RENDER_EVENT_WRITE
+};
+
+struct s_RenderRecord {
+    ptrRenderFunc renderFunc;
+    s_RasterState state;
+    bool is16Colors;
+    std::vector<s_RenderEvent> events;
+    int endFlags; // -1 until the first change after the visible area
+    unsigned long endClk;
+    uint8_t pages[RASTER_PAGES_SIZE];
+};
+
+// one record is filled by the emulation, other one is rendered by the worker
+static s_RenderRecord renderRecords[2];
+static int renderRecordIndex = 0;
+static bool isRenderRecordPending = false; // used only by the emulation thread
+
+static std::thread renderPipelineThread;
+static std::mutex renderPipelineMutex;
+static std::condition_variable renderPipelineCondition;
+static s_RenderRecord* renderPipelineSubmitted = nullptr;
+static bool renderPipelineIsClosing = false;
+
+// Renderers are called with the same tacts and the same memory contents, as they would be called inline
+// (changes outside of the visible area are not recorded, since they don't affect the picture).
+static void RenderPipeline_Replay(s_RenderRecord& record) {
+    s_RasterState& state = record.state;
+
+    for (const auto& event : record.events) {
+        Raster_ApplyFlags(state, record.pages, event.flags);
+        record.renderFunc(state, event.clk);
+
+        if (event.flags & RENDER_EVENT_WRITE) {
+            record.pages[event.offset] = event.value;
+        }
+    }
+
+    Raster_ApplyFlags(state, record.pages, record.endFlags);
+    record.renderFunc(state, record.endClk);
+}
+
+static void RenderPipeline_Worker(void) {
+    std::unique_lock<std::mutex> lock(renderPipelineMutex);
+
+    for (;;) {
+        renderPipelineCondition.wait(lock, [] { return renderPipelineIsClosing || renderPipelineSubmitted; });
+
+        if (!renderPipelineSubmitted) {
+            return;
+        }
+
+        lock.unlock();
+        RenderPipeline_Replay(*renderPipelineSubmitted);
+        lock.lock();
+
+        renderPipelineSubmitted = nullptr;
+        renderPipelineCondition.notify_all();
+    }
+}
+
+void RenderPipeline_Init(bool isForced) {
+    if (!isForced
+        && (!host->config()->getBool("display", "render_pipeline", true) || std::thread::hardware_concurrency() < 2)
+    ) {
+        return;
+    }
+
+    for (auto& record : renderRecords) {
+        record.events.reserve(RENDER_EVENTS_RESERVE);
+    }
+
+    renderPipelineIsClosing = false;
+    renderPipelineThread = std::thread(RenderPipeline_Worker);
+}
+
+void RenderPipeline_Close(void) {
+    if (!renderPipelineThread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(renderPipelineMutex);
+        renderPipelineIsClosing = true;
+    }
+
+    renderPipelineCondition.notify_all();
+    renderPipelineThread.join();
+    isRenderRecordPending = false;
+}
+
+bool RenderPipeline_IsEnabled(void) {
+    return renderPipelineThread.joinable();
+}
+
+// Speccy modes show only banks 5 and 7, so banks 4 and 6 are copied and recorded only for 16 colors mode.
+void RenderPipeline_Begin(ptrRenderFunc renderFunc, const s_RasterState& state, bool is16Colors) {
+    s_RenderRecord& record = renderRecords[renderRecordIndex];
+
+    record.renderFunc = renderFunc;
+    record.state = state;
+    record.state.prevClk = 0;
+    record.is16Colors = is16Colors;
+    record.events.clear();
+    record.endFlags = -1;
+
+    for (int offset = (is16Colors ? 0 : 0x4000); offset < RASTER_PAGES_SIZE; offset += (is16Colors ? 0x4000 : 0x8000)) {
+        const uint8_t* page = dev_mman.ram + RAM_BANK4 + offset;
+
+        if (memcmp(record.pages + offset, page, VIDEO_RAM_SIZE) != 0) {
+            memcpy(record.pages + offset, page, VIDEO_RAM_SIZE);
+        }
+    }
+}
+
+void RenderPipeline_AddEvent(unsigned long clk) {
+    s_RenderRecord& record = renderRecords[renderRecordIndex];
+
+    if (clk < Raster_GetScreenStartClk()) {
+        return;
+    }
+
+    // rest of the visible area is rendered with the state before the first change after it
+    if (clk >= Raster_GetScreenEndClk()) {
+        if (record.endFlags < 0) {
+            record.endFlags = Raster_GetMachineFlags();
+        }
+
+        return;
+    }
+
+    record.events.push_back({ (uint32_t)clk, 0, 0, (uint8_t)Raster_GetMachineFlags() });
+}
+
+void RenderPipeline_AddWrite(unsigned long clk, unsigned ramOffset, uint8_t value) {
+    s_RenderRecord& record = renderRecords[renderRecordIndex];
+    unsigned offset = ramOffset - RAM_BANK4;
+
+    if ((!record.is16Colors && !(offset & 0x4000)) || clk >= Raster_GetScreenEndClk() || dev_mman.ram[ramOffset] == value) {
+        return;
+    }
+
+    // nothing is rendered yet, so the page is changed in place
+    if (clk < Raster_GetScreenStartClk()) {
+        record.pages[offset] = value;
+        return;
+    }
+
+    record.events.push_back({
+        (uint32_t)clk,
+        (uint16_t)offset,
+        value,
+        (uint8_t)(Raster_GetMachineFlags() | RENDER_EVENT_WRITE)
+    });
+}
+
+void RenderPipeline_Submit(unsigned long clk) {
+    s_RenderRecord& record = renderRecords[renderRecordIndex];
+
+    record.endClk = clk;
+
+    if (record.endFlags < 0) {
+        record.endFlags = Raster_GetMachineFlags();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(renderPipelineMutex);
+        renderPipelineSubmitted = &record;
+    }
+
+    renderPipelineCondition.notify_all();
+    renderRecordIndex ^= 1;
+    isRenderRecordPending = true;
+}
+
+bool RenderPipeline_Wait(void) {
+    if (!isRenderRecordPending) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(renderPipelineMutex);
+    renderPipelineCondition.wait(lock, [] { return !renderPipelineSubmitted; });
+
+    isRenderRecordPending = false;
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef _RENDER_PIPELINE_H_INCLUDED_
+#define _RENDER_PIPELINE_H_INCLUDED_
+
+#include "render_raster.h"
+
+// Frame is rendered on the worker thread while the emulation runs the next one. Emulation only records the frame:
+// video pages at its start (page is copied only when it differs from the copy in the record) and the log of changes
+// in the visible area (video memory writes, border and screen switches) with their tacts. At the end of the frame
+// record is passed to the worker, which replays it through the same renderers. Rendered frame is presented at the end
+// of the next frame (or earlier, see RenderPipeline_Wait), so the picture is never more than one frame late.
+// When the worker is not started (single core, or render_pipeline = no), frames are rendered inline.
+// With isForced worker is started regardless of the config and cores count (--render-pipeline yes, for tests).
+
+void RenderPipeline_Init(bool isForced);
+void RenderPipeline_Close(void);
+bool RenderPipeline_IsEnabled(void);
+void RenderPipeline_Begin(ptrRenderFunc renderFunc, const s_RasterState& state, bool is16Colors);
+void RenderPipeline_AddEvent(unsigned long clk); // border or screen is about to change
+void RenderPipeline_AddWrite(unsigned long clk, unsigned ramOffset, uint8_t value); // offset in C_MemoryManager::ram
+void RenderPipeline_Submit(unsigned long clk);
+bool RenderPipeline_Wait(void); // waits for the submitted frame, returns false if nothing was submitted
+
+#endif
@@ -0,0 +1,116 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <string.h>
+#include <algorithm>
+#include "zemu.h"
+#include "devs.h"
+#include "render_raster.h"
+
+// pentagon: 320 lines of 224 tacts, visible area starts 16 lines after the vertical retrace
+#define PENTAGON_LINES 320
+#define PENTAGON_LINE_TACTS 224
+
+static_assert(PENTAGON_LINES * PENTAGON_LINE_TACTS == MAX_FRAME_TACTS, "raster timing doesn't match the frame length");
+
+const s_RasterTiming rasterTiming = {
+    PENTAGON_LINE_TACTS,
+    PENTAGON_LINE_TACTS * (16 + 32) + 2,
+    32 + 20
+};
+
+uint16_t rasterBitmapOffsets[192];
+uint16_t rasterAttributeOffsets[192];
+
+void Raster_Init(void) {
+    for (int line = 0; line < 192; line++) {
+        rasterBitmapOffsets[line] = (uint16_t)(((line & 0xC0) << 5) + ((line & 7) << 8) + ((line & 0x38) << 2));
+        rasterAttributeOffsets[line] = (uint16_t)(0x1800 + ((line & 0xF8) << 2));
+    }
+}
+
+// first tact of the visible area
+unsigned long Raster_GetScreenStartClk(void) {
+    return (unsigned long)rasterTiming.firstLineClk;
+}
+
+// tact after the end of the visible area
+unsigned long Raster_GetScreenEndClk(void) {
+    return (unsigned long)rasterTiming.firstLineClk + HEIGHT * rasterTiming.lineTacts;
+}
+
+// renders border from tact up to limit, returns new tact
+static inline int RenderBorderSpan(uint8_t* lineScr, int tact, int limit, uint8_t color) {
+    if (tact >= limit) {
+        return tact;
+    }
+
+    memset(lineScr + (tact * RASTER_PIXELS_PER_TACT), color, (limit - tact) * RASTER_PIXELS_PER_TACT);
+    return limit;
+}
+
+void Raster_Render(const s_RasterMode& mode, s_RasterState& state, unsigned long nextClk) {
+    unsigned long screenStart = Raster_GetScreenStartClk();
+    unsigned long screenEnd = Raster_GetScreenEndClk();
+
+    if (nextClk < screenStart || state.prevClk >= screenEnd) {
+        return;
+    }
+
+    if (state.prevClk < screenStart) {
+        state.prevClk = screenStart;
+    }
+
+    if (nextClk > screenEnd) {
+        nextClk = screenEnd;
+    }
+
+    // Renderer is called only before changes which affect the picture (see RenderCatchUp),
+    // so border color, screen bank and video memory are the same for the whole range.
+    // Line is derived once, then whole lines are rendered in one pass.
+
+    uint8_t borderColor = state.borderColor;
+    int line = (int)((state.prevClk - screenStart) / rasterTiming.lineTacts);
+
+    // lineClk is the first visible tact of the line
+    unsigned long lineClk = screenStart + (line * rasterTiming.lineTacts) + rasterTiming.visibleOffsetTacts;
+    int tact = (state.prevClk > lineClk ? (int)(state.prevClk - lineClk) : 0);
+
+    for (; lineClk < nextClk; line++, lineClk += rasterTiming.lineTacts, tact = 0) {
+        int tactsLimit = (int)std::min(nextClk - lineClk, (unsigned long)RASTER_LINE_TACTS);
+        uint8_t* lineScr = state.into + (WIDTH * line);
+
+        if (line >= mode.paperFromLine && line < mode.paperToLine) {
+            tact = RenderBorderSpan(lineScr, tact, std::min(tactsLimit, mode.paperFromTact), borderColor);
+            int paperLimit = std::min(tactsLimit, mode.paperToTact);
+
+            // chunk is rendered when its first tact is reached, so tact stays aligned to chunks inside of the paper
+            if (tact < paperLimit) {
+                int fromChunk = (tact - mode.paperFromTact) / RASTER_CHUNK_TACTS;
+                int toChunk = (paperLimit - mode.paperFromTact + RASTER_CHUNK_TACTS - 1) / RASTER_CHUNK_TACTS;
+
+                mode.renderPaper(state, lineScr + (tact * RASTER_PIXELS_PER_TACT), line - mode.paperFromLine, fromChunk, toChunk);
+                tact = mode.paperFromTact + toChunk * RASTER_CHUNK_TACTS;
+            }
+        }
+
+        tact = RenderBorderSpan(lineScr, tact, tactsLimit, borderColor);
+        state.prevClk = lineClk + tact;
+    }
+}
+
+int Raster_GetMachineFlags(void) {
+    return (dev_border.portFB & RASTER_FLAGS_BORDER) | ((dev_mman.port7FFD & 8) ^ screensHack);
+}
+
+void Raster_ApplyFlags(s_RasterState& state, const uint8_t* pages, int flags) {
+    state.borderColor = (uint8_t)(flags & RASTER_FLAGS_BORDER);
+
+    if (flags & RASTER_FLAG_SHADOW_SCREEN) {
+        state.screenPage = pages + (RAM_BANK7 - RAM_BANK4);
+        state.screenPageB = pages + (RAM_BANK6 - RAM_BANK4);
+    } else {
+        state.screenPage = pages + (RAM_BANK5 - RAM_BANK4);
+        state.screenPageB = pages;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef _RENDER_RASTER_H_INCLUDED_
+#define _RENDER_RASTER_H_INCLUDED_
+
+#include <stdint.h>
+#include "params.h"
+
+// Visible area is WIDTH x HEIGHT pixels, 2 pixels per tact. Paper is rendered by chunks of 4 tacts (8 pixels).
+#define RASTER_PIXELS_PER_TACT 2
+#define RASTER_CHUNK_TACTS 4
+#define RASTER_LINE_TACTS (WIDTH / RASTER_PIXELS_PER_TACT)
+#define RASTER_LINE_CHUNKS (RASTER_LINE_TACTS / RASTER_CHUNK_TACTS)
+
+// Everything renderers read, so the picture is rendered either from the live machine (see Render() in zemu.cpp),
+// or from the frame record on the worker thread (see render_pipeline.h).
+struct s_RasterState {
+    uint8_t* into; // WIDTH x HEIGHT palette indices
+    unsigned long prevClk; // picture is rendered up to this tact
+    uint8_t borderColor;
+    const uint8_t* screenPage; // shown screen (bank 5 or 7)
+    const uint8_t* screenPageB; // bank below the shown screen (4 or 6), second half of the 16 colors picture
+    const uint8_t* attributeInk; // palette indices for every attribute, see RenderSpeccy_Prepare()
+    const uint8_t* attributePaper;
+};
+
+// Flags are the machine state between changes: border color and the shown screen (with screensHack applied)
+#define RASTER_FLAGS_BORDER 7
+#define RASTER_FLAG_SHADOW_SCREEN 8
+
+// Video pages are banks 4 - 7 as they are placed in C_MemoryManager::ram (or in the copy of them)
+#define RASTER_PAGES_SIZE (0x4000 * 4)
+
+// Only pentagon timing is supported, as everywhere else in the emulator (see MAX_FRAME_TACTS in params.h).
+// TODO: add scorpion support (http://www.worldofspectrum.org/rusfaq/index.html)
+struct s_RasterTiming {
+    int lineTacts; // whole line, including the retrace
+    int firstLineClk; // first tact of the first visible line
+    int visibleOffsetTacts; // first visible tact from the start of the line
+};
+
+// Mode is a table which maps tacts of the visible area to the paper rectangle, rest of the area is border.
+// All modes share one loop (see Raster_Render), which renders border spans and calls renderPaper once
+// for every span of paper chunks, so the mode only fetches video memory and expands it with the kernels.
+struct s_RasterMode {
+    int paperFromLine; // lines of the visible area
+    int paperToLine;
+    int paperFromTact; // tacts from the first visible tact of the line
+    int paperToTact;
+
+    // renders chunks from fromChunk up to toChunk of the paper line, into points to the pixels of fromChunk
+    void (* renderPaper)(const s_RasterState& state, uint8_t* into, int paperLine, int fromChunk, int toChunk);
+};
+
+typedef void (* ptrRenderFunc)(s_RasterState& state, unsigned long nextClk);
+
+extern const s_RasterTiming rasterTiming;
+
+extern uint16_t rasterBitmapOffsets[192]; // offsets of 256x192 bitmap lines in the screen page
+extern uint16_t rasterAttributeOffsets[192]; // offsets of 32x24 attribute lines in the screen page
+
+void Raster_Init(void);
+unsigned long Raster_GetScreenStartClk(void);
+unsigned long Raster_GetScreenEndClk(void);
+void Raster_Render(const s_RasterMode& mode, s_RasterState& state, unsigned long nextClk);
+int Raster_GetMachineFlags(void);
+void Raster_ApplyFlags(s_RasterState& state, const uint8_t* pages, int flags);
+
+#endif
@@ -1,77 +1,121 @@
 // This is an open source non-commercial project. Dear PVS-Studio, please check it.
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
+#include <string.h>
+#include <algorithm>
 #include "render_speccy.h"
-#include "render_common.h"
+#include "render_kernels.h"
+#include "zemu.h"
 
-void RenderSpeccy(unsigned long nextClk) {
-    int ci;
-    int cp;
-    int bt;
+// palette indices of ink and paper for every attribute, for every combination of flash phase and flashColor
+// (tables are not changed while frames are rendered, so the worker thread can use them)
+static uint8_t attributeInk[4][0x100];
+static uint8_t attributePaper[4][0x100];
+static bool isAttributeTablesBuilt = false;
 
-    #include "render_common_a.h"
+static void BuildAttributeTables(void) {
+    for (int key = 0; key < 4; key++) {
+        bool isFlashColor = (key & 2);
+        bool isFlashInverted = (key & 1);
 
-    zxScreen = ((dev_mman.port7FFD & 8) ^ screensHack) ? RAM_BANK7 : RAM_BANK5;
+        for (int cl = 0; cl < 0x100; cl++) {
+            int ci = ((cl & 64) >> 3) | (cl & 7);
+            int cp = ((cl & 64) >> 3) | ((cl >> 3) & 7);
 
-    if (!attributesHack) {
-        bt = dev_mman.ram[ zxScreen + ((zxLine & 0xC0) << 5) + ((zxLine & 7) << 8) + ((zxLine & 0x38) << 2) + pos ];
-        cl = dev_mman.ram[ zxScreen + 0x1800 + ((zxLine & 0xF8) << 2) + pos ];
+            if (isFlashColor) {
+                // flash is shown as the blend of ink and paper over black
+                cp = (cl >> 3) & 7;
 
-        if (flashColor) {
-            ci = colors[((cl & 64) >> 3) | (cl & 7)];
-            cp = (cl >> 3) & 7;
+                if (cp) {
+                    ci = PALETTE_BLEND(ci, cp);
+                }
 
-            if (cp) {
-                cp = colors[cp];
+                cp = PALETTE_BLACK;
+            } else if (isFlashInverted && (cl & 128)) {
+                std::swap(ci, cp);
+            }
+
+            attributeInk[key][cl] = (uint8_t)ci;
+            attributePaper[key][cl] = (uint8_t)cp;
+        }
+    }
 
-                int r = ((unsigned int)STAGE_GETR(ci) + (unsigned int)STAGE_GETR(cp)) >> 1;
-                int g = ((unsigned int)STAGE_GETG(ci) + (unsigned int)STAGE_GETG(cp)) >> 1;
-                int b = ((unsigned int)STAGE_GETB(ci) + (unsigned int)STAGE_GETB(cp)) >> 1;
+    isAttributeTablesBuilt = true;
+}
 
-                ci = STAGE_MAKERGB(r, g, b);
-            }
+// Bitmap is passed to the kernel as is, ink and paper of the span are collected from the attribute table.
+// Multicolor has attribute for every bitmap byte (0x2000 above it), instead of every 8x8 square.
+template <bool isMulticolor, int attrHack>
+static void RenderSpeccyPaper(const s_RasterState& state, uint8_t* into, int zxLine, int fromChunk, int toChunk) {
+    uint8_t hackBitmap[RASTER_LINE_CHUNKS];
+    uint8_t inkRun[RASTER_LINE_CHUNKS];
+    uint8_t paperRun[RASTER_LINE_CHUNKS];
 
-            cp = STAGE_MAKERGB(0, 0, 0);
-        } else {
-            if ((frames & 32) && (cl & 128)) {
-                cp = colors[((cl & 64) >> 3) | (cl & 7)];
-                ci = colors[((cl & 64) >> 3) | ((cl >> 3) & 7)];
+    const uint8_t* bitmap = state.screenPage + rasterBitmapOffsets[zxLine];
+
+    const uint8_t* attributes = (isMulticolor
+        ? bitmap + 0x2000
+        : state.screenPage + rasterAttributeOffsets[zxLine]
+    );
+
+    if (attrHack == 1) {
+        // checkerboard instead of attributes
+        int phase = (zxLine >> 3) & 1;
+
+        for (int pos = fromChunk; pos < toChunk; pos++) {
+            if (phase ^ (pos & 1)) {
+                inkRun[pos] = PALETTE_BLACK;
+                paperRun[pos] = PALETTE_LIGHT_GRAY;
             } else {
-                ci = colors[((cl & 64) >> 3) | (cl & 7)];
-                cp = colors[((cl & 64) >> 3) | ((cl >> 3) & 7)];
+                inkRun[pos] = PALETTE_DARK_GRAY;
+                paperRun[pos] = PALETTE_WHITE;
             }
         }
-    } else if (attributesHack == 1) {
-        bt = dev_mman.ram[ zxScreen + ((zxLine & 0xC0) << 5) + ((zxLine & 7) << 8) + ((zxLine & 0x38) << 2) + pos ];
-
-        if (((zxLine >> 3) & 1) ^ (pos & 1)) {
-            ci = STAGE_MAKERGB(0, 0, 0);
-            cp = STAGE_MAKERGB(192, 192, 192);
-        } else {
-            ci = STAGE_MAKERGB(64, 64, 64);
-            cp = STAGE_MAKERGB(255, 255, 255);
-        }
-    } else { // attributesHack == 2
-        bt = (((zxLine & 6) == 0 || (zxLine & 6) == 6) ? 0x00 : 0x3C);
-        cl = dev_mman.ram[ zxScreen + 0x1800 + ((zxLine & 0xF8) << 2) + pos ];
-
-        if ((frames & 32) && (cl & 128)) {
-            cp = colors[((cl & 64) >> 3) | (cl & 7)];
-            ci = colors[((cl & 64) >> 3) | ((cl >> 3) & 7)];
-        } else {
-            ci = colors[((cl & 64) >> 3) | (cl & 7)];
-            cp = colors[((cl & 64) >> 3) | ((cl >> 3) & 7)];
+    } else {
+        for (int pos = fromChunk; pos < toChunk; pos++) {
+            inkRun[pos] = state.attributeInk[attributes[pos]];
+            paperRun[pos] = state.attributePaper[attributes[pos]];
         }
     }
 
-    *(scr++) = (bt & 128 ? ci : cp);
-    *(scr++) = (bt &  64 ? ci : cp);
-    *(scr++) = (bt &  32 ? ci : cp);
-    *(scr++) = (bt &  16 ? ci : cp);
-    *(scr++) = (bt &   8 ? ci : cp);
-    *(scr++) = (bt &   4 ? ci : cp);
-    *(scr++) = (bt &   2 ? ci : cp);
-    *(scr)   = (bt &   1 ? ci : cp);
+    if (attrHack == 2) {
+        // attributes only, bitmap is replaced with boxes
+        int bt = ((isMulticolor || ((zxLine & 6) != 0 && (zxLine & 6) != 6)) ? 0x3C : 0x00);
+
+        memset(hackBitmap, bt, toChunk);
+        bitmap = hackBitmap;
+    }
+
+    renderKernels.expandBitmap(into, bitmap + fromChunk, inkRun + fromChunk, paperRun + fromChunk, toChunk - fromChunk);
+}
+
+template <bool isMulticolor, int attrHack>
+static const s_RasterMode speccyMode = {
+    32, 32 + 192,
+    16, 16 + 128,
+    RenderSpeccyPaper<isMulticolor, attrHack>
+};
+
+template <bool isMulticolor, int attrHack>
+static void RenderSpeccy(s_RasterState& state, unsigned long nextClk) {
+    Raster_Render(speccyMode<isMulticolor, attrHack>, state, nextClk);
+}
+
+ptrRenderFunc RenderSpeccy_Prepare(bool isMulticolor, s_RasterState& state) {
+    static const ptrRenderFunc renderers[2][3] = {
+        { RenderSpeccy<false, 0>, RenderSpeccy<false, 1>, RenderSpeccy<false, 2> },
+        { RenderSpeccy<true, 0>, RenderSpeccy<true, 1>, RenderSpeccy<true, 2> },
+    };
+
+    if (!isAttributeTablesBuilt) {
+        BuildAttributeTables();
+    }
+
+    // flashColor is not used with attributesHack
+    int key = ((flashColor && !attributesHack) ? 2 : 0) | ((flashFrames & 32) ? 1 : 0);
+
+    state.attributeInk = attributeInk[key];
+    state.attributePaper = attributePaper[key];
 
-    #include "render_common_b.h"
+    return renderers[isMulticolor ? 1 : 0][attributesHack];
 }
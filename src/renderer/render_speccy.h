@@ -1,6 +1,10 @@
 #ifndef _RENDER_SPECCY_H_INCLUDED_
 #define _RENDER_SPECCY_H_INCLUDED_
 
-void RenderSpeccy(unsigned long nextClk);
+#include "render_raster.h"
+
+// Selects attribute colors for the frame (flash phase, flashColor) and returns the renderer specialized
+// for the current attributesHack, so there are no flag tests while rendering. Must be called once per frame.
+ptrRenderFunc RenderSpeccy_Prepare(bool isMulticolor, s_RasterState& state);
 
 #endif
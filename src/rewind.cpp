@@ -0,0 +1,254 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <string.h>
+#include <vector>
+#include <deque>
+#include "zemu_env.h"
+#include "rewind.h"
+#include "state.h"
+#include "movie.h"
+#include "devs.h"
+
+#define REWIND_BLOCK_SIZE 256
+#define REWIND_MIN_ZERO_RUN 8 // shorter runs of unchanged bytes are kept inside literal
+
+struct s_RewindEntry {
+    std::vector<uint8_t> data; // XOR delta, or full previous state
+    size_t size; // size of both states
+    unsigned frames; // distance to the newer checkpoint
+    bool isFull;
+};
+
+static bool rewindEnabled = false;
+static void (* rewindHoldAction)(void) = nullptr;
+static unsigned rewindInterval = REWIND_DEFAULT_INTERVAL;
+static size_t rewindMemoryLimit = 0;
+static size_t rewindMemoryUsage = 0;
+static unsigned rewindFrames = 0;
+static std::deque<s_RewindEntry> rewindEntries;
+static std::vector<uint8_t> rewindLast;
+static std::vector<uint8_t> rewindCurrent;
+static std::vector<uint8_t> rewindEncoded;
+static std::vector<uint8_t> rewindMerged;
+static std::vector<uint8_t> rewindZeros;
+
+static void Rewind_WriteVarint(std::vector<uint8_t>& into, size_t value) {
+    while (value >= 0x80) {
+        into.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+
+    into.push_back((uint8_t)value);
+}
+
+static size_t Rewind_ReadVarint(const uint8_t*& ptr) {
+    size_t value = 0;
+    unsigned shift = 0;
+
+    for (;;) {
+        uint8_t byte = *(ptr++);
+        value |= (size_t)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) {
+            return value;
+        }
+
+        shift += 7;
+    }
+}
+
+static void Rewind_Encode(const uint8_t* older, const uint8_t* newer, size_t size, std::vector<uint8_t>& into) {
+    size_t pos = 0;
+    size_t emitted = 0;
+
+    into.clear();
+
+    for (;;) {
+        // unchanged pages are skipped with memcmp, so cost of the delta depends mostly on amount of changes
+        while (pos < size) {
+            if (pos + REWIND_BLOCK_SIZE <= size && !memcmp(older + pos, newer + pos, REWIND_BLOCK_SIZE)) {
+                pos += REWIND_BLOCK_SIZE;
+            } else if (older[pos] == newer[pos]) {
+                pos++;
+            } else {
+                break;
+            }
+        }
+
+        if (pos >= size) {
+            return;
+        }
+
+        size_t start = pos;
+        size_t zeros = 0;
+
+        while (pos < size && zeros < REWIND_MIN_ZERO_RUN) {
+            zeros = (older[pos] == newer[pos] ? zeros + 1 : 0);
+            pos++;
+        }
+
+        pos -= zeros;
+
+        Rewind_WriteVarint(into, start - emitted);
+        Rewind_WriteVarint(into, pos - start);
+
+        size_t at = into.size();
+        into.resize(at + pos - start);
+
+        for (size_t i = start; i < pos; i++) {
+            into[at++] = older[i] ^ newer[i];
+        }
+
+        emitted = pos;
+    }
+}
+
+static void Rewind_Apply(const std::vector<uint8_t>& delta, uint8_t* state) {
+    const uint8_t* ptr = delta.data();
+    const uint8_t* end = ptr + delta.size();
+
+    while (ptr < end) {
+        state += Rewind_ReadVarint(ptr);
+
+        for (size_t length = Rewind_ReadVarint(ptr); length; length--) {
+            *(state++) ^= *(ptr++);
+        }
+    }
+}
+
+static void Rewind_Merge(size_t index) {
+    s_RewindEntry& older = rewindEntries[index];
+    s_RewindEntry& newer = rewindEntries[index + 1];
+
+    rewindMerged.assign(older.size, 0);
+
+    if (rewindZeros.size() < older.size) {
+        rewindZeros.resize(older.size, 0);
+    }
+
+    Rewind_Apply(older.data, rewindMerged.data());
+    Rewind_Apply(newer.data, rewindMerged.data());
+    Rewind_Encode(rewindMerged.data(), rewindZeros.data(), older.size, rewindEncoded);
+
+    rewindMemoryUsage -= older.data.size() + newer.data.size();
+    older.data.assign(rewindEncoded.begin(), rewindEncoded.end());
+    older.frames += newer.frames;
+    rewindMemoryUsage += older.data.size();
+
+    rewindEntries.erase(rewindEntries.begin() + index + 1);
+}
+
+static void Rewind_Thin(void) {
+    while (rewindMemoryUsage > rewindMemoryLimit && !rewindEntries.empty()) {
+        size_t index = 0;
+
+        while (index + 1 < rewindEntries.size()
+            && (rewindEntries[index].frames != rewindEntries[index + 1].frames
+                || rewindEntries[index].isFull
+                || rewindEntries[index + 1].isFull
+            )
+        ) {
+            index++;
+        }
+
+        if (index + 1 < rewindEntries.size()) {
+            Rewind_Merge(index);
+        } else {
+            rewindMemoryUsage -= rewindEntries.front().data.size();
+            rewindEntries.pop_front();
+        }
+    }
+}
+
+static void Rewind_Checkpoint(void) {
+    rewindCurrent.clear();
+    State_Save(rewindCurrent);
+
+    if (!rewindLast.empty()) {
+        s_RewindEntry entry;
+        entry.size = rewindLast.size();
+        entry.frames = rewindFrames;
+        entry.isFull = (rewindLast.size() != rewindCurrent.size());
+
+        if (entry.isFull) {
+            entry.data.swap(rewindLast);
+        } else {
+            Rewind_Encode(rewindLast.data(), rewindCurrent.data(), entry.size, rewindEncoded);
+            entry.data.assign(rewindEncoded.begin(), rewindEncoded.end());
+        }
+
+        rewindMemoryUsage += entry.data.size();
+        rewindEntries.push_back(std::move(entry));
+    }
+
+    rewindLast.swap(rewindCurrent);
+    rewindFrames = 0;
+
+    Rewind_Thin();
+}
+
+static bool Rewind_StepBack(void) {
+    if (rewindEntries.empty()) {
+        return false;
+    }
+
+    s_RewindEntry& entry = rewindEntries.back();
+    rewindMemoryUsage -= entry.data.size();
+
+    if (entry.isFull) {
+        rewindLast.swap(entry.data);
+    } else {
+        Rewind_Apply(entry.data, rewindLast.data());
+    }
+
+    rewindEntries.pop_back();
+    return State_Load(rewindLast.data(), rewindLast.size());
+}
+
+static void Rewind_OnFrameStart(void) {
+    // checkpoints would desync movie
+    if (movieState != MOVIE_STATE_NONE) {
+        return;
+    }
+
+    if (C_Keyboard::IsActionHeld(rewindHoldAction)) {
+        SetMessage(Rewind_StepBack() ? "Rewind" : "Rewind buffer is empty");
+        rewindFrames = 0;
+        return;
+    }
+
+    if (++rewindFrames >= rewindInterval) {
+        Rewind_Checkpoint();
+    }
+}
+
+void Rewind_Init(void (* holdAction)(void)) {
+    auto config = host->config();
+
+    rewindEnabled = (config->getBool("core", "rewind", false) && !params.headless);
+    rewindInterval = (unsigned)std::max(1, config->getInt("core", "rewind_interval", REWIND_DEFAULT_INTERVAL));
+    rewindMemoryLimit = (size_t)std::max(1, config->getInt("core", "rewind_memory", REWIND_DEFAULT_MEMORY_MB)) << 20;
+
+    if (!rewindEnabled) {
+        return;
+    }
+
+    rewindHoldAction = holdAction;
+    AttachFrameStartHandler(Rewind_OnFrameStart);
+}
+
+void Rewind_Close(void) {
+    rewindEntries.clear();
+    rewindLast.clear();
+    rewindCurrent.clear();
+    rewindMemoryUsage = 0;
+}
+
+bool Rewind_IsEnabled(void) {
+    return rewindEnabled;
+}
+
+size_t Rewind_GetMemoryUsage(void) {
+    return rewindMemoryUsage;
+}
@@ -0,0 +1,21 @@
+#ifndef _REWIND_H_INCLUDED_
+#define _REWIND_H_INCLUDED_
+
+#include "zemu.h"
+
+// Rewind keeps the last checkpoint as full state (see state.h) and a list of deltas,
+// each of them leads from the checkpoint to the previous one. Delta is the XOR of two states,
+// encoded as (varint skip, varint length, length bytes) runs, so unchanged memory pages cost nothing.
+// Since XOR is symmetric, two adjacent deltas are merged by XOR-ing them. When memory limit is reached,
+// oldest deltas with the same span are merged (so older history becomes sparser), or the oldest one is dropped.
+// State with different size (e.g. disk was inserted) is stored as is.
+
+#define REWIND_DEFAULT_INTERVAL 1
+#define REWIND_DEFAULT_MEMORY_MB 32
+
+void Rewind_Init(void (* holdAction)(void));
+void Rewind_Close(void);
+bool Rewind_IsEnabled(void);
+size_t Rewind_GetMemoryUsage(void);
+
+#endif
@@ -2,73 +2,93 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include <stdio.h>
+#include <string.h>
+#include <vector>
 #include "zemu_env.h"
 #include "snap_sna.h"
 #include "zemu.h"
 
+#define SNA_HEADER_SIZE 27
+#define SNA_48K_SIZE (SNA_HEADER_SIZE + 0xC000)
+#define SNA_128K_HEADER_SIZE 4
+
+static inline uint16_t sna_word(const uint8_t* ptr) {
+    return ZEMU_MAKEWORD(ptr[1], ptr[0]);
+}
+
 bool load_sna_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border) {
     bool banks[8];
-    uint8_t buffer[16384];
-    DataReaderPtr reader;
+    std::vector<uint8_t> data;
 
     try {
-        reader = host->storage()->path(filename)->dataReader();
+        host->storage()->path(filename)->readAll(data);
     } catch (StorageException& e) {
         printf("Load failed: %s\n", e.what());
         return false;
     }
 
-    z80ex_set_reg(cpu, regI, reader->readByte());
-    z80ex_set_reg(cpu, regHL_, reader->readWord());
-    z80ex_set_reg(cpu, regDE_, reader->readWord());
-    z80ex_set_reg(cpu, regBC_, reader->readWord());
-    z80ex_set_reg(cpu, regAF_, reader->readWord());
-    z80ex_set_reg(cpu, regHL, reader->readWord());
-    z80ex_set_reg(cpu, regDE, reader->readWord());
-    z80ex_set_reg(cpu, regBC, reader->readWord());
-    z80ex_set_reg(cpu, regIY, reader->readWord());
-    z80ex_set_reg(cpu, regIX, reader->readWord());
+    if (data.size() < SNA_48K_SIZE) {
+        printf("Load failed: \"%s\" is too short\n", filename);
+        return false;
+    }
+
+    bool is_48k = (data.size() == SNA_48K_SIZE);
+    const uint8_t* ptr = data.data();
+
+    // first check that all 128k banks are here, to not leave half-loaded machine
+    if (!is_48k) {
+        int paged_bank = (data.size() < SNA_48K_SIZE + SNA_128K_HEADER_SIZE ? 0 : ptr[SNA_48K_SIZE + 2] & 7);
+        int missing = ((paged_bank == 2 || paged_bank == 5) ? 6 : 5);
+
+        if (data.size() < SNA_48K_SIZE + SNA_128K_HEADER_SIZE + (size_t)missing * 0x4000) {
+            printf("Load failed: \"%s\" is too short\n", filename);
+            return false;
+        }
+    }
+
+    z80ex_set_reg(cpu, regI, ptr[0]);
+    z80ex_set_reg(cpu, regHL_, sna_word(ptr + 1));
+    z80ex_set_reg(cpu, regDE_, sna_word(ptr + 3));
+    z80ex_set_reg(cpu, regBC_, sna_word(ptr + 5));
+    z80ex_set_reg(cpu, regAF_, sna_word(ptr + 7));
+    z80ex_set_reg(cpu, regHL, sna_word(ptr + 9));
+    z80ex_set_reg(cpu, regDE, sna_word(ptr + 11));
+    z80ex_set_reg(cpu, regBC, sna_word(ptr + 13));
+    z80ex_set_reg(cpu, regIY, sna_word(ptr + 15));
+    z80ex_set_reg(cpu, regIX, sna_word(ptr + 17));
 
-    uint8_t intm = reader->readByte();
+    uint8_t intm = ptr[19];
 
     z80ex_set_reg(cpu, regIFF1, intm & 1);
     z80ex_set_reg(cpu, regIFF2, (intm >> 1) & 1);
 
-    z80ex_set_reg(cpu, regR, reader->readByte());
-    z80ex_set_reg(cpu, regAF, reader->readWord());
-    z80ex_set_reg(cpu, regSP, reader->readWord());
-    z80ex_set_reg(cpu, regIM, reader->readByte());
+    z80ex_set_reg(cpu, regR, ptr[20]);
+    z80ex_set_reg(cpu, regAF, sna_word(ptr + 21));
+    z80ex_set_reg(cpu, regSP, sna_word(ptr + 23));
+    z80ex_set_reg(cpu, regIM, ptr[25]);
 
-    uint8_t border_color = reader->readByte();
+    uint8_t border_color = ptr[26];
+    ptr += SNA_HEADER_SIZE;
     mmgr.OnReset();
 
     for (int i = 0; i < 8; i++) {
         banks[i] = false;
     }
 
-    for (int i = 0; i < 16384; i++) {
-        mmgr.OnWriteByte(i + 16384, reader->readByte());
-    }
-
+    memcpy(&mmgr.ram[RAM_BANK5], ptr, 0x4000);
     banks[5] = true;
 
-    for (int i = 0; i < 16384; i++) {
-        mmgr.OnWriteByte(i + 32768, reader->readByte());
-    }
-
+    memcpy(&mmgr.ram[RAM_BANK2], ptr + 0x4000, 0x4000);
     banks[2] = true;
 
-    for (int i = 0; i < 16384; i++) {
-        buffer[i] = reader->readByte();
-    }
+    // third bank is paged at 0xC000, it is known only after 128k header
+    const uint8_t* paged = ptr + 0x8000;
+    ptr += 0xC000;
 
-    if (reader->isEof()) {
+    if (is_48k) {
+        memcpy(&mmgr.ram[0], paged, 0x4000);
         mmgr.OnOutputByte(0x7ffd, 0x30); // set 48k mode
 
-        for (int i = 0; i < 16384; i++) {
-            mmgr.OnWriteByte(i + 49152, buffer[i]);
-        }
-
         uint16_t sp = z80ex_get_reg(cpu, regSP);
 
         uint8_t retval = ReadByteDasm(sp, nullptr);
@@ -84,15 +104,12 @@ bool load_sna_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
         z80ex_set_reg(cpu, regSP, sp);
         z80ex_set_reg(cpu, regPC, pc);
     } else {
-        z80ex_set_reg(cpu, regPC, reader->readWord());
-        uint8_t port_7ffd = reader->readByte();
-        uint8_t is_trdos = reader->readByte();
-        mmgr.OnOutputByte(0x7ffd, port_7ffd & 7);
-
-        for (int i = 0; i < 16384; i++) {
-            mmgr.OnWriteByte(i + 49152, buffer[i]);
-        }
+        z80ex_set_reg(cpu, regPC, sna_word(ptr));
+        uint8_t port_7ffd = ptr[2];
+        uint8_t is_trdos = ptr[3];
+        ptr += SNA_128K_HEADER_SIZE;
 
+        memcpy(&mmgr.ram[0x4000 * (port_7ffd & 7)], paged, 0x4000);
         banks[port_7ffd & 7] = true;
 
         for (int k = 0; k < 8; k++) {
@@ -100,11 +117,8 @@ bool load_sna_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
                 continue;
             }
 
-            mmgr.OnOutputByte(0x7ffd, k);
-
-            for (int i = 0; i < 16384; i++) {
-                mmgr.OnWriteByte(i + 49152, reader->readByte());
-            }
+            memcpy(&mmgr.ram[0x4000 * k], ptr, 0x4000);
+            ptr += 0x4000;
         }
 
         C_TrDos::trdos = (is_trdos != 0);
@@ -117,29 +131,29 @@ bool load_sna_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
     return true;
 }
 
-bool save_sna_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border) {
-    bool banks[8];
-    DataWriterPtr writer;
+static inline void sna_put_word(std::vector<uint8_t>& into, uint16_t value) {
+    into.push_back((uint8_t)(value & 0xFF));
+    into.push_back((uint8_t)(value >> 8));
+}
 
-    try {
-        writer = host->storage()->path(filename)->dataWriter();
-    } catch (StorageException& e) {
-        printf("Write failed: %s\n", e.what());
-        return false;
-    }
+void capture_sna_snap(std::vector<uint8_t>& into, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border) {
+    bool banks[8];
 
-    writer->writeByte(z80ex_get_reg(cpu, regI));
-    writer->writeWord(z80ex_get_reg(cpu, regHL_));
-    writer->writeWord(z80ex_get_reg(cpu, regDE_));
-    writer->writeWord(z80ex_get_reg(cpu, regBC_));
-    writer->writeWord(z80ex_get_reg(cpu, regAF_));
-    writer->writeWord(z80ex_get_reg(cpu, regHL));
-    writer->writeWord(z80ex_get_reg(cpu, regDE));
-    writer->writeWord(z80ex_get_reg(cpu, regBC));
-    writer->writeWord(z80ex_get_reg(cpu, regIY));
-    writer->writeWord(z80ex_get_reg(cpu, regIX));
-
-    writer->writeByte((z80ex_get_reg(cpu, regIFF1) ? 1 : 0) | (z80ex_get_reg(cpu, regIFF2) ? 2 : 0));
+    into.clear();
+    into.reserve(SNA_48K_SIZE + SNA_128K_HEADER_SIZE + 0x4000 * 6);
+
+    into.push_back(z80ex_get_reg(cpu, regI));
+    sna_put_word(into, z80ex_get_reg(cpu, regHL_));
+    sna_put_word(into, z80ex_get_reg(cpu, regDE_));
+    sna_put_word(into, z80ex_get_reg(cpu, regBC_));
+    sna_put_word(into, z80ex_get_reg(cpu, regAF_));
+    sna_put_word(into, z80ex_get_reg(cpu, regHL));
+    sna_put_word(into, z80ex_get_reg(cpu, regDE));
+    sna_put_word(into, z80ex_get_reg(cpu, regBC));
+    sna_put_word(into, z80ex_get_reg(cpu, regIY));
+    sna_put_word(into, z80ex_get_reg(cpu, regIX));
+
+    into.push_back((z80ex_get_reg(cpu, regIFF1) ? 1 : 0) | (z80ex_get_reg(cpu, regIFF2) ? 2 : 0));
     uint16_t sp = z80ex_get_reg(cpu, regSP);
 
     if (mmgr.port7FFD == 0x30) {
@@ -147,66 +161,51 @@ bool save_sna_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
         sp -= 2;
     }
 
-    writer->writeByte(z80ex_get_reg(cpu, regR));
-    writer->writeWord(z80ex_get_reg(cpu, regAF));
-    writer->writeWord(sp);
-    writer->writeByte(z80ex_get_reg(cpu, regIM));
-
-    writer->writeByte(border.portFB & 7);
-    uint8_t buffer[0xC000];
+    into.push_back(z80ex_get_reg(cpu, regR));
+    sna_put_word(into, z80ex_get_reg(cpu, regAF));
+    sna_put_word(into, sp);
+    into.push_back(z80ex_get_reg(cpu, regIM));
+    into.push_back(border.portFB & 7);
 
     for (int i = 0; i < 8; i++) {
         banks[i] = false;
     }
 
-    for (int i = 0; i < 0x4000; i++) {
-        buffer[i] = mmgr.ram[5 * 0x4000 + i];
-    }
-
+    into.insert(into.end(), &mmgr.ram[RAM_BANK5], &mmgr.ram[RAM_BANK5 + 0x4000]);
     banks[5] = true;
 
-    for (int i = 0; i < 0x4000; i++) {
-        buffer[i + 0x4000] = mmgr.ram[2 * 0x4000 + i];
-    }
-
+    into.insert(into.end(), &mmgr.ram[RAM_BANK2], &mmgr.ram[RAM_BANK2 + 0x4000]);
     banks[2] = true;
+
     uint16_t pc = z80ex_get_reg(cpu, regPC);
 
     if (mmgr.port7FFD == 0x30) { // 48k
-        for (int i = 0; i < 16384; i++) {
-            buffer[i + 0x8000] = mmgr.ram[i];
-        }
+        into.insert(into.end(), &mmgr.ram[0], &mmgr.ram[0x4000]);
 
         if (sp >= 0x4000) {
-            buffer[sp - 0x4000] = (uint8_t)(pc & 0xFF);
+            into[SNA_HEADER_SIZE + sp - 0x4000] = (uint8_t)(pc & 0xFF);
         }
 
         sp++;
 
         if (sp >= 0x4000) {
-            buffer[sp - 0x4000] = (uint8_t)(pc >> 8);
+            into[SNA_HEADER_SIZE + sp - 0x4000] = (uint8_t)(pc >> 8);
         }
-
-        writer->writeBlock(buffer, 0xC000);
     } else {
-        writer->writeBlock(buffer, 0x8000);
-
         int bank = mmgr.port7FFD & 7;
-        writer->writeBlock(&mmgr.ram[0x4000 * bank], 0x4000);
+        into.insert(into.end(), &mmgr.ram[0x4000 * bank], &mmgr.ram[0x4000 * bank + 0x4000]);
         banks[bank] = true;
 
-        writer->writeWord(pc);
-        writer->writeByte(mmgr.port7FFD);
-        writer->writeByte(C_TrDos::trdos ? 1 : 0);
+        sna_put_word(into, pc);
+        into.push_back(mmgr.port7FFD);
+        into.push_back(C_TrDos::trdos ? 1 : 0);
 
         for (int k = 0; k < 8; k++) {
             if (banks[k]) {
                 continue;
             }
 
-            writer->writeBlock(&mmgr.ram[0x4000 * k], 0x4000);
+            into.insert(into.end(), &mmgr.ram[0x4000 * k], &mmgr.ram[0x4000 * k + 0x4000]);
         }
     }
-
-    return true;
 }
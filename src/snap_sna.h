@@ -1,11 +1,12 @@
 #ifndef _SNAP_SNA_H_INCLUDED_
 #define _SNAP_SNA_H_INCLUDED_
 
+#include <vector>
 #include "devices/mmanager/mmanager.h"
 #include "devices/border/border.h"
 #include "devices/trdos/trdos.h"
 
 bool load_sna_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
-bool save_sna_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
+void capture_sna_snap(std::vector<uint8_t>& into, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
 
 #endif
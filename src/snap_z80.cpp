@@ -2,7 +2,10 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
 #include <stdexcept>
+#include <algorithm>
+#include <vector>
 #include <stdio.h>
+#include <string.h>
 #include "zemu_env.h"
 #include "snap_z80.h"
 
@@ -58,60 +61,74 @@ struct Z80_snap_header {
 
 #pragma pack(pop)
 
-bool block_read(DataReaderPtr& reader, C_MemoryManager& mmgr, uint16_t mem_offset, uint16_t len, int is_compressed) {
-    uint8_t b = 0;
-    uint8_t b_prev = 0;
+#define Z80_V2_ADD_HEADER_SIZE 23
+#define Z80_PAGES 8
+#define Z80_PAGE_BLOCK_SIZE (3 + 0x4000)
 
-    for (unsigned addr = mem_offset; addr < mem_offset + len; b_prev = b) {
-        if (reader->isEof()) {
+// Decodes one block straight into the memory page. Compressed data uses "ED ED count byte" runs.
+static bool block_read(const uint8_t*& ptr, const uint8_t* end, uint8_t* into, unsigned len, bool is_compressed) {
+    if (!is_compressed) {
+        if ((size_t)(end - ptr) < len) {
             return false;
         }
 
-        b = reader->readByte();
-
-        if (is_compressed && b == 0xED && b_prev == 0xED) {
-            if (reader->isEof()) {
-                return false;
-            }
+        memcpy(into, ptr, len);
+        ptr += len;
+        return true;
+    }
 
-            uint8_t rep_count = reader->readByte();
+    uint8_t* into_end = into + len;
 
-            if (reader->isEof()) {
-                return false;
-            }
+    while (into < into_end) {
+        if (ptr >= end) {
+            return false;
+        }
 
-            uint8_t rep_byte = reader->readByte();
+        uint8_t b = *(ptr++);
 
-            for (int cb = 0; cb < rep_count; cb++) {
-                mmgr.OnWriteByte(addr + cb - 1, rep_byte);
-            }
+        if (b != 0xED || ptr >= end || *ptr != 0xED) {
+            *(into++) = b;
+            continue;
+        }
 
-            addr += rep_count - 1;
-            b = 0;
-        } else {
-            mmgr.OnWriteByte(addr++, b);
+        if (end - ptr < 3) {
+            return false;
         }
+
+        size_t rep_count = std::min((size_t)ptr[1], (size_t)(into_end - into));
+        memset(into, ptr[2], rep_count);
+
+        into += rep_count;
+        ptr += 3;
     }
 
     return true;
 }
 
+// Page numbers of 48k snapshot in the order of 0x4000, 0x8000 and 0xC000 banks.
+static const unsigned z80_48k_banks[] = { 5, 2, 0 };
+
 bool load_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border) {
-    DataReaderPtr reader;
+    std::vector<uint8_t> data;
 
     try {
-        reader = host->storage()->path(filename)->dataReader();
+        host->storage()->path(filename)->readAll(data);
     } catch (StorageException& e) {
         printf("Load failed: %s\n", e.what());
         return false;
     }
 
+    const uint8_t* ptr = data.data();
+    const uint8_t* end = ptr + data.size();
     Z80_snap_header hdr;
 
-    if (reader->readBlock(&hdr, sizeof(hdr)) != sizeof(hdr)) {
+    if (data.size() < sizeof(hdr)) {
         return false;
     }
 
+    memcpy(&hdr, ptr, sizeof(hdr));
+    ptr += sizeof(hdr);
+
     z80ex_set_reg(cpu, regAF, ZEMU_MAKEWORD(hdr.A, hdr.F));
     z80ex_set_reg(cpu, regBC, ZEMU_MAKEWORD(hdr.B, hdr.C));
     z80ex_set_reg(cpu, regHL, ZEMU_MAKEWORD(hdr.H, hdr.L));
@@ -124,7 +141,7 @@ bool load_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
 
     z80ex_set_reg(cpu, regR, ((hdr.R7_n_misc & 0x01) << 7) | (hdr.R & 0x7F));
     uint8_t border_color = (hdr.R7_n_misc >> 1) & 0x07;
-    int is_compressed = hdr.R7_n_misc & 0x20;
+    bool is_compressed = (hdr.R7_n_misc & 0x20) != 0;
 
     z80ex_set_reg(cpu, regDE, ZEMU_MAKEWORD(hdr.D, hdr.E));
     z80ex_set_reg(cpu, regBC_, ZEMU_MAKEWORD(hdr.B_, hdr.C_));
@@ -140,135 +157,115 @@ bool load_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
     mmgr.OnReset();
     int ver = 1;
 
-    if (hdr.PCh | hdr.PCl) { // PC != 0: Z80 v1
-        // read 48k block
-        if (!block_read(reader, mmgr, 0x4000, 0xC000, is_compressed)) {
-            return false;
-        }
+    try {
+        if (hdr.PCh | hdr.PCl) { // PC != 0: Z80 v1
+            // read 48k block (it is single stream, so it can't be decoded into pages directly)
+            uint8_t buffer[0xC000];
 
-        mmgr.OnOutputByte(0x7ffd, 0x30); // set 48k mode
-        z80ex_set_reg(cpu, regPC, ZEMU_MAKEWORD(hdr.PCh, hdr.PCl));
-    } else { // Z80 v2 or v3
-        if (reader->isEof()) {
-            return false;
-        }
+            if (!block_read(ptr, end, buffer, sizeof(buffer), is_compressed)) {
+                throw std::runtime_error("SnapZ80: Unexpected EOF");
+            }
 
-        uint16_t tmp = reader->readWord(); // additional block length
+            for (int i = 0; i < 3; i++) {
+                memcpy(&mmgr.ram[0x4000 * z80_48k_banks[i]], &buffer[0x4000 * i], 0x4000);
+            }
 
-        switch (tmp & 0xFF) { // can we use just "tmp" ?
-            case 23:
-                ver = 2;
-                break;
+            mmgr.OnOutputByte(0x7ffd, 0x30); // set 48k mode
+            z80ex_set_reg(cpu, regPC, ZEMU_MAKEWORD(hdr.PCh, hdr.PCl));
+        } else { // Z80 v2 or v3
+            if (end - ptr < 2) {
+                throw std::runtime_error("SnapZ80: Unexpected EOF");
+            }
 
-            case 54: // fallthrough
-            case 55:
-                ver = 3;
-                break;
+            unsigned tmp = ZEMU_MAKEWORD(ptr[1], ptr[0]); // additional block length
+            ptr += 2;
 
-            default:
-                ver = 3;
-        }
+            switch (tmp & 0xFF) { // can we use just "tmp" ?
+                case 23:
+                    ver = 2;
+                    break;
 
-        uint8_t* header_add = new uint8_t[tmp];
+                case 54: // fallthrough
+                case 55:
+                    ver = 3;
+                    break;
 
-        try {
-            if (reader->readBlock(header_add, tmp) != tmp) {
+                default:
+                    ver = 3;
+            }
+
+            if ((unsigned)(end - ptr) < tmp || tmp < 6) {
                 throw std::runtime_error("SnapZ80: Unexpected EOF");
             }
 
+            const uint8_t* header_add = ptr;
+            ptr += tmp;
+
             z80ex_set_reg(cpu, regPC, ZEMU_MAKEWORD(header_add[1], header_add[0]));
             uint8_t mode = header_add[2];
+            bool is_48k;
+            int pages;
 
             if (mode == 10) {
                 // TODO: Scorpion256 mode
                 throw std::runtime_error("SnapZ80: Scorpion256 mode is not supported");
             } else if ((ver == 2 && mode < 3) || (ver == 3 && mode < 4)) {
-                // 48k or 16k mode
-                int pages;
+                is_48k = true;
+                pages = ((header_add[5] & 0x80) ? 1 : 3); // 16k or 48k
+            } else {
+                is_48k = false;
+                pages = 8;
+            }
 
-                if (header_add[5] & 0x80) {
-                    pages = 1; // 16k
-                } else {
-                    pages = 3; // 48k
+            for (int i = 0; i < pages; ++i) {
+                if (end - ptr < 3) {
+                    throw std::runtime_error("SnapZ80: Unexpected EOF");
                 }
 
-                // set 48k mode
-                mmgr.OnOutputByte(0x7ffd, 0x30);
-
-                for (int i = 0; i < pages; ++i) {
-                    if (reader->isEof()) {
-                        throw std::runtime_error("SnapZ80: Unexpected EOF");
-                    }
-
-                    tmp = reader->readWord();
-                    is_compressed = (tmp != 0xFFFF);
-
-                    if (reader->isEof()) {
-                        throw std::runtime_error("SnapZ80: Unexpected EOF");
-                    }
-
-                    uint8_t page_num = reader->readByte();
-
-                    switch (page_num) {
-                        case 4:
-                            if (!block_read(reader, mmgr, 0x8000, 0x4000, is_compressed)) {
-                                throw std::runtime_error("SnapZ80: Unexpected EOF");
-                            }
-
-                            break;
-
-                        case 5:
-                            if (!block_read(reader, mmgr, 0xC000, 0x4000, is_compressed)) {
-                                throw std::runtime_error("SnapZ80: Unexpected EOF");
-                            }
-
-                            break;
+                tmp = ZEMU_MAKEWORD(ptr[1], ptr[0]);
+                uint8_t page_num = ptr[2];
+                ptr += 3;
 
-                        case 8:
-                            if (!block_read(reader, mmgr, 0x4000, 0x4000, is_compressed)) {
-                                throw std::runtime_error("SnapZ80: Unexpected EOF");
-                            }
+                int bank;
 
-                            break;
-
-                        default: // unknown page
-                            throw std::runtime_error(std::string("SnapZ80: Unknown page number: ") + std::to_string(page_num));
-                    }
+                if (!is_48k) {
+                    bank = page_num - 3;
+                } else if (page_num == 4) {
+                    bank = 2;
+                } else if (page_num == 5) {
+                    bank = 0;
+                } else if (page_num == 8) {
+                    bank = 5;
+                } else {
+                    bank = -1;
                 }
-            } else {
-                // 128k mode
 
-                for (int i = 0; i < 8; i++) {
-                    if (reader->isEof()) {
-                        throw std::runtime_error("SnapZ80: Unexpected EOF");
-                    }
-
-                    tmp = reader->readWord();
-                    is_compressed = (tmp != 0xFFFF);
+                if (bank < 0 || bank > 7) { // unknown page
+                    throw std::runtime_error(std::string("SnapZ80: Unknown page number: ") + std::to_string(page_num));
+                }
 
-                    if (reader->isEof()) {
-                        throw std::runtime_error("SnapZ80: Unexpected EOF");
-                    }
+                is_compressed = (tmp != 0xFFFF);
 
-                    uint8_t page_num = reader->readByte();
-                    mmgr.OnOutputByte(0x7ffd, page_num - 3);
+                // compressed length limits the input, so broken block can't eat the next one
+                const uint8_t* block_end = ((is_compressed && (unsigned)(end - ptr) > tmp) ? ptr + tmp : end);
 
-                    if (!block_read(reader, mmgr, 0xC000, 0x4000, is_compressed)) {
-                        throw std::runtime_error("SnapZ80: Unexpected EOF");
-                    }
+                if (!block_read(ptr, block_end, &mmgr.ram[0x4000 * bank], 0x4000, is_compressed)) {
+                    throw std::runtime_error("SnapZ80: Unexpected EOF");
                 }
 
-                mmgr.OnOutputByte(0x7ffd, header_add[3]);
+                if (is_compressed) {
+                    ptr = block_end;
+                }
             }
 
-            // TODO: set fffd, 1ffd ports, AY/YM registers
-            delete[] header_add;
-        } catch (std::exception &e) {
-            printf("%s\n", e.what());
+            // set 48k mode or restore paging
+            mmgr.OnOutputByte(0x7ffd, is_48k ? 0x30 : header_add[3]);
 
-            delete[] header_add;
-            return false;
+            // TODO: set fffd, 1ffd ports, AY/YM registers
         }
+    } catch (std::exception& e) {
+        printf("%s\n", e.what());
+        return false;
     }
 
     // set border color
@@ -277,17 +274,10 @@ bool load_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
     return true;
 }
 
-bool save_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border) {
+// Pages are stored uncompressed, so capture is just a copy. Use pack_z80_snap() to compress them later.
+void capture_z80_snap(std::vector<uint8_t>& into, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border) {
     Z80_snap_header hdr;
-    uint8_t add_header[23]; // Z80 v3 header
-    DataWriterPtr writer;
-
-    try {
-        writer = host->storage()->path(filename)->dataWriter();
-    } catch (StorageException& e) {
-        printf("Write failed: %s\n", e.what());
-        return false;
-    }
+    uint8_t add_header[Z80_V2_ADD_HEADER_SIZE] = {};
 
     hdr.A = z80ex_get_reg(cpu, regAF) >> 8;
     hdr.F = z80ex_get_reg(cpu, regAF) & 0xFF;
@@ -320,8 +310,14 @@ bool save_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
     hdr.PCh = 0; // Z80 v2
     hdr.PCl = 0; // Z80 v2
 
-    writer->writeBlock(&hdr, sizeof(hdr));
-    writer->writeWord(sizeof(add_header));
+    into.resize(sizeof(hdr) + 2 + sizeof(add_header) + Z80_PAGES * Z80_PAGE_BLOCK_SIZE);
+    uint8_t* ptr = into.data();
+
+    memcpy(ptr, &hdr, sizeof(hdr));
+    ptr += sizeof(hdr);
+
+    *(ptr++) = sizeof(add_header);
+    *(ptr++) = 0;
 
     // TODO: save 48k properly
 
@@ -330,16 +326,83 @@ bool save_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mm
     add_header[2] = 9; // Pentagon
     add_header[3] = mmgr.port7FFD;
 
-    writer->writeBlock(add_header, sizeof(add_header));
+    memcpy(ptr, add_header, sizeof(add_header));
+    ptr += sizeof(add_header);
+
+    for (int i = 0; i < Z80_PAGES; i++) {
+        *(ptr++) = 0xFF; // not compressed
+        *(ptr++) = 0xFF;
+        *(ptr++) = i + 3; // page
+
+        memcpy(ptr, &mmgr.ram[i * 0x4000], 0x4000);
+        ptr += 0x4000;
+    }
+}
 
-    for (int i = 0; i < 8; i++) {
-        writer->writeWord(0xFFFF); // not compressed
-        writer->writeByte(i + 3); // page
+static void block_write(const uint8_t* data, const uint8_t* end, std::vector<uint8_t>& into) {
+    while (data < end) {
+        uint8_t b = *data;
+        const uint8_t* run_end = data + 1;
 
-        for (int j = i * 0x4000; j < i * 0x4000 + 0x4000; j++) {
-            writer->writeByte(mmgr.ram[j]);
+        while (run_end < end && *run_end == b && run_end - data < 255) {
+            run_end++;
+        }
+
+        size_t count = run_end - data;
+
+        // run of two ED bytes must be encoded, otherwise it will be taken as the start of run
+        if (count >= 5 || (b == 0xED && count >= 2)) {
+            into.push_back(0xED);
+            into.push_back(0xED);
+            into.push_back((uint8_t)count);
+            into.push_back(b);
+            data = run_end;
+        } else if (b == 0xED) {
+            // byte after single ED is never taken into the run
+            into.push_back(b);
+            data++;
+
+            if (data < end) {
+                into.push_back(*(data++));
+            }
+        } else {
+            into.push_back(b);
+            data++;
         }
     }
+}
 
-    return true;
+// Compresses pages of the snapshot made with capture_z80_snap().
+void pack_z80_snap(std::vector<uint8_t>& data) {
+    size_t pages_offset = sizeof(Z80_snap_header) + 2 + Z80_V2_ADD_HEADER_SIZE;
+
+    if (data.size() != pages_offset + Z80_PAGES * Z80_PAGE_BLOCK_SIZE) {
+        return;
+    }
+
+    std::vector<uint8_t> packed(data.begin(), data.begin() + pages_offset);
+    packed.reserve(data.size());
+
+    for (int i = 0; i < Z80_PAGES; i++) {
+        const uint8_t* block = &data[pages_offset + i * Z80_PAGE_BLOCK_SIZE];
+        size_t block_offset = packed.size();
+
+        packed.push_back(0);
+        packed.push_back(0);
+        packed.push_back(block[2]);
+
+        block_write(block + 3, block + Z80_PAGE_BLOCK_SIZE, packed);
+        size_t length = packed.size() - block_offset - 3;
+
+        if (length >= 0x4000) {
+            // compressed data can't be larger than the page, store it as is
+            packed.resize(block_offset);
+            packed.insert(packed.end(), block, block + Z80_PAGE_BLOCK_SIZE);
+        } else {
+            packed[block_offset] = (uint8_t)(length & 0xFF);
+            packed[block_offset + 1] = (uint8_t)(length >> 8);
+        }
+    }
+
+    data.swap(packed);
 }
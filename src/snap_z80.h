@@ -1,10 +1,12 @@
 #ifndef _SNAP_Z80_H_INCLUDED_
 #define _SNAP_Z80_H_INCLUDED_
 
+#include <vector>
 #include "devices/mmanager/mmanager.h"
 #include "devices/border/border.h"
 
 bool load_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
-bool save_z80_snap(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
+void capture_z80_snap(std::vector<uint8_t>& into, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
+void pack_z80_snap(std::vector<uint8_t>& data);
 
 #endif
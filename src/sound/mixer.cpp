@@ -3,61 +3,59 @@
 
 #include <assert.h>
 #include "mixer.h"
+#include "state.h"
+#include "capture.h"
 
 #define MIXER_FULL_VOL_MASK 1
 #define MIXER_SMART_MASK 2
 
 C_SoundMixer soundMixer;
 
-C_SoundMixer::~C_SoundMixer() {
-    if (!initialized || !wavDataWriter) {
-        return;
-    }
+void C_SoundMixer::Init(int mixerMode) { //-V688
+    this->mixerMode = mixerMode;
+    initialized = true;
+}
+
+void C_SoundMixer::EnableHash(void) {
+    hashEnabled = true;
+    hash = 0xCBF29CE484222325ULL;
+}
+
+uint64_t C_SoundMixer::GetHash(void) {
+    return hash;
+}
+
+// samples, which are not yet flushed, are stored to keep the sound stream continuous after load
+void C_SoundMixer::SaveState(C_StateWriter& writer) {
+    unsigned maxSamples = 0;
 
-    try {
-        wavDataWriter = nullptr;
-
-        // TODO: use appropriate library for writing wave files where available
-        long wavSz = (long)wavTempPath->fileSize();
-
-        wavDataWriter = wavPath->dataWriter();
-        wavDataWriter->writeDword(0x46464952);
-        wavDataWriter->writeDword(wavSz + 0x40 - 8); // TODO: shouldn't it be (44 - 8) = 36?
-        wavDataWriter->writeDword(0x45564157);
-        wavDataWriter->writeDword(0x20746D66);
-        wavDataWriter->writeDword(0x10);
-        wavDataWriter->writeWord(1);
-        wavDataWriter->writeWord(2);
-        wavDataWriter->writeDword(SOUND_FREQ);
-        wavDataWriter->writeDword(SOUND_FREQ * 4);
-        wavDataWriter->writeWord(4);
-        wavDataWriter->writeWord(16);
-        wavDataWriter->writeDword(0x61746164);
-        wavDataWriter->writeDword(wavSz);
-
-        auto wavTmpReader = wavTempPath->dataReader();
-
-        while (!wavTmpReader->isEof()) {
-            wavDataWriter->writeByte(wavTmpReader->readByte());
+    for (auto source : sources) {
+        if (source->samples > maxSamples) {
+            maxSamples = source->samples;
         }
+    }
+
+    writer.WriteWord(maxSamples);
 
-        wavDataWriter = nullptr;
-        wavTempPath->remove();
-    } catch (...) {
-        printf("Unknown error occurred while finishing .wav\n");
+    for (unsigned i = 0; i < maxSamples; i++) {
+        writer.WriteDword(mixBuffer[i].left);
+        writer.WriteDword(mixBuffer[i].right);
     }
 }
 
-void C_SoundMixer::Init(int mixerMode, bool recordWav, const char* wavName) { //-V688
-    this->mixerMode = mixerMode;
-
-    if (recordWav && *wavName) {
-        wavPath = host->storage()->path(wavName);
-        wavTempPath = wavPath->concat(".tmp");
-        wavDataWriter = wavTempPath->dataWriter();
+void C_SoundMixer::LoadState(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
     }
 
-    initialized = true;
+    memset(mixBuffer, 0, sizeof(mixBuffer));
+    unsigned samples = reader.ReadWord();
+
+    for (unsigned i = 0; i < samples && i < MIX_BUFFER_SIZE; i++) {
+        mixBuffer[i].left = reader.ReadDword();
+        mixBuffer[i].right = reader.ReadDword();
+    }
 }
 
 void C_SoundMixer::AddSource(C_SndRenderer* source) {
@@ -65,7 +63,7 @@ void C_SoundMixer::AddSource(C_SndRenderer* source) {
     source->mixBuffer = mixBuffer;
 }
 
-void C_SoundMixer::FlushFrame(bool soundEnabled) {
+void C_SoundMixer::FlushFrame(bool soundEnabled, bool soundPlayed) {
     assert(initialized);
     int sourcesCount = sources.size();
 
@@ -139,16 +137,21 @@ void C_SoundMixer::FlushFrame(bool soundEnabled) {
             }
         }
 
-        if (wavDataWriter) {
+        Capture_AddSound(audioBuffer, minSamples);
+
+        if (hashEnabled) {
             o = (uint16_t*)audioBuffer;
 
-            for (int i = minSamples; i--;) {
-                wavDataWriter->writeWord(*(o++));
-                wavDataWriter->writeWord(*(o++));
+            // FNV-1a over little-endian 16-bit samples, same as in the .wav file
+            for (int i = minSamples * 2; i--; o++) {
+                hash = (hash ^ (uint8_t)(*o)) * 0x100000001B3ULL;
+                hash = (hash ^ (uint8_t)(*o >> 8)) * 0x100000001B3ULL;
             }
         }
 
-        host->stage()->renderSound(audioBuffer, minSamples);
+        if (soundPlayed) {
+            host->stage()->renderSound(audioBuffer, minSamples);
+        }
     }
 
     if (maxSamples > minSamples) {
@@ -11,11 +11,14 @@ class C_SoundMixer {
 public:
 
     C_SoundMixer() {} //-V730
-    ~C_SoundMixer();
 
-    void Init(int mixerMode, bool recordWav, const char* wavName);
+    void Init(int mixerMode);
     void AddSource(C_SndRenderer* source);
-    void FlushFrame(bool soundEnabled);
+    void FlushFrame(bool soundEnabled, bool soundPlayed); // mixed sound can be only captured, but not played
+    void EnableHash(void);
+    uint64_t GetHash(void);
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader, unsigned version);
     s_Sample mixBuffer[MIX_BUFFER_SIZE * 2];
 
 private:
@@ -24,9 +27,8 @@ private:
     int mixerMode;
     std::vector<C_SndRenderer*> sources;
     uint32_t audioBuffer[MIX_BUFFER_SIZE];
-    PathPtr wavPath;
-    PathPtr wavTempPath;
-    DataWriterPtr wavDataWriter;
+    bool hashEnabled = false;
+    uint64_t hash = 0;
 };
 
 extern C_SoundMixer soundMixer;
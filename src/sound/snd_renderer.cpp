@@ -10,6 +10,7 @@
 
 #include "snd_renderer.h"
 #include "zemu.h"
+#include "state.h"
 
 const unsigned TICK_FF = 6;
 const unsigned TICK_F = (1 << TICK_FF);
@@ -148,6 +149,43 @@ void C_SndRenderer::EndFrame(unsigned clk) {
     passedClkTicks += clk;
 }
 
+// timings are not saved, since they depend only on configuration
+void C_SndRenderer::SaveState(C_StateWriter& writer) {
+    writer.WriteDword(samples);
+    writer.WriteDword(activeCnt);
+    writer.WriteDword(mixL);
+    writer.WriteDword(mixR);
+    writer.WriteDword(tick);
+    writer.WriteDword(s1l);
+    writer.WriteDword(s1r);
+    writer.WriteDword(s2l);
+    writer.WriteDword(s2r);
+    writer.WriteQword(passedClkTicks);
+    writer.WriteQword(passedSndTicks);
+}
+
+void C_SndRenderer::LoadState(C_StateReader& reader) {
+    samples = reader.ReadDword();
+    activeCnt = reader.ReadDword();
+    mixL = reader.ReadDword();
+    mixR = reader.ReadDword();
+    tick = reader.ReadDword();
+    s1l = reader.ReadDword();
+    s1r = reader.ReadDword();
+    s2l = reader.ReadDword();
+    s2r = reader.ReadDword();
+    passedClkTicks = reader.ReadQword();
+    passedSndTicks = reader.ReadQword();
+
+    if (samples > MIX_BUFFER_SIZE / 2) {
+        samples = 0;
+    }
+
+    startPos = &mixBuffer[samples];
+    currPos = startPos;
+    baseTick = tick;
+}
+
 void C_SndRenderer::Flush(unsigned endTick) {
     unsigned scale;
 
@@ -20,6 +20,9 @@
 #include "defines.h"
 #include "params.h"
 
+class C_StateWriter;
+class C_StateReader;
+
 const unsigned SNDR_DEFAULT_SYSTICK_RATE = MAX_FRAME_TACTS * 50; // ZX-Spectrum Z80 clock
 const unsigned SNDR_DEFAULT_SAMPLE_RATE = SOUND_FREQ;
 const unsigned SNDR_ACTIVE_CNT_UPD = 50;
@@ -44,6 +47,9 @@ public:
     void Update(unsigned clk, unsigned left, unsigned right);
     void EndFrame(unsigned clk);
 
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader);
+
 protected:
 
     void Flush(unsigned endTick);
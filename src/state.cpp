@@ -0,0 +1,394 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <string.h>
+#include "zemu_env.h"
+#include "state.h"
+#include "devs.h"
+#include "tape/tape.h"
+#include "sound/mixer.h"
+
+#define STATE_MAGIC "ZST\x1A"
+#define STATE_MAGIC_SIZE 4
+#define STATE_CHUNK_HEADER_SIZE (STATE_CHUNK_ID_SIZE + 2 + 4)
+
+struct s_StateChunk {
+    const char* id;
+    unsigned version;
+    C_Device* device;
+};
+
+static s_StateChunk stateChunks[] = {
+    {"MMAN", 1, &dev_mman},
+    {"EXTP", 1, &dev_extport},
+    {"BRDR", 1, &dev_border},
+    {"TRDS", 1, &dev_trdos},
+    {"TSFM", 2, &dev_tsfm},
+    {"COVX", 1, &dev_covox},
+    {"GSND", 1, &dev_gsound},
+    {nullptr, 0, nullptr}
+};
+
+//--------------------------------------------------------------------------------------------------------------
+
+void C_StateWriter::BeginChunk(const char* id, unsigned version) {
+    chunkStart = buffer.size();
+
+    WriteBlock(id, STATE_CHUNK_ID_SIZE);
+    WriteWord((uint16_t)version);
+    WriteDword(0); // patched in EndChunk()
+}
+
+void C_StateWriter::EndChunk(void) {
+    uint32_t chunkSize = (uint32_t)(buffer.size() - chunkStart - STATE_CHUNK_HEADER_SIZE);
+    uint8_t* ptr = &buffer[chunkStart + STATE_CHUNK_ID_SIZE + 2];
+
+    ptr[0] = (uint8_t)chunkSize;
+    ptr[1] = (uint8_t)(chunkSize >> 8);
+    ptr[2] = (uint8_t)(chunkSize >> 16);
+    ptr[3] = (uint8_t)(chunkSize >> 24);
+}
+
+void C_StateWriter::WriteByte(uint8_t value) {
+    buffer.push_back(value);
+}
+
+void C_StateWriter::WriteWord(uint16_t value) {
+    buffer.push_back((uint8_t)value);
+    buffer.push_back((uint8_t)(value >> 8));
+}
+
+void C_StateWriter::WriteDword(uint32_t value) {
+    WriteWord((uint16_t)value);
+    WriteWord((uint16_t)(value >> 16));
+}
+
+void C_StateWriter::WriteQword(uint64_t value) {
+    WriteDword((uint32_t)value);
+    WriteDword((uint32_t)(value >> 32));
+}
+
+void C_StateWriter::WriteBool(bool value) {
+    buffer.push_back(value ? 1 : 0);
+}
+
+void C_StateWriter::WriteBlock(const void* data, size_t size) {
+    const uint8_t* ptr = (const uint8_t*)data;
+    buffer.insert(buffer.end(), ptr, ptr + size);
+}
+
+void C_StateWriter::WriteString(const std::string& value) {
+    WriteDword((uint32_t)value.length());
+    WriteBlock(value.c_str(), value.length());
+}
+
+// external Z80Ex library doesn't expose internal CPU state, states are not supported with it (see State_Load)
+void C_StateWriter::WriteCpu(Z80EX_CONTEXT* cpu) {
+    #ifdef Z80EX_ZAME_WRAPPER
+        for (int i = regBC; i <= regIM; i++) {
+            WriteWord(z80ex_get_reg(cpu, i));
+        }
+
+        Z80EX_STATE state;
+        z80ex_get_state(cpu, &state);
+
+        WriteBool(state.is_halted);
+        WriteBool(state.is_opcode);
+        WriteBool(state.is_noint);
+        WriteBool(state.is_reset_pv);
+        WriteBool(state.is_read_int);
+        WriteByte(state.prefix);
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------------------
+
+const uint8_t* C_StateReader::Take(size_t count) {
+    if (failed || count > chunkEnd - pos) {
+        failed = true;
+        return nullptr;
+    }
+
+    const uint8_t* ptr = &data[pos];
+    pos += count;
+
+    return ptr;
+}
+
+bool C_StateReader::NextChunk(char* id, unsigned& version) {
+    pos = chunkEnd;
+    chunkEnd = size;
+
+    if (pos == size) {
+        return false;
+    }
+
+    const uint8_t* ptr = Take(STATE_CHUNK_HEADER_SIZE);
+
+    if (!ptr) {
+        return false;
+    }
+
+    memcpy(id, ptr, STATE_CHUNK_ID_SIZE);
+    version = (unsigned)ptr[4] | ((unsigned)ptr[5] << 8);
+
+    uint32_t chunkSize = (uint32_t)ptr[6]
+        | ((uint32_t)ptr[7] << 8)
+        | ((uint32_t)ptr[8] << 16)
+        | ((uint32_t)ptr[9] << 24);
+
+    if (chunkSize > size - pos) {
+        failed = true;
+        return false;
+    }
+
+    chunkEnd = pos + chunkSize;
+    return true;
+}
+
+bool C_StateReader::IsChunkEmpty(void) {
+    return (pos == chunkEnd);
+}
+
+bool C_StateReader::IsFailed(void) {
+    return failed;
+}
+
+void C_StateReader::Fail(void) {
+    failed = true;
+}
+
+uint8_t C_StateReader::ReadByte(void) {
+    const uint8_t* ptr = Take(1);
+    return (ptr ? ptr[0] : 0);
+}
+
+uint16_t C_StateReader::ReadWord(void) {
+    const uint8_t* ptr = Take(2);
+    return (ptr ? (uint16_t)(ptr[0] | (ptr[1] << 8)) : 0);
+}
+
+uint32_t C_StateReader::ReadDword(void) {
+    uint32_t value = ReadWord();
+    return value | ((uint32_t)ReadWord() << 16);
+}
+
+uint64_t C_StateReader::ReadQword(void) {
+    uint64_t value = ReadDword();
+    return value | ((uint64_t)ReadDword() << 32);
+}
+
+bool C_StateReader::ReadBool(void) {
+    return (ReadByte() != 0);
+}
+
+bool C_StateReader::ReadBlock(void* into, size_t size) {
+    const uint8_t* ptr = Take(size);
+
+    if (!ptr) {
+        return false;
+    }
+
+    memcpy(into, ptr, size);
+    return true;
+}
+
+std::string C_StateReader::ReadString(void) {
+    uint32_t length = ReadDword();
+    const uint8_t* ptr = Take(length);
+
+    return (ptr ? std::string((const char*)ptr, length) : std::string());
+}
+
+void C_StateReader::ReadCpu(Z80EX_CONTEXT* cpu) {
+    #ifdef Z80EX_ZAME_WRAPPER
+        for (int i = regBC; i <= regIM; i++) {
+            z80ex_set_reg(cpu, i, ReadWord());
+        }
+
+        Z80EX_STATE state;
+        state.is_halted = ReadBool();
+        state.is_opcode = ReadBool();
+        state.is_noint = ReadBool();
+        state.is_reset_pv = ReadBool();
+        state.is_read_int = ReadBool();
+        state.prefix = ReadByte();
+
+        if (!z80ex_set_state(cpu, &state)) {
+            failed = true;
+        }
+    #else
+        failed = true;
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------------------
+
+static void State_SaveMachine(C_StateWriter& writer) {
+    writer.WriteQword(cpuClk);
+    writer.WriteQword(devClk);
+    writer.WriteQword(lastDevClk);
+    writer.WriteQword(devClkCounter);
+    writer.WriteByte((uint8_t)turboMultiplier);
+    writer.WriteBool(unturbo);
+    writer.WriteByte((uint8_t)flashFrames);
+}
+
+static void State_LoadMachine(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
+    }
+
+    cpuClk = reader.ReadQword();
+    devClk = reader.ReadQword();
+    lastDevClk = reader.ReadQword();
+    devClkCounter = reader.ReadQword();
+    turboMultiplier = turboMultiplierNx = reader.ReadByte();
+    unturbo = unturboNx = reader.ReadBool();
+    flashFrames = reader.ReadByte();
+}
+
+void State_Save(std::vector<uint8_t>& into) {
+    C_StateWriter writer(into);
+
+    writer.WriteBlock(STATE_MAGIC, STATE_MAGIC_SIZE);
+    writer.WriteDword(STATE_FORMAT_VERSION);
+
+    writer.BeginChunk("MACH", 1);
+    State_SaveMachine(writer);
+    writer.EndChunk();
+
+    writer.BeginChunk("CPU ", 1);
+    writer.WriteCpu(cpu);
+    writer.EndChunk();
+
+    for (s_StateChunk* chunk = stateChunks; chunk->id; chunk++) {
+        writer.BeginChunk(chunk->id, chunk->version);
+        chunk->device->SaveState(writer);
+        writer.EndChunk();
+    }
+
+    writer.BeginChunk("TAPE", 1);
+    C_Tape::SaveState(writer);
+    writer.EndChunk();
+
+    writer.BeginChunk("MIXR", 1);
+    soundMixer.SaveState(writer);
+    writer.EndChunk();
+}
+
+static bool State_LoadChunks(const uint8_t* data, size_t size) {
+    C_StateReader reader(data, size);
+    char id[STATE_CHUNK_ID_SIZE] = {0};
+    unsigned version = 0;
+
+    while (reader.NextChunk(id, version)) {
+        if (reader.IsChunkEmpty()) {
+            continue;
+        }
+
+        if (!memcmp(id, "MACH", STATE_CHUNK_ID_SIZE)) {
+            State_LoadMachine(reader, version);
+        } else if (!memcmp(id, "CPU ", STATE_CHUNK_ID_SIZE)) {
+            if (version == 1) {
+                reader.ReadCpu(cpu);
+            } else {
+                reader.Fail();
+            }
+        } else if (!memcmp(id, "TAPE", STATE_CHUNK_ID_SIZE)) {
+            C_Tape::LoadState(reader, version);
+        } else if (!memcmp(id, "MIXR", STATE_CHUNK_ID_SIZE)) {
+            soundMixer.LoadState(reader, version);
+        } else {
+            for (s_StateChunk* chunk = stateChunks; chunk->id; chunk++) {
+                if (!memcmp(id, chunk->id, STATE_CHUNK_ID_SIZE)) {
+                    chunk->device->LoadState(reader, version);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (reader.IsFailed()) {
+        printf("State load failed: malformed or unsupported chunk \"%.4s\" (version %u)\n", id, version);
+        return false;
+    }
+
+    return true;
+}
+
+bool State_Load(const uint8_t* data, size_t size) {
+    #ifndef Z80EX_ZAME_WRAPPER
+        printf("State load failed: not supported with external Z80Ex library\n");
+        return false;
+    #endif
+
+    if (size < STATE_MAGIC_SIZE + 4 || memcmp(data, STATE_MAGIC, STATE_MAGIC_SIZE)) {
+        printf("State load failed: unknown format\n");
+        return false;
+    }
+
+    const uint8_t* ptr = data + STATE_MAGIC_SIZE;
+    uint32_t formatVersion = (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+
+    if (formatVersion != STATE_FORMAT_VERSION) {
+        printf("State load failed: unsupported version %u\n", (unsigned)formatVersion);
+        return false;
+    }
+
+    C_StateReader reader(data + STATE_MAGIC_SIZE + 4, size - STATE_MAGIC_SIZE - 4);
+    char id[STATE_CHUNK_ID_SIZE];
+    unsigned version;
+
+    // check chunk boundaries before touching the machine, so that truncated data is rejected early
+    while (reader.NextChunk(id, version)) {
+    }
+
+    if (reader.IsFailed()) {
+        printf("State load failed: truncated data\n");
+        return false;
+    }
+
+    // device can fail in the middle of its chunk, in this case the machine is restored from the current state
+    std::vector<uint8_t> current;
+    State_Save(current);
+
+    if (!State_LoadChunks(data + STATE_MAGIC_SIZE + 4, size - STATE_MAGIC_SIZE - 4)) {
+        State_LoadChunks(current.data() + STATE_MAGIC_SIZE + 4, current.size() - STATE_MAGIC_SIZE - 4);
+        return false;
+    }
+
+    return true;
+}
+
+bool State_SaveFile(const char* fileName) {
+    std::vector<uint8_t> buffer;
+    State_Save(buffer);
+
+    try {
+        auto writer = host->storage()->path(fileName)->dataWriter();
+
+        if (!writer->writeBlock(buffer.data(), buffer.size())) {
+            throw StorageException("Write error");
+        }
+    } catch (StorageException& e) {
+        printf("State save failed: %s\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+bool State_LoadFile(const char* fileName) {
+    std::vector<uint8_t> buffer;
+
+    try {
+        host->storage()->path(fileName)->readAll(buffer);
+    } catch (StorageException& e) {
+        printf("State load failed: %s\n", e.what());
+        return false;
+    }
+
+    return State_Load(buffer.data(), buffer.size());
+}
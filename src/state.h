@@ -0,0 +1,87 @@
+#ifndef _STATE_H_INCLUDED_
+#define _STATE_H_INCLUDED_
+
+#include <string>
+#include <vector>
+#include "zemu.h"
+
+// Full machine state (file extension ".zst"). All values are little-endian.
+//
+// "ZST" + 0x1A, dword format version
+// chunks until the end of data:
+//   4 chars id, word chunk version, dword payload size, payload
+//
+// Every device serialises into own chunk (see stateChunks in state.cpp), unknown chunks are skipped on load,
+// so chunks can be added without breaking older states. Chunk version is passed to the loader,
+// to let it read older layouts, unknown chunk version fails the loading. State should be saved and loaded between frames.
+// States with other format version are rejected. When loading fails, the machine is left as it was.
+
+#define STATE_FORMAT_VERSION 1
+#define STATE_CHUNK_ID_SIZE 4
+#define STATE_EXTENSION ".zst"
+
+class C_StateWriter {
+public:
+
+    C_StateWriter(std::vector<uint8_t>& buffer) : buffer(buffer) {}
+
+    void BeginChunk(const char* id, unsigned version);
+    void EndChunk(void);
+
+    void WriteByte(uint8_t value);
+    void WriteWord(uint16_t value);
+    void WriteDword(uint32_t value);
+    void WriteQword(uint64_t value);
+    void WriteBool(bool value);
+    void WriteBlock(const void* data, size_t size);
+    void WriteString(const std::string& value);
+    void WriteCpu(Z80EX_CONTEXT* cpu);
+
+private:
+
+    std::vector<uint8_t>& buffer;
+    size_t chunkStart = 0;
+
+    C_StateWriter(const C_StateWriter&);
+    C_StateWriter& operator=(const C_StateWriter&);
+};
+
+class C_StateReader {
+public:
+
+    C_StateReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    bool NextChunk(char* id, unsigned& version);
+    bool IsChunkEmpty(void);
+    bool IsFailed(void);
+    void Fail(void);
+
+    uint8_t ReadByte(void);
+    uint16_t ReadWord(void);
+    uint32_t ReadDword(void);
+    uint64_t ReadQword(void);
+    bool ReadBool(void);
+    bool ReadBlock(void* into, size_t size);
+    std::string ReadString(void);
+    void ReadCpu(Z80EX_CONTEXT* cpu);
+
+private:
+
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    size_t chunkEnd = 0;
+    bool failed = false;
+
+    const uint8_t* Take(size_t count);
+
+    C_StateReader(const C_StateReader&);
+    C_StateReader& operator=(const C_StateReader&);
+};
+
+void State_Save(std::vector<uint8_t>& into);
+bool State_Load(const uint8_t* data, size_t size);
+bool State_SaveFile(const char* fileName);
+bool State_LoadFile(const char* fileName);
+
+#endif
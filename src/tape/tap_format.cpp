@@ -3,6 +3,7 @@
 
 #include "tap_format.h"
 #include "zemu_env.h"
+#include "state.h"
 
 #define TAPE_STATE_STOP 0
 #define TAPE_STATE_PLAY 1
@@ -217,6 +218,32 @@ void C_TapFormat::Rewind(void) {
     posInBlock = 0;
 }
 
+void C_TapFormat::SaveState(C_StateWriter& writer) {
+    writer.WriteByte(state);
+    writer.WriteByte(tapeBit);
+    writer.WriteDword(counter);
+    writer.WriteDword(blockPos);
+    writer.WriteDword(blockSize);
+    writer.WriteDword(posInBlock);
+    writer.WriteByte(currentByte);
+    writer.WriteDword(delay);
+}
+
+void C_TapFormat::LoadState(C_StateReader& reader, unsigned version) {
+    state = reader.ReadByte();
+    tapeBit = reader.ReadByte();
+    counter = (int)reader.ReadDword();
+    blockPos = (long)reader.ReadDword();
+    blockSize = (int)reader.ReadDword();
+    posInBlock = (int)reader.ReadDword();
+    currentByte = reader.ReadByte();
+    delay = (int)reader.ReadDword();
+
+    if (blockPos > size) {
+        Rewind();
+    }
+}
+
 unsigned int C_TapFormat::GetPosPerc(void) {
     if (blockPos >= size) {
         return 100;
@@ -29,6 +29,8 @@ public:
     void Rewind(void);
     unsigned int GetPosPerc(void);
     bool IsActive(void);
+    void SaveState(C_StateWriter& writer);
+    void LoadState(C_StateReader& reader, unsigned version);
 
     uint8_t Data(long pos);
 };
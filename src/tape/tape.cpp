@@ -1,14 +1,17 @@
 // This is an open source non-commercial project. Dear PVS-Studio, please check it.
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 
+#include "zemu_env.h"
 #include "tape.h"
 #include "zemu.h"
 #include "tap_format.h"
 #include "wav_format.h"
 #include "voc_format.h"
+#include "state.h"
 
 uint64_t C_Tape::prevDevClkCounter = 0;
 C_TapeFormat* C_Tape::currentFormat = nullptr;
+std::string C_Tape::fileName;
 C_SndRenderer C_Tape::sndRenderer;
 
 void C_Tape::Init(void) {
@@ -71,6 +74,8 @@ void C_Tape::Eject(void) {
         delete currentFormat;
         currentFormat = nullptr;
     }
+
+    fileName.clear();
 }
 
 bool C_Tape::IsTapeFormat(const char* fname) {
@@ -79,10 +84,7 @@ bool C_Tape::IsTapeFormat(const char* fname) {
 }
 
 bool C_Tape::Insert(const char* fname) {
-    if (currentFormat != nullptr) {
-        delete currentFormat;
-        currentFormat = nullptr;
-    }
+    Eject();
 
     auto ext = host->storage()->path(fname)->extensionLc();
 
@@ -104,6 +106,8 @@ bool C_Tape::Insert(const char* fname) {
         return false;
     }
 
+    fileName = host->storage()->path(fname)->canonical()->string();
+
     return true;
 }
 
@@ -125,3 +129,39 @@ void C_Tape::Rewind(void) {
         currentFormat->Rewind();
     }
 }
+
+// tape file itself is not stored, only its name and position
+void C_Tape::SaveState(C_StateWriter& writer) {
+    writer.WriteString(currentFormat == nullptr ? std::string() : fileName);
+    writer.WriteQword(prevDevClkCounter);
+    sndRenderer.SaveState(writer);
+
+    if (currentFormat != nullptr) {
+        currentFormat->SaveState(writer);
+    }
+}
+
+void C_Tape::LoadState(C_StateReader& reader, unsigned version) {
+    if (version != 1) {
+        reader.Fail();
+        return;
+    }
+
+    std::string name = reader.ReadString();
+    prevDevClkCounter = reader.ReadQword();
+    sndRenderer.LoadState(reader);
+
+    if (name.empty()) {
+        Eject();
+        return;
+    }
+
+    if (currentFormat == nullptr || name != fileName) {
+        if (!Insert(name.c_str())) {
+            printf("Couldn't insert tape \"%s\"\n", name.c_str());
+            return;
+        }
+    }
+
+    currentFormat->LoadState(reader, version);
+}
@@ -1,9 +1,13 @@
 #ifndef _TAPE_H_INCLUDED_
 #define _TAPE_H_INCLUDED_
 
+#include <string>
 #include "sound/snd_renderer.h"
 #include "tape_format.h"
 
+class C_StateWriter;
+class C_StateReader;
+
 #define MAX_TAPE_VOL 0x03FF
 
 class C_Tape {
@@ -12,6 +16,7 @@ public:
     static C_SndRenderer sndRenderer;
     static uint64_t prevDevClkCounter;
     static C_TapeFormat* currentFormat;
+    static std::string fileName;
 
     static void Init(void);
     static void Close(void);
@@ -32,6 +37,9 @@ public:
     static void Start(void);
     static void Stop(void);
     static void Rewind(void);
+
+    static void SaveState(C_StateWriter& writer);
+    static void LoadState(C_StateReader& reader, unsigned version);
 };
 
 #endif
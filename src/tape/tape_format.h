@@ -3,6 +3,9 @@
 
 #include <cstdint>
 
+class C_StateWriter;
+class C_StateReader;
+
 class C_TapeFormat {
 public:
 
@@ -17,6 +20,10 @@ public:
     virtual void Rewind(void) = 0;
     virtual unsigned int GetPosPerc(void) = 0;
     virtual bool IsActive(void) = 0;
+
+    // called after Load() with the same file
+    virtual void SaveState(C_StateWriter& writer) {}
+    virtual void LoadState(C_StateReader& reader, unsigned version) {}
 };
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "voc_format.h"
 #include "defines.h"
+#include "state.h"
 
 #define VOC_THRESHOLD 140
 
@@ -194,6 +195,24 @@ void C_VocFormat::Rewind(void) {
     allTicks = 0;
 }
 
+void C_VocFormat::SaveState(C_StateWriter& writer) {
+    writer.WriteQword(allTicks);
+    writer.WriteBool(active);
+    writer.WriteBool(currBit);
+    writer.WriteQword(reader ? reader->getPosition() : 0);
+}
+
+void C_VocFormat::LoadState(C_StateReader& reader, unsigned version) {
+    allTicks = reader.ReadQword();
+    active = reader.ReadBool();
+    currBit = reader.ReadBool();
+    uint64_t position = reader.ReadQword();
+
+    if (this->reader) {
+        this->reader->setPosition(position);
+    }
+}
+
 unsigned int C_VocFormat::GetPosPerc(void) {
     // uint32_t pos = (allTicks / divider) * sampleSz;
     // return ((pos >= dataSize) ? 100 : (pos * 100 / dataSize));
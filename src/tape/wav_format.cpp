@@ -4,6 +4,7 @@
 #include "wav_format.h"
 #include "defines.h"
 #include "params.h"
+#include "state.h"
 
 #define WAV_THRESHOLD 140
 
@@ -219,6 +220,26 @@ void C_WavFormat::Rewind(void) {
     }
 }
 
+void C_WavFormat::SaveState(C_StateWriter& writer) {
+    writer.WriteQword(allTicks);
+    writer.WriteDword(dataPos);
+    writer.WriteBool(active);
+    writer.WriteBool(currBit);
+    writer.WriteQword(reader ? reader->getPosition() : 0);
+}
+
+void C_WavFormat::LoadState(C_StateReader& reader, unsigned version) {
+    allTicks = reader.ReadQword();
+    dataPos = reader.ReadDword();
+    active = reader.ReadBool();
+    currBit = reader.ReadBool();
+    uint64_t position = reader.ReadQword();
+
+    if (this->reader) {
+        this->reader->setPosition(position);
+    }
+}
+
 unsigned int C_WavFormat::GetPosPerc(void) {
     uint32_t pos = (allTicks / divider) * sampleSz;
     return ((pos >= dataSize) ? 100 : (pos * 100 / dataSize));
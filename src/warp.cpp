@@ -0,0 +1,111 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "warp.h"
+
+s_WarpCondition warpCondition = { WARP_NONE, 0, -1, 0, 0, false };
+static bool savedMaxSpeed = false;
+
+static bool Warp_ParseHex(const char* str, const char** end, unsigned maxValue, unsigned& into) {
+    char* stop;
+    unsigned long value = strtoul(str, &stop, 16);
+
+    if (stop == str || value > maxValue) {
+        return false;
+    }
+
+    *end = stop;
+    into = (unsigned)value;
+    return true;
+}
+
+bool Warp_Parse(const char* spec, s_WarpCondition& into) {
+    s_WarpCondition condition = { WARP_NONE, 0, -1, 0, 0, false };
+    const char* ptr = spec;
+    unsigned value;
+
+    if (!strncmp(ptr, "pc=", 3)) {
+        if (!Warp_ParseHex(ptr + 3, &ptr, 0xFFFF, value)) {
+            return false;
+        }
+
+        condition.type = WARP_PC;
+        condition.addr = (uint16_t)value;
+
+        if (*ptr == ':') {
+            if (!Warp_ParseHex(ptr + 1, &ptr, 63, value)) {
+                return false;
+            }
+
+            condition.bank = (int)value;
+        }
+    } else if (!strncmp(ptr, "mem=", 4)) {
+        if (!Warp_ParseHex(ptr + 4, &ptr, 0xFFFF, value) || *ptr != ':') {
+            return false;
+        }
+
+        condition.type = WARP_MEMORY;
+        condition.addr = (uint16_t)value;
+
+        if (!Warp_ParseHex(ptr + 1, &ptr, 0xFF, value)) {
+            return false;
+        }
+
+        condition.value = (uint8_t)value;
+    } else if (!strncmp(ptr, "frame=", 6)) {
+        char* stop;
+        long frameCount = strtol(ptr + 6, &stop, 10);
+
+        if (stop == ptr + 6 || frameCount <= 0) {
+            return false;
+        }
+
+        condition.type = WARP_FRAME;
+        condition.frames = (int)frameCount;
+        ptr = stop;
+    } else if (!strncmp(ptr, "tape-end", 8)) {
+        condition.type = WARP_TAPE_END;
+        ptr += 8;
+    } else {
+        return false;
+    }
+
+    if (!strcmp(ptr, ",debug")) {
+        condition.thenDebugger = true;
+    } else if (*ptr) {
+        return false;
+    }
+
+    into = condition;
+    return true;
+}
+
+void Warp_Start(const s_WarpCondition& condition) {
+    if (warpCondition.type == WARP_NONE) {
+        savedMaxSpeed = params.maxSpeed;
+    }
+
+    warpCondition = condition;
+    params.maxSpeed = true;
+    SetMessage("Warp started");
+}
+
+bool Warp_Complete(void) {
+    bool thenDebugger = warpCondition.thenDebugger;
+
+    warpCondition.type = WARP_NONE;
+    params.maxSpeed = savedMaxSpeed;
+    SetMessage("Warp complete");
+    printf("Warp complete at frame %d\n", frames);
+
+    return thenDebugger;
+}
+
+void Warp_Cancel(void) {
+    warpCondition.type = WARP_NONE;
+    params.maxSpeed = savedMaxSpeed;
+    SetMessage("Warp cancelled");
+}
@@ -0,0 +1,34 @@
+#ifndef _WARP_H_INCLUDED_
+#define _WARP_H_INCLUDED_
+
+#include "zemu.h"
+
+// Warp runs emulation at max speed, without rendering and sound, until condition is met.
+// Condition is one of "pc=ADDR[:BANK]", "mem=ADDR:VALUE", "frame=N" or "tape-end",
+// optionally followed by ",debug" to enter debugger instead of returning to normal speed.
+// ADDR, BANK and VALUE are hex, N is decimal (frames from warp start).
+// BANK is the RAM page at #C000 and is checked only for addresses above #C000.
+
+#define WARP_NONE 0
+#define WARP_PC 1
+#define WARP_MEMORY 2
+#define WARP_FRAME 3
+#define WARP_TAPE_END 4
+
+struct s_WarpCondition {
+    int type;
+    uint16_t addr;
+    int bank; // -1 = any
+    uint8_t value;
+    int frames;
+    bool thenDebugger;
+};
+
+extern s_WarpCondition warpCondition;
+
+bool Warp_Parse(const char* spec, s_WarpCondition& into);
+void Warp_Start(const s_WarpCondition& condition);
+bool Warp_Complete(void); // returns true if debugger should be entered
+void Warp_Cancel(void);
+
+#endif
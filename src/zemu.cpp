@@ -16,14 +16,28 @@
 #include "dialog.h"
 #include "graphics.h"
 #include "cpu_trace.h"
+#include "movie.h"
+#include "frame_stats.h"
+#include "key_script.h"
+#include "warp.h"
+#include "rewind.h"
+#include "quicksave.h"
+#include "capture.h"
+#include "overlay.h"
+#include "journal.h"
+#include "batch.h"
 #include "tape/tape.h"
 #include "labels.h"
 #include "renderer/render_speccy.h"
 #include "renderer/render_16c.h"
-#include "renderer/render_multicolor.h"
+#include "renderer/render_raster.h"
+#include "renderer/render_kernels.h"
+#include "renderer/render_bench.h"
+#include "renderer/render_pipeline.h"
 #include "devs.h"
 #include "snap_z80.h"
 #include "snap_sna.h"
+#include "state.h"
 #include "data/font_bold.h"
 #include "data/font_thin.h"
 #include "data/img_floppy.h"
@@ -37,8 +51,6 @@
     #include "windows/resource.h"
 #endif
 
-#define SNAP_FORMAT_Z80 0
-#define SNAP_FORMAT_SNA 1
 #define INT_LENGTH 32
 
 Host* host;
@@ -57,11 +69,35 @@ uint64_t devClkCounter;
 s_Params params;
 bool drawFrame;
 int frames;
+unsigned flashFrames; // unlike "frames", it is a part of machine state
 C_Font* font = nullptr;
 C_Font* fixed_font = nullptr;
-bool doCopyOfSurfaces = false;
 bool recordWav = false;
-const char* wavFileName = "output.wav"; // TODO: make configurable + full filepath
+const char* wavFileName = "output.wav"; // audio only capture with "-w"
+bool startCapture = false; // with file names from the config
+const char* frameStatsFileName = nullptr;
+const char* labelsFileName = nullptr;
+const char* startFileName = nullptr;
+const char* dumpScreenFileName = nullptr;
+const char* dumpAudioFileName = nullptr;
+const char* saveStateFileName = nullptr;
+const char* journalFileName = nullptr;
+int journalRestorePoint = JOURNAL_POINT_LAST;
+unsigned runFramesLimit = 0;
+unsigned benchRenderFrames = 0;
+bool runUntilTapeEnd = false;
+bool runUntilMovieEnd = false;
+bool startAtMaxSpeed = false;
+const char* batchManifestFileName = nullptr;
+const char* batchReportFileName = "report.json";
+int batchJobs = 0;
+bool printResultLine = false;
+bool isStartFileLoaded = false;
+const char* expectedScreenHash = nullptr;
+const char* expectedAudioHash = nullptr;
+const char* expectedFramesHash = nullptr;
+int renderPipelineOption = -1; // -1 - as in the config, 0 - always inline, 1 - worker is started even on single core
+s_WarpCondition startWarpCondition = { WARP_NONE, 0, -1, 0, 0, false };
 int attributesHack = 0;
 bool flashColor = false;
 int screensHack = 0;
@@ -69,12 +105,20 @@ uint64_t actDevClkCounter = 0;
 uint64_t actClk = 0;
 int (* DoCpuStep)(Z80EX_CONTEXT* cpu) = z80ex_step;
 int (* DoCpuInt)(Z80EX_CONTEXT* cpu) = z80ex_int;
-unsigned long prevRenderClk;
-void (* renderPtr)(unsigned long) = nullptr;
+static s_RasterState renderState;
+static ptrRenderFunc renderPtr = nullptr;
+static bool isRenderRecorded = false; // frame is recorded for the render pipeline, instead of rendering inline
+static int renderPendingIndex = 0; // buffer of the frame, which is rendered by the pipeline
+static uint64_t renderMicros = 0;
+static uint64_t framesHash = 0xCBF29CE484222325ULL; // hash of every presented frame, see --expect-frames-hash
+uint64_t nextInputSampleClk = UINT64_MAX;
+bool isInputSampling = false;
+bool inputSampledQuit = false;
+bool inputSampledEscape = false;
+std::list<void (*)(void)> deferredActions;
 
 uint32_t* screen;
-uint32_t* renderScreen;
-uint32_t* renderScreenBuffer[2];
+uint8_t* renderScreenBuffer[ANTIFLICKER_MAX_FRAMES];
 
 //--------------------------------------------------------------------------------------------------------------
 
@@ -290,6 +334,14 @@ int c64_colors_base[0x10] = {
 */
 
 int colors[0x10];
+uint32_t screenPalette[PALETTE_SIZE];
+bool screenDirtyLines[HEIGHT];
+
+static bool screenOverlayLines[HEIGHT]; // lines drawn over the emulated picture, restored in the next frame
+static bool isScreenInvalidated = true;
+static uint8_t* presentedIndices[ANTIFLICKER_MAX_FRAMES]; // indices of lines which are currently in the screen
+static int blendFrames = 1; // frames which are blended together, 1 if there is no blending
+static int blendFilled = 0; // frames rendered since the blending was changed (up to blendFrames)
 
 //--------------------------------------------------------------------------------------------------------------
 
@@ -300,11 +352,12 @@ void OutputText(char* str) {
     int x = (WIDTH - font->StrLenPx(str)) / 2;
     int y = HEIGHT - font->Height() - 4;
 
-    font->PrintString(x, y, str);
+    Overlay_Text(OVERLAY_ITEM_MESSAGE, x, y, font, str);
 }
 
 void ShowMessage(void) {
     if (messageTimeout <= 0) {
+        Overlay_Hide(OVERLAY_ITEM_MESSAGE);
         return;
     }
 
@@ -328,15 +381,15 @@ void StrToLower(char* str) {
     }
 }
 
-void LoadNormalFile(const char* fname, int drive, const char* arcName = nullptr) {
+bool LoadNormalFile(const char* fname, int drive, const char* arcName = nullptr) {
     if (C_Tape::IsTapeFormat(fname)) {
         try {
-            C_Tape::Insert(fname);
+            return C_Tape::Insert(fname);
         } catch (StorageException& e) {
             printf("Load failed: %s\n", e.what());
         }
 
-        return;
+        return false;
     }
 
     auto ext = host->storage()->path(fname)->extensionLc();
@@ -344,33 +397,54 @@ void LoadNormalFile(const char* fname, int drive, const char* arcName = nullptr)
     if (ext == ".z80") {
         if (load_z80_snap(fname, cpu, dev_mman, dev_border)) {
             dev_tsfm.OnReset();
-        } else {
-            StrikeMessage("Error loading snapshot");
+            return true;
         }
 
-        return;
+        StrikeMessage("Error loading snapshot");
+        return false;
     }
 
     if (ext == ".sna") {
         if (load_sna_snap(fname, cpu, dev_mman, dev_border)) {
             dev_tsfm.OnReset();
-        } else {
-            StrikeMessage("Error loading snapshot");
+            return true;
         }
 
-        return;
+        StrikeMessage("Error loading snapshot");
+        return false;
+    }
+
+    if (ext == STATE_EXTENSION) {
+        if (State_LoadFile(fname)) {
+            return true;
+        }
+
+        StrikeMessage("Error loading state");
+        return false;
+    }
+
+    if (ext == JOURNAL_EXTENSION) {
+        if (Journal_Restore(fname, journalRestorePoint)) {
+            return true;
+        }
+
+        StrikeMessage("Error loading journal");
+        return false;
     }
 
+    bool isLoaded = false;
+
     try {
-        wd1793_load_dimage(fname, drive);
+        isLoaded = (wd1793_load_dimage(fname, drive) != 0);
     } catch (StorageException& e) {
         printf("Load failed: %s\n", e.what());
     }
 
     oldFileName[drive] = host->storage()->path(arcName ? arcName : fname)->canonical()->string();
+    return isLoaded;
 }
 
-void TryNLoadFile(const char* fname, int drive) {
+bool TryNLoadFile(const char* fname, int drive) {
     char bname[MAX_PATH];
     strcpy(bname, fname);
 
@@ -393,10 +467,18 @@ void TryNLoadFile(const char* fname, int drive) {
         }
     #endif
 
-    if (tname[0] != 0) {
-        printf("Trying to load \"%s\" ...\n", tname);
-        LoadNormalFile(tname, drive);
+    if (tname[0] == 0) {
+        return false;
+    }
+
+    printf("Trying to load \"%s\" ...\n", tname);
+
+    if (!host->storage()->path(tname)->isFile()) {
+        printf("Load failed: file \"%s\" not found\n", tname);
+        return false;
     }
+
+    return LoadNormalFile(tname, drive);
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -421,43 +503,26 @@ void Action_MaxSpeed(void) {
 }
 
 void Action_QuickLoad(void) {
-    bool (* loadSnap)(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
-
     isPaused = false;
-
-    const char* snapName = (params.snapFormat == SNAP_FORMAT_SNA ? "snap.sna" : "snap.z80");
-    loadSnap = (params.snapFormat == SNAP_FORMAT_SNA ? load_sna_snap : load_z80_snap);
-
-    if (!loadSnap(snapName, cpu, dev_mman, dev_border)) {
-        SetMessage("Error loading snapshot");
-    } else {
-        SetMessage("Snapshot loaded");
-    }
+    QuickSave_Load();
 }
 
 void Action_QuickSave(void) {
-    bool (* saveSnap)(const char* filename, Z80EX_CONTEXT* cpu, C_MemoryManager& mmgr, C_Border& border);
-
     isPaused = false;
+    QuickSave_Save();
+}
 
-    const char* snapName = (params.snapFormat == SNAP_FORMAT_SNA ? "snap.sna" : "snap.z80");
-    saveSnap = (params.snapFormat == SNAP_FORMAT_SNA ? save_sna_snap : save_z80_snap);
+void Action_QuickSlotNext(void) {
+    QuickSave_NextSlot();
+}
 
-    if (!saveSnap(snapName, cpu, dev_mman, dev_border)) {
-        SetMessage("Error saving snapshot");
-    } else {
-        SetMessage("Snapshot saved");
-    }
+void Action_QuickSlotPrev(void) {
+    QuickSave_PrevSlot();
 }
 
 void Action_AntiFlicker(void) {
     isPaused = false;
     params.antiFlicker = !params.antiFlicker;
-
-    if (params.antiFlicker) {
-        doCopyOfSurfaces = true;
-    }
-
     SetMessage(params.antiFlicker ? "AntiFlicker ON" : "AntiFlicker OFF");
 }
 
@@ -467,6 +532,7 @@ void Action_LoadFile(void) {
 
 void Action_Fullscreen(void) {
     host->stage()->setFullscreen(!host->stage()->isFullscreen());
+    InvalidateScreen();
 }
 
 void Action_Debugger(void) {
@@ -541,6 +607,69 @@ void Action_Pause(void) {
     SetMessage(isPausedNx ? "Pause ON" : "Pause OFF");
 }
 
+void Action_MovieRecord(void) {
+    isPaused = false;
+
+    if (movieState == MOVIE_STATE_RECORDING) {
+        Movie_Stop();
+    } else {
+        Movie_Record("movie.zmv");
+    }
+}
+
+void Action_MovieReplay(void) {
+    isPaused = false;
+
+    if (movieState == MOVIE_STATE_REPLAYING) {
+        Movie_Stop();
+    } else {
+        Movie_Replay("movie.zmv");
+    }
+}
+
+void Action_Capture(void) {
+    Capture_Toggle();
+}
+
+void Action_FrameStats(void) {
+    FrameStats_ToggleOverlay();
+}
+
+void Action_Warp(void) {
+    isPaused = false;
+
+    if (warpCondition.type != WARP_NONE) {
+        Warp_Cancel();
+        return;
+    }
+
+    s_WarpCondition condition;
+    const char* spec = DlgInputString("Warp to");
+
+    if (!*spec) {
+        return;
+    }
+
+    if (Warp_Parse(spec, condition)) {
+        Warp_Start(condition);
+    } else {
+        SetMessage("Invalid warp condition");
+    }
+}
+
+// rewinding is done while key is held, this is called on release
+void Action_Rewind(void) {
+    char buf[0x40];
+
+    if (!Rewind_IsEnabled()) {
+        SetMessage("Rewind is disabled");
+        return;
+    }
+
+    sprintf(buf, "Rewind buffer: %u KB", (unsigned)(Rewind_GetMemoryUsage() >> 10));
+    SetMessage(buf);
+}
+
 void Action_JoyOnKeyb(void) {
     isPaused = false;
     joyOnKeyb = !joyOnKeyb;
@@ -554,6 +683,8 @@ s_Action cfgActions[] = {
     {"max_speed",       Action_MaxSpeed},
     {"quick_load",      Action_QuickLoad},
     {"quick_save",      Action_QuickSave},
+    {"quick_slot_next", Action_QuickSlotNext},
+    {"quick_slot_prev", Action_QuickSlotPrev},
     {"anti_flicker",    Action_AntiFlicker},
     {"load_file",       Action_LoadFile},
     {"fullscreen",      Action_Fullscreen},
@@ -565,6 +696,12 @@ s_Action cfgActions[] = {
     {"flash_color",     Action_FlashColor},
     {"pause",           Action_Pause},
     {"joy_on_keyb",     Action_JoyOnKeyb},
+    {"movie_record",    Action_MovieRecord},
+    {"movie_replay",    Action_MovieReplay},
+    {"capture",         Action_Capture},
+    {"frame_stats",     Action_FrameStats},
+    {"warp",            Action_Warp},
+    {"rewind",          Action_Rewind},
     {"",                nullptr}
 };
 
@@ -727,23 +864,32 @@ void InitFont(void) {
 }
 
 void InitAll(void) {
-    screen = new uint32_t[WIDTH * HEIGHT];
-    renderScreenBuffer[0] = new uint32_t[WIDTH * HEIGHT];
-    renderScreenBuffer[1] = new uint32_t[WIDTH * HEIGHT];
+    screen = host->stage()->getFrameBuffer(WIDTH, HEIGHT);
+    Overlay_Init();
+
+    for (int i = 0; i < ANTIFLICKER_MAX_FRAMES; i++) {
+        renderScreenBuffer[i] = new uint8_t[WIDTH * HEIGHT];
+        presentedIndices[i] = new uint8_t[WIDTH * HEIGHT];
+    }
 
     for (int i = 0; devs[i]; i++) {
         devs[i]->Init();
     }
 
     InitDevMaps();
+    RenderKernels_Init();
+    Raster_Init();
 
     for (int i = 0; i < 0x10; i++) {
         colors[i] = colors_base[i];
     }
 
+    UpdateScreenPalette();
+
     InitFont();
     FileDialogInit();
     C_Tape::Init();
+    Movie_Init();
 
     for (int i = 0; i < 0x10000; i++) {
         breakpoints[i] = false;
@@ -765,29 +911,139 @@ void InitAll(void) {
 
 // ----------------------------------
 
-void AntiFlicker(int copyFrom, int copyTo) {
-    if (doCopyOfSurfaces) {
-        memcpy(renderScreenBuffer[copyTo], renderScreenBuffer[copyFrom], WIDTH * HEIGHT * sizeof(uint32_t));
-        doCopyOfSurfaces = false;
+// Must be called after colors are changed. Unused entries are black, so any index is safe.
+void UpdateScreenPalette(void) {
+    for (int i = 0; i < PALETTE_SIZE; i++) {
+        screenPalette[i] = STAGE_MAKERGB(0, 0, 0);
     }
 
-    uint8_t* s1 = (uint8_t*)renderScreenBuffer[0];
-    uint8_t* s2 = (uint8_t*)renderScreenBuffer[1];
-    uint8_t* sr = (uint8_t*)screen;
+    for (int i = 0; i < 0x10; i++) {
+        screenPalette[i] = (uint32_t)colors[i];
+    }
 
-    for (int i = WIDTH * HEIGHT; i--;) {
-        #ifdef STAGE_FLIPPED_ARGB
-            *(sr++) = 0; ++s1; ++s2;
-        #endif
+    screenPalette[PALETTE_BLACK] = STAGE_MAKERGB(0, 0, 0);
+    screenPalette[PALETTE_DARK_GRAY] = STAGE_MAKERGB(64, 64, 64);
+    screenPalette[PALETTE_LIGHT_GRAY] = STAGE_MAKERGB(192, 192, 192);
+    screenPalette[PALETTE_WHITE] = STAGE_MAKERGB(255, 255, 255);
 
-        *(sr++) = (uint8_t)(((unsigned int)(*(s1++)) + (unsigned int)(*(s2++))) >> 1);
-        *(sr++) = (uint8_t)(((unsigned int)(*(s1++)) + (unsigned int)(*(s2++))) >> 1);
-        *(sr++) = (uint8_t)(((unsigned int)(*(s1++)) + (unsigned int)(*(s2++))) >> 1);
+    for (int ink = 0; ink < 0x10; ink++) {
+        for (int paper = 0; paper < 8; paper++) {
+            int ci = colors[ink];
+            int cp = colors[paper];
 
-        #ifndef STAGE_FLIPPED_ARGB
-            *(sr++) = 0; ++s1; ++s2;
-        #endif
+            int r = ((unsigned int)STAGE_GETR(ci) + (unsigned int)STAGE_GETR(cp)) >> 1;
+            int g = ((unsigned int)STAGE_GETG(ci) + (unsigned int)STAGE_GETG(cp)) >> 1;
+            int b = ((unsigned int)STAGE_GETB(ci) + (unsigned int)STAGE_GETB(cp)) >> 1;
+
+            screenPalette[PALETTE_BLEND(ink, paper)] = STAGE_MAKERGB(r, g, b);
+        }
+    }
+
+    InvalidateScreen();
+}
+
+void MarkScreenLines(int fromLine, int toLine) {
+    fromLine = std::max(0, fromLine);
+    toLine = std::min(HEIGHT, toLine);
+
+    for (int y = fromLine; y < toLine; y++) {
+        screenDirtyLines[y] = true;
+        screenOverlayLines[y] = true;
+    }
+}
+
+// Next frame is expanded and sent whole (after palette or antiflicker changes, dialogs, etc.)
+void InvalidateScreen(void) {
+    isScreenInvalidated = true;
+}
+
+// Frames are rendered to the buffers in turn, and the last blendFrames of them are averaged on presentation.
+// Every buffer is compared only with its own presented copy, since other buffers are not changed in this frame.
+// Only lines which indices are changed since the previous presentation are expanded and marked as dirty.
+// Averages are per byte, so they don't depend on the pixel layout, and the unused byte stays zero.
+void PresentScreen(int renderedIndex) {
+    if (blendFilled < blendFrames) {
+        blendFilled++;
+        isScreenInvalidated = true; // more frames are blended than in the previous presentation
+    }
+
+    uint8_t* rendered = renderScreenBuffer[renderedIndex];
+    uint8_t* presented = presentedIndices[renderedIndex];
+
+    // FNV-1a over rendered indices, chained through the frames (before the blend, which doesn't depend on renderer)
+    if (expectedFramesHash) {
+        for (int i = 0; i < WIDTH * HEIGHT; i++) {
+            framesHash = (framesHash ^ rendered[i]) * 0x100000001B3ULL;
+        }
+    }
+
+    for (int y = 0, offset = 0; y < HEIGHT; y++, offset += WIDTH) {
+        bool isChanged = (isScreenInvalidated
+            || screenOverlayLines[y]
+            || memcmp(rendered + offset, presented + offset, WIDTH) != 0
+        );
+
+        screenOverlayLines[y] = false;
+
+        if (!isChanged) {
+            continue;
+        }
+
+        screenDirtyLines[y] = true;
+        memcpy(presented + offset, rendered + offset, WIDTH);
+
+        switch (blendFilled) {
+            case 3:
+                renderKernels.expandIndexedBlend3(
+                    screen + offset,
+                    renderScreenBuffer[0] + offset,
+                    renderScreenBuffer[1] + offset,
+                    renderScreenBuffer[2] + offset,
+                    screenPalette,
+                    WIDTH
+                );
+                break;
+
+            case 2:
+                renderKernels.expandIndexedBlend(
+                    screen + offset,
+                    renderScreenBuffer[0] + offset,
+                    renderScreenBuffer[1] + offset,
+                    screenPalette,
+                    WIDTH
+                );
+                break;
+
+            default:
+                renderKernels.expandIndexed(screen + offset, rendered + offset, screenPalette, WIDTH);
+                break;
+        }
+    }
+
+    isScreenInvalidated = false;
+}
+
+// Presents the frame rendered by the pipeline. It is called at the end of the next frame, and before the emulation
+// is stopped (pause, debugger, exit), so the picture is never more than one frame late.
+static bool PresentPendingFrame(void) {
+    if (!RenderPipeline_Wait()) {
+        return false;
     }
+
+    FRAME_STATS_MARK(FRAME_PHASE_RENDER);
+    PresentScreen(renderPendingIndex);
+    FRAME_STATS_MARK(FRAME_PHASE_EXPAND);
+
+    return true;
+}
+
+// Gigascreen pictures are made of two frames, so they are blended even if antiflicker is off
+static int GetBlendFrames(void) {
+    if (params.antiFlicker) {
+        return params.antiFlickerFrames;
+    }
+
+    return ((params.antiFlickerOnGigascreen && dev_extport.IsGigascreen()) ? 2 : 1);
 }
 
 void InitActClk(void) {
@@ -805,6 +1061,17 @@ void InitActClk(void) {
 // ...
 // TODO: refactor
 
+void EnterDebugger(void) {
+    // debugger has own event loop, so port reads should not steal its events
+    uint64_t savedInputSampleClk = nextInputSampleClk;
+    nextInputSampleClk = UINT64_MAX;
+
+    PresentPendingFrame();
+    RunDebugger();
+
+    nextInputSampleClk = savedInputSampleClk;
+}
+
 inline void CpuCalcTacts(unsigned long cmdClk) {
     if (turboMultiplier < 2) {
         devClkCounter += (uint64_t)cmdClk;
@@ -826,7 +1093,7 @@ inline void CpuCalcTacts(unsigned long cmdClk) {
 
     if (runDebuggerFlag || breakpoints[z80ex_get_reg(cpu, regPC)]) {
         runDebuggerFlag = false;
-        RunDebugger();
+        EnterDebugger();
     }
 }
 
@@ -903,54 +1170,235 @@ void DebugStep(void) {
     } while (z80ex_last_op_type(cpu) && cnt > 0);
 }
 
-void Render(void) {
-    static int sn = 0;
+// Host events are normally polled once per frame. To shorten input latency, keyboard and kempston port reads
+// poll the host again (at most once per params.inputSampleTacts), so the Z80 sees key changes mid-frame.
+// Actions and quit requests caught this way are deferred until the frame ends.
 
-    if (params.antiFlicker) {
-        renderScreen = renderScreenBuffer[sn];
-        sn = 1 - sn;
+void DispatchHwEvent(StageEvent& event) {
+    int i = cnt_hw;
+    s_HwItem* ptr_hw = hnd_hw;
+
+    while (i) {
+        if (ptr_hw->eventType == event.type && ptr_hw->func(event)) {
+            break;
+        }
+
+        ptr_hw++;
+        i--;
+    }
+}
+
+void RunAction(void (* action)(void)) {
+    if (isInputSampling) {
+        deferredActions.push_back(action);
     } else {
-        renderScreen = screen;
+        action();
+    }
+}
+
+void SampleHostInput(void) {
+    if (cpuClk < nextInputSampleClk || isInputSampling) {
+        return;
+    }
+
+    StageEvent event;
+
+    nextInputSampleClk = cpuClk + params.inputSampleTacts;
+    isInputSampling = true;
+
+    while (host->stage()->pollEvent(&event)) {
+        if (event.type == STAGE_EVENT_QUIT) {
+            inputSampledQuit = true;
+            continue;
+        }
+
+        if (event.type == STAGE_EVENT_KEYUP && event.keyCode == STAGE_KEYCODE_ESCAPE) {
+            inputSampledEscape = true;
+        }
+
+        DispatchHwEvent(event);
+    }
+
+    isInputSampling = false;
+}
+
+// Per-instruction warp conditions are checked in the separate loop, instantiated for each condition type,
+// so normal frames don't pay for them. Loop returns as soon as condition is met,
+// rest of the frame is emulated by the regular code in Render().
+
+template <int condition>
+inline bool IsWarpConditionMet(void) {
+    if (condition == WARP_PC) {
+        return (z80ex_get_reg(cpu, regPC) == warpCondition.addr
+            && (warpCondition.bank < 0
+                || warpCondition.addr < 0xC000
+                || C_MemoryManager::ram_map == &C_MemoryManager::ram[warpCondition.bank * 0x4000]
+            )
+        );
+    }
+
+    return (ReadByteDasm(warpCondition.addr, nullptr) == warpCondition.value);
+}
+
+template <int condition>
+bool WarpFrame(void) {
+    while (cpuClk < INT_LENGTH) {
+        CpuStep();
+
+        if (IsWarpConditionMet<condition>()) {
+            return true;
+        }
+
+        CpuInt();
+
+        if (IsWarpConditionMet<condition>()) {
+            return true;
+        }
+    }
+
+    while (cpuClk < MAX_FRAME_TACTS) {
+        CpuStep();
+
+        if (IsWarpConditionMet<condition>()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CompleteWarp(void) {
+    if (Warp_Complete()) {
+        EnterDebugger();
+    }
+}
+
+static inline void RenderCatchUpTo(unsigned long clk) {
+    Raster_ApplyFlags(renderState, dev_mman.ram + RAM_BANK4, Raster_GetMachineFlags());
+
+    if (!frameStatsEnabled) {
+        renderPtr(renderState, clk);
+        return;
     }
 
-    if (dev_extport.Is16Colors()) {
+    uint64_t startMicros = host->timer()->getElapsedMicros();
+    renderPtr(renderState, clk);
+    renderMicros += host->timer()->getElapsedMicros() - startMicros;
+}
+
+// Must be called by devices before they change anything what affects the picture (border color, screen page,
+// video memory), so the picture is rendered up to the given tact with the old values.
+void RenderCatchUp(unsigned long clk) {
+    if (isRenderRecorded) {
+        RenderPipeline_AddEvent(clk);
+    } else if (renderPtr) {
+        RenderCatchUpTo(clk);
+    }
+}
+
+// Same for the video memory write, value is needed for the frame record.
+void RenderCatchUpWrite(unsigned long clk, unsigned ramOffset, uint8_t value) {
+    if (isRenderRecorded) {
+        RenderPipeline_AddWrite(clk, ramOffset, value);
+    } else if (renderPtr) {
+        RenderCatchUpTo(clk);
+    }
+}
+
+// Returns true when the picture is presented (this frame, or the previous one rendered by the pipeline).
+// With isPresentedNow frame is rendered inline, so it is presented at the end of this frame (capture, last frame).
+bool Render(bool isPresentedNow) {
+    static int renderedIndex = 0;
+    int blend = GetBlendFrames();
+
+    if (blend != blendFrames) {
+        blendFrames = blend;
+        blendFilled = 0;
+        renderedIndex = 0;
+    }
+
+    renderState.into = renderScreenBuffer[renderedIndex];
+    renderState.prevClk = 0;
+
+    // picture is rendered lazily, before every change which affects it (see RenderCatchUp)
+    if (!drawFrame) {
+        renderPtr = nullptr;
+    } else if (dev_extport.Is16Colors()) {
         renderPtr = Render16c;
     } else if (dev_extport.IsMulticolor()) {
-        renderPtr = RenderMulticolor;
+        renderPtr = RenderSpeccy_Prepare(true, renderState);
     } else {
-        renderPtr = RenderSpeccy;
+        renderPtr = RenderSpeccy_Prepare(false, renderState);
     }
 
     // TODO: if (dev_extport.Is512x192()) { renderPtr = Render512x192; }
     // TODO: if (dev_extport.Is384x304()) { renderPtr = Render384x304; }
 
+    isRenderRecorded = (renderPtr && !isPresentedNow && RenderPipeline_IsEnabled());
+    bool isPresented = false;
+
+    if (isRenderRecorded) {
+        RenderPipeline_Begin(renderPtr, renderState, renderPtr == Render16c);
+    } else if (drawFrame) {
+        // pending frame is presented before the inline renderer writes to the buffers
+        isPresented = PresentPendingFrame();
+    }
+
     InitActClk();
-    prevRenderClk = 0;
+    renderMicros = 0;
+    nextInputSampleClk = (params.inputSampleTacts ? params.inputSampleTacts : UINT64_MAX);
+
+    if ((warpCondition.type == WARP_PC && WarpFrame<WARP_PC>())
+        || (warpCondition.type == WARP_MEMORY && WarpFrame<WARP_MEMORY>())
+    ) {
+        CompleteWarp();
+    }
 
     while (cpuClk < INT_LENGTH) {
         CpuStep();
         CpuInt();
     }
 
-    if (drawFrame) {
-        while (cpuClk < MAX_FRAME_TACTS) {
-            CpuStep();
-            renderPtr(cpuClk);
-        }
+    while (cpuClk < MAX_FRAME_TACTS) {
+        CpuStep();
+    }
+
+    // the rest of the frame after the last change
+    if (renderPtr && !isRenderRecorded) {
+        RenderCatchUpTo(cpuClk);
+    }
+
+    FRAME_STATS_MARK(FRAME_PHASE_CPU);
+
+    if (frameStatsEnabled && renderMicros) {
+        FrameStats_Move(FRAME_PHASE_CPU, FRAME_PHASE_RENDER, renderMicros);
+    }
+
+    // previous frame is presented before this one is submitted, so the worker renders only one frame at a time
+    if (isRenderRecorded) {
+        isPresented = PresentPendingFrame();
+        RenderPipeline_Submit(cpuClk);
+        renderPendingIndex = renderedIndex;
+    } else if (!drawFrame) {
+        isPresented = PresentPendingFrame();
     } else {
-        while (cpuClk < MAX_FRAME_TACTS) {
-            CpuStep();
-        }
+        PresentScreen(renderedIndex);
+        FRAME_STATS_MARK(FRAME_PHASE_EXPAND);
+        isPresented = true;
     }
 
     renderPtr = nullptr;
+    isRenderRecorded = false;
+    nextInputSampleClk = UINT64_MAX;
     lastDevClk = devClk;
     cpuClk -= MAX_FRAME_TACTS;
     devClk = cpuClk;
 
-    if (params.antiFlicker && drawFrame) {
-        AntiFlicker(1 - sn, sn);
+    if (drawFrame) {
+        renderedIndex = (renderedIndex + 1) % blendFrames;
     }
+
+    return isPresented;
 }
 
 void DrawIndicators(void) {
@@ -958,28 +1406,46 @@ void DrawIndicators(void) {
     DRIVE_STATE st = dev_trdos.GetIndicatorState();
 
     if (st == DS_READ) {
-        OutputGimpImage(8, 0, (s_GimpImage*)((void*) &img_floppyRead));
+        Overlay_Image(OVERLAY_ITEM_FLOPPY, 8, 0, (s_GimpImage*)((void*) &img_floppyRead));
     } else if (st == DS_WRITE) {
-        OutputGimpImage(8, 0, (s_GimpImage*)((void*) &img_floppyWrite));
+        Overlay_Image(OVERLAY_ITEM_FLOPPY, 8, 0, (s_GimpImage*)((void*) &img_floppyWrite));
     } else if (params.showInactiveIcons) {
-        OutputGimpImage(8, 0, (s_GimpImage*)((void*) &img_floppy));
+        Overlay_Image(OVERLAY_ITEM_FLOPPY, 8, 0, (s_GimpImage*)((void*) &img_floppy));
+    } else {
+        Overlay_Hide(OVERLAY_ITEM_FLOPPY);
     }
 
     if (params.maxSpeed) {
-        OutputGimpImage(32, 0, (s_GimpImage*)((void*) &img_turboOn));
+        Overlay_Image(OVERLAY_ITEM_TURBO, 32, 0, (s_GimpImage*)((void*) &img_turboOn));
     } else if (params.showInactiveIcons) {
-        OutputGimpImage(32, 0, (s_GimpImage*)((void*) &img_turboOff));
+        Overlay_Image(OVERLAY_ITEM_TURBO, 32, 0, (s_GimpImage*)((void*) &img_turboOff));
+    } else {
+        Overlay_Hide(OVERLAY_ITEM_TURBO);
     }
 
     if (C_Tape::IsActive()) {
         sprintf(buf, "%u%%", C_Tape::GetPosPerc());
-        font->PrintString(WIDTH - 4 - font->StrLenPx(buf), 4, buf);
+        Overlay_Text(OVERLAY_ITEM_TAPE, WIDTH - 4 - font->StrLenPx(buf), 4, font, buf);
+    } else {
+        Overlay_Hide(OVERLAY_ITEM_TAPE);
     }
 
-    for (unsigned i = 0; i < watchesCount; i++) {
+    for (unsigned i = 0; i < MAX_WATCHES; i++) {
+        if (i >= watchesCount) {
+            Overlay_Hide(OVERLAY_ITEM_WATCHES + i);
+            continue;
+        }
+
         uint8_t val = ReadByteDasm(watches[i], nullptr);
         sprintf(buf, "%04X:%02X", watches[i], val);
-        fixed_font->PrintString(WIDTH - 4 - fixed_font->StrLenPx(buf), 4 + fixed_font->Height() * (i + 1), buf);
+
+        Overlay_Text(
+            OVERLAY_ITEM_WATCHES + i,
+            WIDTH - 4 - fixed_font->StrLenPx(buf),
+            4 + fixed_font->Height() * (i + 1),
+            fixed_font,
+            buf
+        );
     }
 }
 
@@ -997,8 +1463,22 @@ void ResetSequence(void) {
     }
 }
 
+// Sends the whole screen, used by dialogs. They draw over the emulated picture, so it is restored in the next frame.
+// OSD is hidden while dialog is shown.
 void UpdateScreen(void) {
-    host->stage()->renderFrame(screen, WIDTH, HEIGHT);
+    Overlay_Suspend();
+    screen = host->stage()->renderFrame(nullptr);
+    InvalidateScreen();
+}
+
+// Sends only lines which were changed, nothing if the picture is the same.
+void UpdateScreenLines(void) {
+    if (std::find(screenDirtyLines, screenDirtyLines + HEIGHT, true) == screenDirtyLines + HEIGHT) {
+        return;
+    }
+
+    screen = host->stage()->renderFrame(screenDirtyLines);
+    std::fill(screenDirtyLines, screenDirtyLines + HEIGHT, false);
 }
 
 void Process(void) {
@@ -1007,12 +1487,13 @@ void Process(void) {
     int frameSkip = 0;
     bool tapePrevActive = false;
 
-    devClkCounter = 0;
-    cpuClk = 0;
-    devClk = 0;
-    lastDevClk = 0;
     frames = 0;
-    params.maxSpeed = false;
+    params.maxSpeed = startAtMaxSpeed;
+
+    if (startWarpCondition.type != WARP_NONE) {
+        Warp_Start(startWarpCondition);
+    }
+
     uint32_t ntick = host->timer()->getElapsedMillis() + ((params.maxSpeed || host->stage()->isSoundEnabled()) ? 0 : FRAME_WAIT_MS);
 
     for (;;) {
@@ -1039,24 +1520,58 @@ void Process(void) {
                 drawFrame = true;
             }
 
+            if (warpCondition.type != WARP_NONE) {
+                drawFrame = false;
+            }
+
+            // every emulated frame is captured, in sync with the sound (without the render pipeline latency)
+            bool isPresentedNow = Capture_IsActive();
+
+            // final frame should be complete for --dump-screen
+            if (runFramesLimit && (unsigned)frames + 1 >= runFramesLimit) {
+                isPresentedNow = true;
+            }
+
+            if (isPresentedNow) {
+                drawFrame = true;
+            }
+
             tapePrevActive = C_Tape::IsActive();
 
-            Render();
+            bool isPresented = Render(isPresentedNow);
             frames++;
+            flashFrames++;
 
-            if (drawFrame) {
-                DrawIndicators();
-                ShowMessage();
-                UpdateScreen();
+            if (warpCondition.type == WARP_FRAME && --warpCondition.frames <= 0) {
+                CompleteWarp();
             }
 
-            if (!params.maxSpeed) {
+            if (isPresented) {
+                Capture_AddFrame(screen);
+
+                // OSD goes to the overlay, screen contains only the emulated picture
+                if (!params.headless) {
+                    DrawIndicators();
+                    Capture_Draw();
+                    ShowMessage();
+                    FrameStats_Draw();
+                    Overlay_Flush();
+                    FRAME_STATS_MARK(FRAME_PHASE_OSD);
+                }
+
+                UpdateScreenLines();
+                FRAME_STATS_MARK(FRAME_PHASE_PRESENT);
+            }
+
+            if (!params.maxSpeed && !params.headless) {
                 host->timer()->wait(1);
                 uint32_t ctick = host->timer()->getElapsedMillis();
 
                 if (ctick < ntick) {
                     host->timer()->wait(ntick - ctick);
                 }
+
+                FRAME_STATS_MARK(FRAME_PHASE_WAIT);
             }
 
             i = cnt_afterFrameRender;
@@ -1069,12 +1584,32 @@ void Process(void) {
                 i--;
             }
 
-            soundMixer.FlushFrame(SHOULD_OUTPUT_SOUND);
+            soundMixer.FlushFrame(SHOULD_OUTPUT_SOUND || Capture_IsActive(), SHOULD_OUTPUT_SOUND);
+            FRAME_STATS_MARK(FRAME_PHASE_SOUND);
         }
 
+        bool wasFrameEmulated = !isPaused;
+
         ntick = host->timer()->getElapsedMillis() + ((params.maxSpeed || host->stage()->isSoundEnabled()) ? 0 : FRAME_WAIT_MS);
         isPaused = isPausedNx;
-        bool quitMode = false;
+
+        // emulation is stopped, so the frame rendered by the pipeline is shown now
+        if (isPaused && PresentPendingFrame()) {
+            UpdateScreenLines();
+        }
+
+        if (inputSampledQuit) {
+            exit(0);
+        }
+
+        bool quitMode = inputSampledEscape;
+        inputSampledEscape = false;
+
+        while (!deferredActions.empty()) {
+            void (* action)(void) = deferredActions.front();
+            deferredActions.pop_front();
+            action();
+        }
 
         while (host->stage()->pollEvent(&event)) {
             if (event.type == STAGE_EVENT_QUIT) {
@@ -1085,17 +1620,12 @@ void Process(void) {
                 quitMode = true;
             }
 
-            i = cnt_hw;
-            s_HwItem* ptr_hw = hnd_hw;
-
-            while (i) {
-                if (ptr_hw->eventType == event.type && ptr_hw->func(event)) {
-                    break;
-                }
+            DispatchHwEvent(event);
+        }
 
-                ptr_hw++;
-                i--;
-            }
+        if (frameStatsEnabled) {
+            FrameStats_Mark(FRAME_PHASE_EVENTS);
+            FrameStats_EndFrame(wasFrameEmulated);
         }
 
         if (quitMode) {
@@ -1110,17 +1640,39 @@ void Process(void) {
         unturbo = unturboNx;
 
         if (!isPaused && tapePrevActive && !C_Tape::IsActive()) {
-            if (params.maxSpeed) {
+            if (runUntilTapeEnd) {
+                return;
+            }
+
+            if (warpCondition.type == WARP_TAPE_END) {
+                CompleteWarp();
+            } else if (params.maxSpeed) {
                 SetMessage("Tape end : MaxSpeed OFF");
                 params.maxSpeed = false;
             } else {
                 SetMessage("Tape end");
             }
         }
+
+        if (runFramesLimit && (unsigned)frames >= runFramesLimit) {
+            return;
+        }
+
+        if (runUntilMovieEnd && movieState == MOVIE_STATE_NONE && !Movie_IsPending()) {
+            return;
+        }
     }
 }
 
 void FreeAll(void) {
+    RenderPipeline_Close();
+    Movie_Close();
+    FrameStats_Close();
+    Capture_Close();
+    Rewind_Close();
+    QuickSave_Close();
+    Journal_Close();
+
     for (int i = 0; devs[i]; i++) {
         devs[i]->Close();
     }
@@ -1139,16 +1691,14 @@ void FreeAll(void) {
         z80ex_destroy(cpu);
     }
 
-    if (renderScreenBuffer[1]) {
-        delete[] renderScreenBuffer[1];
-    }
-
-    if (renderScreenBuffer[0]) {
-        delete[] renderScreenBuffer[0];
-    }
+    for (int i = 0; i < ANTIFLICKER_MAX_FRAMES; i++) {
+        if (presentedIndices[i]) {
+            delete[] presentedIndices[i];
+        }
 
-    if (screen) {
-        delete[] screen;
+        if (renderScreenBuffer[i]) {
+            delete[] renderScreenBuffer[i];
+        }
     }
 
     delete host;
@@ -1164,12 +1714,160 @@ void ParseCmdLine(int argc, char *argv[]) {
                 argv++;
                 argc--;
 
-                Labels_Load(*argv);
+                labelsFileName = *argv;
             }
         } else if (!strcmp(*argv, "-w")) {
             recordWav = true;
+        } else if (!strcmp(*argv, "--capture")) {
+            startCapture = true;
+        } else if (!strcmp(*argv, "--frame-stats")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                frameStatsFileName = *argv;
+            }
+        } else if (!strcmp(*argv, "--record")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                Movie_Record(*argv);
+            }
+        } else if (!strcmp(*argv, "--replay")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                Movie_Replay(*argv);
+                runUntilMovieEnd = true;
+            }
+        } else if (!strcmp(*argv, "--headless")) {
+            params.headless = true;
+        } else if (!strcmp(*argv, "--max-speed")) {
+            startAtMaxSpeed = true;
+        } else if (!strcmp(*argv, "--frames")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                runFramesLimit = (unsigned)std::max(0, atoi(*argv));
+            }
+        } else if (!strcmp(*argv, "--until-tape-end")) {
+            runUntilTapeEnd = true;
+        } else if (!strcmp(*argv, "--dump-screen")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                dumpScreenFileName = *argv;
+            }
+        } else if (!strcmp(*argv, "--save-state")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                saveStateFileName = *argv;
+            }
+        } else if (!strcmp(*argv, "--journal")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                journalFileName = *argv;
+            }
+        } else if (!strcmp(*argv, "--journal-point")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                journalRestorePoint = std::max(0, atoi(*argv));
+            }
+        } else if (!strcmp(*argv, "--keys")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                if (!KeyScript_Parse(*argv)) {
+                    StrikeError("Invalid key script \"%s\"", *argv);
+                }
+            }
+        } else if (!strcmp(*argv, "--warp")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                if (!Warp_Parse(*argv, startWarpCondition)) {
+                    StrikeError("Invalid warp condition \"%s\"", *argv);
+                }
+            }
+        } else if (!strcmp(*argv, "--batch")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                batchManifestFileName = *argv;
+            }
+        } else if (!strcmp(*argv, "--jobs")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                batchJobs = std::max(0, atoi(*argv));
+            }
+        } else if (!strcmp(*argv, "--report")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                batchReportFileName = *argv;
+            }
+        } else if (!strcmp(*argv, "--expect-screen-hash")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                expectedScreenHash = *argv;
+            }
+        } else if (!strcmp(*argv, "--expect-audio-hash")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                expectedAudioHash = *argv;
+            }
+        } else if (!strcmp(*argv, "--expect-frames-hash")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                expectedFramesHash = *argv;
+            }
+        } else if (!strcmp(*argv, "--render-pipeline")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                renderPipelineOption = (!strcmp(*argv, "yes") ? 1 : 0);
+            }
+        } else if (!strcmp(*argv, "--bench-render")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                benchRenderFrames = (unsigned)std::max(0, atoi(*argv));
+            }
+        } else if (!strcmp(*argv, "--result-line")) {
+            printResultLine = true;
+        } else if (!strcmp(*argv, "--dump-audio")) {
+            if (argc > 1) {
+                argv++;
+                argc--;
+
+                dumpAudioFileName = *argv;
+            }
         } else {
-            TryNLoadFile(*argv);
+            startFileName = *argv;
             return;
         }
 
@@ -1178,6 +1876,78 @@ void ParseCmdLine(int argc, char *argv[]) {
     }
 }
 
+void DumpScreen(const char* fileName) {
+    DataWriterPtr writer;
+
+    try {
+        writer = host->storage()->path(fileName)->dataWriter();
+    } catch (StorageException& e) {
+        printf("Screen dump failed: %s\n", e.what());
+        return;
+    }
+
+    writer->writeFmt("P6\n%d %d\n255\n", WIDTH, HEIGHT);
+
+    uint8_t line[WIDTH * 3];
+    uint32_t* src = screen;
+
+    for (int y = 0; y < HEIGHT; y++) {
+        uint8_t* dst = line;
+
+        for (int x = 0; x < WIDTH; x++) {
+            uint32_t c = *(src++);
+
+            *(dst++) = (uint8_t)STAGE_GETR(c);
+            *(dst++) = (uint8_t)STAGE_GETG(c);
+            *(dst++) = (uint8_t)STAGE_GETB(c);
+        }
+
+        writer->writeBlock(line, sizeof(line));
+    }
+
+    printf("Screen dumped to \"%s\"\n", fileName);
+}
+
+// FNV-1a over RGB bytes in the same order as in the screen dump, so hash doesn't depend on the host pixel format
+uint64_t ScreenHash(void) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    uint32_t* src = screen;
+
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        uint32_t c = *(src++);
+
+        hash = (hash ^ (uint8_t)STAGE_GETR(c)) * 0x100000001B3ULL;
+        hash = (hash ^ (uint8_t)STAGE_GETG(c)) * 0x100000001B3ULL;
+        hash = (hash ^ (uint8_t)STAGE_GETB(c)) * 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+bool CheckGoldenHash(const char* name, const char* expected, uint64_t actual) {
+    if (!expected) {
+        return true;
+    }
+
+    if (strtoull(expected, nullptr, 16) == actual) {
+        printf("%s hash matches golden value\n", name);
+        return true;
+    }
+
+    printf("%s hash mismatch: expected %s, got %016llx\n", name, expected, (unsigned long long)actual);
+    return false;
+}
+
+bool IsScreenBlank(void) {
+    for (int i = 1; i < WIDTH * HEIGHT; i++) {
+        if (screen[i] != screen[0]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void OutputLogo(void) {
     printf("                                        \n");
     printf("    $ww,.                               \n");
@@ -1207,8 +1977,17 @@ int main(int argc, char *argv[]) {
     atexit(FreeAll);
 
     auto config = host->config();
+    bool isGoldenMatched = true;
 
     try {
+        if (argc != 1) {
+            ParseCmdLine(argc, argv);
+        }
+
+        if (batchManifestFileName) {
+            return Batch_Run(argv[0], batchManifestFileName, batchJobs, batchReportFileName);
+        }
+
         StageConfig stageConfig;
 
         stageConfig.title = "zEmu";
@@ -1226,6 +2005,8 @@ int main(int argc, char *argv[]) {
 
         if (str == "sna") {
             params.snapFormat = SNAP_FORMAT_SNA;
+        } else if (str == "zst") {
+            params.snapFormat = SNAP_FORMAT_ZST;
         } else {
             params.snapFormat = SNAP_FORMAT_Z80;
         }
@@ -1266,12 +2047,20 @@ int main(int argc, char *argv[]) {
         // display
         stageConfig.fullscreen = config->getBool("display", "fullscreen", false);
 
-        if (!config->getBool("display", "scale2x", true)) {
+        // "scale2x" is used by older configs
+        int scale = config->getInt("display", "scale", config->getBool("display", "scale2x", true) ? 2 : 1);
+        bool scanlines = config->getBool("display", "scanlines", false);
+
+        if (scale <= 1) {
             stageConfig.renderMode = STAGE_RENDER_MODE_1X;
-        } else if (config->getBool("display", "scanlines", false)) {
-            stageConfig.renderMode = STAGE_RENDER_MODE_2X_SCANLINES;
+        } else if (scale == 2 && config->getBool("display", "epx", false)) {
+            stageConfig.renderMode = STAGE_RENDER_MODE_2X_EPX;
+        } else if (scale == 2) {
+            stageConfig.renderMode = (scanlines ? STAGE_RENDER_MODE_2X_SCANLINES : STAGE_RENDER_MODE_2X);
+        } else if (scale == 3) {
+            stageConfig.renderMode = (scanlines ? STAGE_RENDER_MODE_3X_SCANLINES : STAGE_RENDER_MODE_3X);
         } else {
-            stageConfig.renderMode = STAGE_RENDER_MODE_2X;
+            stageConfig.renderMode = (scanlines ? STAGE_RENDER_MODE_4X_SCANLINES : STAGE_RENDER_MODE_4X);
         }
 
         #ifdef USE_SDL1
@@ -1281,6 +2070,8 @@ int main(int argc, char *argv[]) {
         #endif
 
         params.antiFlicker = config->getBool("display", "antiflicker", false);
+        params.antiFlickerFrames = std::max(2, std::min(ANTIFLICKER_MAX_FRAMES, config->getInt("display", "antiflicker_frames", 2)));
+        params.antiFlickerOnGigascreen = config->getBool("display", "antiflicker_on_gigascreen", true);
         params.showInactiveIcons = config->getBool("display", "showinactiveicons", false);
 
         // input
@@ -1306,6 +2097,9 @@ int main(int argc, char *argv[]) {
             params.mouseDivY = std::max(1, std::min(8, mouseDiv));
         }
 
+        int subframePolls = std::max(0, std::min(64, config->getInt("input", "subframepolls", 4)));
+        params.inputSampleTacts = (subframePolls ? MAX_FRAME_TACTS / (subframePolls + 1) : 0);
+
         // sound
         stageConfig.soundEnabled = config->getBool("sound", "enable", true);
         params.mixerMode = config->getInt("sound", "mixermode", 1);
@@ -1318,6 +2112,9 @@ int main(int argc, char *argv[]) {
         } else if (str == "sdl") {
             stageConfig.soundDriver = STAGE_SOUND_DRIVER_GENERIC;
             stageConfig.soundParams[0] = std::log2(config->getInt("sound", "sdlbuffersize", 0));
+        } else if (str == "wav") {
+            stageConfig.soundDriver = STAGE_SOUND_DRIVER_WAV;
+            stageConfig.soundFileName = config->getString("sound", "wavfile", "output.wav");
         }
         #ifdef _WIN32
             else if (str == "win32") {
@@ -1355,6 +2152,14 @@ int main(int argc, char *argv[]) {
         str = config->getString("cputrace", "filename", "cputrace.log");
         strcpy(params.cpuTraceFileName, str.c_str());
 
+        if (params.headless) {
+            params.hashAudio = (printResultLine || expectedAudioHash);
+            stageConfig.headless = true;
+            stageConfig.soundEnabled = (dumpAudioFileName != nullptr);
+            stageConfig.soundDriver = (dumpAudioFileName ? STAGE_SOUND_DRIVER_WAV : STAGE_SOUND_DRIVER_NONE);
+            stageConfig.soundFileName = (dumpAudioFileName ? dumpAudioFileName : "");
+        }
+
         host->setStageConfig(stageConfig);
         host->stage(); // force stage initialization
 
@@ -1365,20 +2170,104 @@ int main(int argc, char *argv[]) {
         }
 
         InitAll();
+        // clocks are set before loading start file, because it can be a full machine state
+        devClkCounter = 0;
+        cpuClk = 0;
+        devClk = 0;
+        lastDevClk = 0;
+
         ResetSequence();
 
-        if (argc != 1) {
-            ParseCmdLine(argc, argv);
+        if (labelsFileName) {
+            Labels_Load(labelsFileName);
+        }
+
+        if (startFileName) {
+            isStartFileLoaded = TryNLoadFile(startFileName);
+        }
+
+        KeyScript_Init();
+
+        soundMixer.Init(params.mixerMode);
+
+        if (params.hashAudio) {
+            soundMixer.EnableHash();
         }
 
-        soundMixer.Init(params.mixerMode, recordWav, wavFileName);
+        FrameStats_Init(frameStatsFileName);
+        Rewind_Init(Action_Rewind);
+        QuickSave_Init();
+        Capture_Init();
+        if (renderPipelineOption != 0) {
+            RenderPipeline_Init(renderPipelineOption == 1);
+        }
+
+        if (startCapture) {
+            Capture_Toggle();
+        } else if (recordWav) {
+            Capture_Start(nullptr, wavFileName);
+        }
+
+        if (journalFileName) {
+            Journal_Init(journalFileName);
+        }
+
+        // don't touch machine which was restored from the full state
+        bool isStartStateLoaded = (isStartFileLoaded
+            && (host->storage()->path(startFileName)->extensionLc() == STATE_EXTENSION
+                || host->storage()->path(startFileName)->extensionLc() == JOURNAL_EXTENSION
+            )
+        );
 
-        if (config->getBool("core", "trdos_at_start", false)) {
+        if (config->getBool("core", "trdos_at_start", false) && !isStartStateLoaded) {
             dev_mman.OnOutputByte(0x7FFD, 0x10);
             dev_trdos.Enable();
         }
 
+        uint32_t startTick = host->timer()->getElapsedMillis();
         Process();
+        PresentPendingFrame();
+
+        if (params.headless) {
+            uint32_t elapsed = std::max(1U, host->timer()->getElapsedMillis() - startTick);
+            printf("Emulated %d frames in %u ms (%.1f fps)\n", frames, elapsed, frames * 1000.0 / elapsed);
+
+            isGoldenMatched = CheckGoldenHash("Screen", expectedScreenHash, ScreenHash());
+            isGoldenMatched = CheckGoldenHash("Audio", expectedAudioHash, soundMixer.GetHash()) && isGoldenMatched;
+            isGoldenMatched = CheckGoldenHash("Frames", expectedFramesHash, framesHash) && isGoldenMatched;
+
+            if ((expectedScreenHash || expectedAudioHash || expectedFramesHash) && startFileName && !isStartFileLoaded) {
+                printf("Golden check failed: \"%s\" was not loaded\n", startFileName);
+                isGoldenMatched = false;
+            }
+
+            if (printResultLine) {
+                printf(
+                    "%s loaded=%d blank=%d golden=%d frames=%d fps=%.1f screen=%016llx audio=%016llx rss=%llu\n",
+                    BATCH_RESULT_PREFIX,
+                    (startFileName == nullptr || isStartFileLoaded) ? 1 : 0,
+                    IsScreenBlank() ? 1 : 0,
+                    isGoldenMatched ? 1 : 0,
+                    frames,
+                    frames * 1000.0 / elapsed,
+                    (unsigned long long)ScreenHash(),
+                    (unsigned long long)soundMixer.GetHash(),
+                    (unsigned long long)Batch_GetPeakRssKb()
+                );
+            }
+        }
+
+        if (dumpScreenFileName) {
+            DumpScreen(dumpScreenFileName);
+        }
+
+        if (benchRenderFrames && !RenderBench_Run(benchRenderFrames)) {
+            isGoldenMatched = false;
+        }
+
+        if (saveStateFileName) {
+            State_SaveFile(saveStateFileName);
+        }
 
         if (params.cpuTraceEnabled) {
             CpuTrace_Close();
@@ -1387,5 +2276,5 @@ int main(int argc, char *argv[]) {
         StrikeError("%s", e.what());
     }
 
-    return 0;
+    return (isGoldenMatched ? 0 : 2);
 }
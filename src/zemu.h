@@ -13,16 +13,24 @@
 #endif
 
 #include "params.h"
-#define SHOULD_OUTPUT_SOUND (!params.maxSpeed && host->stage()->isSoundEnabled())
+#define SHOULD_OUTPUT_SOUND ((!params.maxSpeed || params.headless) && (host->stage()->isSoundEnabled() || params.hashAudio))
 
 struct s_Action {
     const char* name;
     void (* action)(void);
 };
 
+#define SNAP_FORMAT_Z80 0
+#define SNAP_FORMAT_SNA 1
+#define SNAP_FORMAT_ZST 2
+
+#define ANTIFLICKER_MAX_FRAMES 3
+
 struct s_Params {
     bool maxSpeed;
     bool antiFlicker;
+    int antiFlickerFrames; // 2 or 3 frames are blended with antiflicker
+    bool antiFlickerOnGigascreen; // blend 2 frames when gigascreen mode is set with the port EFF7
     int mouseDivX;
     int mouseDivY;
     bool showInactiveIcons;
@@ -31,17 +39,20 @@ struct s_Params {
     char cpuTraceFileName[MAX_PATH];
     int mixerMode;
     int snapFormat;
+    unsigned inputSampleTacts;
+    bool headless;
+    bool hashAudio;
 };
 
-extern uint32_t* screen;
-extern uint32_t* renderScreen; // points to renderScreenBuffer
-extern uint32_t* renderScreenBuffer[2];
+extern uint32_t* screen; // frame buffer of the stage, is replaced by UpdateScreen() and UpdateScreenLines()
+extern uint8_t* renderScreenBuffer[ANTIFLICKER_MAX_FRAMES];
 
 extern Z80EX_CONTEXT* cpu;
 extern uint64_t cpuClk, devClk, lastDevClk, devClkCounter;
 extern s_Params params;
 extern bool drawFrame;
 extern int frames;
+extern unsigned flashFrames;
 extern char tempFolderName[MAX_PATH];
 
 extern s_Action cfgActions[];
@@ -83,7 +94,30 @@ extern int screensHack; // 0 = no hack, 8 = swap screens
 extern bool flashColor;
 extern int colors_base[0x10];
 extern int colors[0x10];
+
+// Renderers write indices of the screen palette (1 byte per pixel), which are expanded to pixels on presentation.
+// First 16 entries are the colors, others are derived from them by UpdateScreenPalette().
+#define PALETTE_BLACK 0x10
+#define PALETTE_DARK_GRAY 0x11
+#define PALETTE_LIGHT_GRAY 0x12
+#define PALETTE_WHITE 0x13
+#define PALETTE_BLEND(ink, paper) (0x20 + ((ink) << 3) + (paper)) // ink 0 - 15, paper 0 - 7 (for flashColor)
+#define PALETTE_SIZE 0x100
+
+extern uint32_t screenPalette[PALETTE_SIZE];
+
+void UpdateScreenPalette(void);
+
+// Lines of the screen which were changed since the previous UpdateScreenLines().
+// Everything what draws over the emulated picture (OSD, dialogs) must mark lines with MarkScreenLines(),
+// so they are sent to the stage, and are restored from the emulated picture in the next frame.
+extern bool screenDirtyLines[HEIGHT];
+
+void MarkScreenLines(int fromLine, int toLine);
+void InvalidateScreen(void);
+extern unsigned turboMultiplier;
 extern unsigned turboMultiplierNx;
+extern bool unturbo;
 extern bool unturboNx;
 
 //--------------------------------------------------------------------------------------------------------------
@@ -98,14 +132,21 @@ uint8_t ReadByteDasm(uint16_t addr, void* userData);
 void WriteByteDasm(uint16_t addr, uint8_t value);
 void DebugStep(void);
 
-extern unsigned long prevRenderClk;
-extern void (* renderPtr)(unsigned long);
+// Bitmap and attributes (second bitmap for multicolor and 16 colors modes) at the start of the screen page.
+#define VIDEO_RAM_SIZE 0x3800
+
+void RenderCatchUp(unsigned long clk);
+void RenderCatchUpWrite(unsigned long clk, unsigned ramOffset, uint8_t value);
 
 //--------------------------------------------------------------------------------------------------------------
 
-void TryNLoadFile(const char* fname, int drive = 0);
+bool TryNLoadFile(const char* fname, int drive = 0);
 void UpdateScreen(void);
+void UpdateScreenLines(void);
 void DisplayTurboMessage(void);
+void SetMessage(const char* str);
+void RunAction(void (* action)(void));
+void SampleHostInput(void);
 
 //--------------------------------------------------------------------------------------------------------------
 
@@ -0,0 +1,487 @@
+#!/usr/bin/env python3
+# Generates reference programs for the golden hash tests (see tests/CMakeLists.txt).
+# Programs are hand-assembled, so no Z80 assembler is required. Run it from any directory,
+# files are written to the "programs" directory near this script.
+
+import os
+import struct
+
+PROGRAMS_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "programs")
+CODE_ADDR = 0x8000
+
+
+class Asm:
+    def __init__(self, org):
+        self.org = org
+        self.code = bytearray()
+        self.labels = {}
+        self.fixups = []
+        self.tables = []
+
+    def addr(self):
+        return self.org + len(self.code)
+
+    def label(self, name):
+        self.labels[name] = self.addr()
+
+    def emit(self, *values):
+        self.code += bytes(values)
+
+    def emit_word(self, value):
+        self.emit(value & 0xFF, value >> 8)
+
+    def emit_rel(self, opcode, name):
+        self.emit(opcode, 0)
+        self.fixups.append((len(self.code) - 1, name))
+
+    def build(self):
+        for pos, name in self.fixups:
+            offset = self.labels[name] - (self.org + pos + 1)
+            assert -128 <= offset <= 127, name
+            self.code[pos] = offset & 0xFF
+
+        return bytes(self.code)
+
+    # instructions (only ones used by the programs)
+
+    def di(self): self.emit(0xF3)
+    def ei(self): self.emit(0xFB)
+    def halt(self): self.emit(0x76)
+    def ret(self): self.emit(0xC9)
+    def ldir(self): self.emit(0xED, 0xB0)
+    def out_c_a(self): self.emit(0xED, 0x79)
+    def in_a_c(self): self.emit(0xED, 0x78)
+    def out_n_a(self, n): self.emit(0xD3, n)
+    def ld_a(self, n): self.emit(0x3E, n)
+    def ld_b(self, n): self.emit(0x06, n)
+    def ld_e(self, n): self.emit(0x1E, n)
+    def ld_bc(self, nn): self.emit(0x01); self.emit_word(nn)
+    def ld_de(self, nn): self.emit(0x11); self.emit_word(nn)
+    def ld_hl(self, nn): self.emit(0x21); self.emit_word(nn)
+    def ld_a_hl(self): self.emit(0x7E)
+    def ld_hl_a(self): self.emit(0x77)
+    def ld_hl_n(self, n): self.emit(0x36, n)
+    def ld_de_hl(self): self.emit(0x54, 0x5D) # ld d,h : ld e,l
+    def ld_a_h(self): self.emit(0x7C)
+    def ld_a_l(self): self.emit(0x7D)
+    def ld_a_b(self): self.emit(0x78)
+    def ld_a_e(self): self.emit(0x7B)
+    def xor_a(self): self.emit(0xAF)
+    def xor_h(self): self.emit(0xAC)
+    def add_a_h(self): self.emit(0x84)
+    def and_n(self, n): self.emit(0xE6, n)
+    def or_c(self): self.emit(0xB1)
+    def rlca(self): self.emit(0x07)
+    def rrca(self): self.emit(0x0F)
+    def inc_a(self): self.emit(0x3C)
+    def inc_e(self): self.emit(0x1C)
+    def dec_e(self): self.emit(0x1D)
+    def inc_hl(self): self.emit(0x23)
+    def inc_de(self): self.emit(0x13)
+    def dec_bc(self): self.emit(0x0B)
+    def bit_a(self, b): self.emit(0xCB, 0x47 | (b << 3))
+    def jr(self, name): self.emit_rel(0x18, name)
+    def jr_nz(self, name): self.emit_rel(0x20, name)
+    def jr_z(self, name): self.emit_rel(0x28, name)
+    def djnz(self, name): self.emit_rel(0x10, name)
+
+    # helpers
+
+    def out_bc(self, port, value):
+        self.ld_bc(port)
+        self.ld_a(value)
+        self.out_c_a()
+
+    def fill_pattern(self, start, length, pattern):
+        # (hl) = pattern(l, h) for every byte, pattern emits instructions, that get "a" = l and can use h
+        loop = "fill_%04x" % self.addr()
+        self.ld_hl(start)
+        self.ld_bc(length)
+        self.label(loop)
+        self.ld_a_l()
+        pattern(self)
+        self.ld_hl_a()
+        self.inc_hl()
+        self.dec_bc()
+        self.ld_a_b()
+        self.or_c()
+        self.jr_nz(loop)
+
+    def write_regs(self, select_port, data_port, regs):
+        # writes (reg, value) pairs from the table which follows the code
+        self.ld_hl(0) # patched below
+        patch = len(self.code) - 2
+        self.ld_e(len(regs))
+        loop = "regs_%04x" % self.addr()
+        self.label(loop)
+        self.ld_bc(select_port)
+        self.ld_a_hl()
+        self.inc_hl()
+        self.out_c_a()
+        self.ld_bc(data_port)
+        self.ld_a_hl()
+        self.inc_hl()
+        self.out_c_a()
+        self.dec_e()
+        self.jr_nz(loop)
+        self.tables.append((patch, bytes(v for reg in regs for v in reg)))
+
+    def place_tables(self):
+        for patch, table in self.tables:
+            addr = self.addr()
+            self.code[patch] = addr & 0xFF
+            self.code[patch + 1] = addr >> 8
+            self.code += table
+
+    def halt_loop(self):
+        self.ei()
+        self.label("halt_loop")
+        self.halt()
+        self.jr("halt_loop")
+
+
+def new_program():
+    return Asm(CODE_ADDR)
+
+
+def finish_program(asm):
+    asm.place_tables()
+    return asm.build()
+
+
+# Screen is filled with a pattern, that depends on the address. Used by several programs.
+def draw_scene(asm):
+    asm.fill_pattern(0x4000, 0x1800, lambda a: (a.xor_h(), a.rrca()))
+    asm.fill_pattern(0x5800, 0x0300, lambda a: (a.add_a_h(), a.and_n(0x7F)))
+
+
+# .z80 v3 128k snapshot. Code is placed in bank 2 (0x8000), 48k ROM is on, interrupts are enabled by the code.
+def z80_compress(data):
+    out = bytearray()
+    i = 0
+
+    while i < len(data):
+        b = data[i]
+        n = 1
+
+        while i + n < len(data) and data[i + n] == b and n < 255:
+            n += 1
+
+        if n >= 5 or (b == 0xED and n >= 2):
+            out += bytes((0xED, 0xED, n, b))
+            i += n
+        else:
+            out.append(b)
+            i += 1
+
+            # byte after single ED is never a start of the run
+            if b == 0xED and i < len(data):
+                out.append(data[i])
+                i += 1
+
+    return bytes(out)
+
+
+def make_z80(code, border=0):
+    banks = [bytearray(0x4000) for _ in range(8)]
+    banks[2][CODE_ADDR - 0x8000:CODE_ADDR - 0x8000 + len(code)] = code
+
+    header = bytearray(30)
+    header[8:10] = struct.pack("<H", 0xBFF0) # SP
+    header[12] = border << 1
+    header[23:25] = struct.pack("<H", 0x5C3A) # IY, for 48k ROM interrupt handler
+    header[29] = 1 # IM 1
+
+    add_header = bytearray(54)
+    add_header[0:2] = struct.pack("<H", CODE_ADDR) # PC
+    add_header[2] = 4 # 128k
+    add_header[3] = 0x10 # 7FFD: 48k ROM, bank 0
+
+    data = bytearray(header)
+    data += struct.pack("<H", len(add_header))
+    data += add_header
+
+    for bank in range(8):
+        packed = z80_compress(banks[bank])
+        data += struct.pack("<HB", len(packed), bank + 3)
+        data += packed
+
+    return bytes(data)
+
+
+# BASIC
+
+def basic_number(value):
+    return str(value).encode() + bytes((0x0E, 0, 0, value & 0xFF, value >> 8, 0))
+
+
+def basic_line(number, tokens):
+    body = tokens + b"\x0D"
+    return struct.pack(">H", number) + struct.pack("<H", len(body)) + body
+
+
+TOKEN_CODE = b"\xAF"
+TOKEN_USR = b"\xC0"
+TOKEN_REM = b"\xEA"
+TOKEN_LOAD = b"\xEF"
+TOKEN_RANDOMIZE = b"\xF9"
+
+
+# .tap: "10 LOAD "" CODE : RANDOMIZE USR 32768" and the code block
+def tap_block(flag, data):
+    block = bytes((flag,)) + data
+    checksum = 0
+
+    for b in block:
+        checksum ^= b
+
+    block += bytes((checksum,))
+    return struct.pack("<H", len(block)) + block
+
+
+def tap_header(kind, name, length, param1, param2):
+    return tap_block(0x00, bytes((kind,)) + name.ljust(10).encode() + struct.pack("<HHH", length, param1, param2))
+
+
+def make_tap(code):
+    program = basic_line(10, TOKEN_LOAD + b'""' + TOKEN_CODE + b":" + TOKEN_RANDOMIZE + TOKEN_USR + basic_number(CODE_ADDR))
+
+    return (tap_header(0, "zemu", len(program), 10, len(program))
+        + tap_block(0xFF, program)
+        + tap_header(3, "scene", len(code), CODE_ADDR, 0x8000)
+        + tap_block(0xFF, code))
+
+
+# .trd with "boot" (10 RANDOMIZE USR 15619 : REM : LOAD "scene" CODE, 20 RANDOMIZE USR 32768) and "scene" files.
+# Only used tracks are written, rest of the disk is formatted by the emulator.
+def make_trd(code):
+    program = (basic_line(10, TOKEN_RANDOMIZE + TOKEN_USR + basic_number(15619) + b":" + TOKEN_REM + b":"
+            + TOKEN_LOAD + b'"scene"' + TOKEN_CODE)
+        + basic_line(20, TOKEN_RANDOMIZE + TOKEN_USR + basic_number(CODE_ADDR)))
+
+    files = [
+        ("boot", "B", len(program), len(program), program + b"\x80\xAA" + struct.pack("<H", 10)),
+        ("scene", "C", CODE_ADDR, len(code), code),
+    ]
+
+    disk = bytearray(0x1000)
+    sector = 16 # first sector of track 1
+
+    for i, (name, ext, start, length, data) in enumerate(files):
+        sectors = (len(data) + 0xFF) // 0x100
+        entry = name.ljust(8).encode() + ext.encode() + struct.pack("<HHBBB", start, length, sectors, sector & 0x0F, sector >> 4)
+        disk[i * 16:i * 16 + 16] = entry
+        disk += data.ljust(sectors * 0x100, b"\x00")
+        sector += sectors
+
+    info = 0x800
+    disk[info + 0xE1] = sector & 0x0F # first free sector
+    disk[info + 0xE2] = sector >> 4 # first free track
+    disk[info + 0xE3] = 0x16 # 80 tracks, double sided
+    disk[info + 0xE4] = len(files)
+    disk[info + 0xE5:info + 0xE7] = struct.pack("<H", 2544 - (sector - 16))
+    disk[info + 0xE7] = 0x10 # TR-DOS id
+    disk[info + 0xF5:info + 0xFD] = b"zemutest"
+
+    # emulator accepts .trd images from 8k
+    return bytes(disk.ljust(max(len(disk), 0x2000), b"\x00"))
+
+
+# Programs
+
+def program_border():
+    # border stripes, changed every 600 tacts after the interrupt
+    asm = new_program()
+    asm.ei()
+    asm.label("frame")
+    asm.halt()
+    asm.xor_a()
+    asm.ld_e(112)
+    asm.label("stripe")
+    asm.out_n_a(0xFE)
+    asm.ld_b(44)
+    asm.label("delay")
+    asm.djnz("delay")
+    asm.inc_a()
+    asm.and_n(7)
+    asm.dec_e()
+    asm.jr_nz("stripe")
+    asm.jr("frame")
+    return finish_program(asm)
+
+
+def program_multicolor():
+    # attribute for every byte of bitmap (0x6000 - 0x77FF)
+    asm = new_program()
+    asm.fill_pattern(0x4000, 0x1800, lambda a: a.ld_a(0x0F))
+    asm.fill_pattern(0x6000, 0x1800, lambda a: (a.xor_h(), a.and_n(0x7F)))
+    asm.out_bc(0xEFF7, 0x20)
+    asm.halt_loop()
+    return finish_program(asm)
+
+
+def program_16colors():
+    # 4 bits per pixel, pixels are in the banks 5 and 4
+    asm = new_program()
+    asm.fill_pattern(0x4000, 0x4000, lambda a: a.xor_h())
+    asm.out_bc(0x7FFD, 0x14)
+    asm.fill_pattern(0xC000, 0x4000, lambda a: (a.add_a_h(), a.rlca()))
+    asm.out_bc(0x7FFD, 0x10)
+    asm.out_bc(0xEFF7, 0x01)
+    asm.halt_loop()
+    return finish_program(asm)
+
+
+AY_REGS = [
+    (0, 0x00), (1, 0x01), # tone A
+    (2, 0x80), (3, 0x01), # tone B
+    (4, 0xC0), (5, 0x00), # tone C
+    (6, 0x10), # noise
+    (7, 0b00110000), # tones on A, B, C, noise on A
+    (8, 0x0F), (9, 0x0C), (10, 0x10), # volume A, B, envelope on C
+    (11, 0x00), (12, 0x08), (13, 0x0E), # envelope
+]
+
+
+def program_ay():
+    asm = new_program()
+    draw_scene(asm)
+    asm.write_regs(0xFFFD, 0xBFFD, AY_REGS)
+    asm.halt_loop()
+    return finish_program(asm)
+
+
+YM2203_FM_REGS = [
+    (0x30, 0x01), (0x34, 0x02), (0x38, 0x01), (0x3C, 0x04), # DT/MUL
+    (0x40, 0x20), (0x44, 0x7F), (0x48, 0x18), (0x4C, 0x7F), # TL
+    (0x50, 0x1F), (0x54, 0x1F), (0x58, 0x1F), (0x5C, 0x1F), # KS/AR
+    (0x60, 0x00), (0x64, 0x00), (0x68, 0x00), (0x6C, 0x00), # DR
+    (0x70, 0x00), (0x74, 0x00), (0x78, 0x00), (0x7C, 0x00), # SR
+    (0x80, 0x0F), (0x84, 0x0F), (0x88, 0x0F), (0x8C, 0x0F), # SL/RR
+    (0xB0, 0x07), # channel 1: all operators are carriers
+    (0xA4, 0x22), (0xA0, 0x69), # channel 1 frequency
+    (0x28, 0xF0), # key on
+]
+
+
+def program_tsfm():
+    # AY on the second chip of TurboSound, FM on the first one
+    asm = new_program()
+    draw_scene(asm)
+    asm.out_bc(0xFFFD, 0xFE) # chip 1
+    asm.write_regs(0xFFFD, 0xBFFD, AY_REGS)
+    asm.out_bc(0xFFFD, 0xFB) # chip 0, FM on, SAA off
+    asm.write_regs(0xFFFD, 0xBFFD, YM2203_FM_REGS)
+    asm.halt_loop()
+    return finish_program(asm)
+
+
+SAA_REGS = [
+    (0x1C, 0x02), # reset
+    (0x1C, 0x01), # sound on
+    (0x00, 0xFF), (0x01, 0x8C), (0x02, 0x4A), # amplitudes
+    (0x08, 0x80), (0x09, 0x40), (0x0A, 0xC0), # frequencies
+    (0x10, 0x34), (0x11, 0x05), # octaves
+    (0x14, 0x07), # frequency enable
+    (0x15, 0x04), (0x16, 0x01), # noise on channel 2
+]
+
+
+def program_saa():
+    asm = new_program()
+    draw_scene(asm)
+    asm.out_bc(0xFFFD, 0xF7) # chip 0, FM off, SAA on
+    asm.write_regs(0x01FF, 0x00FF, SAA_REGS)
+    asm.halt_loop()
+    return finish_program(asm)
+
+
+GS_SAMPLE_SIZE = 0x1000
+
+
+def program_gs():
+    # uploads 4k sample (saw wave) to General Sound and plays it
+    asm = new_program()
+    draw_scene(asm)
+
+    def wait_command(name):
+        asm.label(name)
+        asm.in_a_c()
+        asm.bit_a(0)
+        asm.jr_nz(name)
+
+    def wait_data(name):
+        asm.label(name)
+        asm.in_a_c()
+        asm.bit_a(7)
+        asm.jr_nz(name)
+
+    asm.ld_bc(0x00BB)
+    asm.ld_a(0x38) # load FX
+    asm.out_c_a()
+    wait_command("gs_wait_load")
+    asm.ld_a(0xD1) # open stream
+    asm.out_c_a()
+    wait_command("gs_wait_open")
+
+    asm.ld_hl(GS_SAMPLE_SIZE)
+    asm.label("gs_sample")
+    asm.ld_a_l()
+    asm.rlca()
+    asm.rlca()
+    asm.rlca()
+    asm.out_n_a(0xB3)
+    wait_data("gs_wait_data")
+    asm.emit(0x2B) # dec hl
+    asm.ld_a_h()
+    asm.emit(0xB5) # or l
+    asm.jr_nz("gs_sample")
+
+    asm.ld_a(0xD2) # close stream
+    asm.out_c_a()
+    wait_command("gs_wait_close")
+
+    asm.ld_a(1) # FX number
+    asm.out_n_a(0xB3)
+    asm.ld_a(0x39) # play FX
+    asm.out_c_a()
+    wait_command("gs_wait_play")
+
+    asm.halt_loop()
+    return finish_program(asm)
+
+
+def program_scene():
+    # loaded from tape and from disk, runs with interrupts disabled, because BASIC and TR-DOS state is unknown
+    asm = new_program()
+    draw_scene(asm)
+    asm.ld_a(2)
+    asm.out_n_a(0xFE)
+    asm.di()
+    asm.label("scene_loop")
+    asm.jr("scene_loop")
+    return finish_program(asm)
+
+
+def main():
+    os.makedirs(PROGRAMS_DIR, exist_ok=True)
+
+    files = {
+        "border.z80": make_z80(program_border()),
+        "multicolor.z80": make_z80(program_multicolor()),
+        "16colors.z80": make_z80(program_16colors()),
+        "ay.z80": make_z80(program_ay()),
+        "tsfm.z80": make_z80(program_tsfm()),
+        "saa.z80": make_z80(program_saa()),
+        "gs.z80": make_z80(program_gs()),
+        "tape.tap": make_tap(program_scene()),
+        "trdos.trd": make_trd(program_scene()),
+    }
+
+    for name, data in files.items():
+        with open(os.path.join(PROGRAMS_DIR, name), "wb") as f:
+            f.write(data)
+
+
+if __name__ == "__main__":
+    main()
@@ -277,4 +277,38 @@
     void ::set_reg(s_Cpu* self, int reg, word val) {
         self->regs[reg] = val;
     }
+
+    void ::get_state(s_Cpu* self, s_CpuState* state) {
+        state->is_halted = self->is_halted;
+        state->is_opcode = self->is_opcode;
+        state->is_noint = self->is_noint;
+        state->is_reset_pv = self->is_reset_pv;
+        state->is_read_int = self->is_read_int;
+        state->prefix = self->prefix;
+    }
+
+    bool ::set_state(s_Cpu* self, const s_CpuState* state) {
+        ::t_opcode* optable;
+
+        switch (state->prefix) {
+            case 0x00: optable = optable_00; break;
+            case 0xCB: optable = optable_CB; break;
+            case 0xDD: optable = optable_DD; break;
+            case 0xED: optable = optable_ED; break;
+            case 0xFD: optable = optable_FD; break;
+            default: return false;
+        }
+
+        self->is_halted = state->is_halted;
+        self->is_opcode = state->is_opcode;
+        self->is_noint = state->is_noint;
+        self->is_reset_pv = state->is_reset_pv;
+        self->is_read_int = state->is_read_int;
+
+        self->tick = (state->is_read_int ? ::tick_int : ::tick_def);
+        self->optable = optable;
+        self->prefix = state->prefix;
+
+        return true;
+    }
 #end
@@ -192,6 +192,16 @@ typedef struct s_Cpu {
     dword tmp_dword;
 } s_Cpu;
 
+// Internal state, which is not accessible through registers (used by save states)
+typedef struct s_CpuState {
+    bool is_halted;
+    bool is_opcode;
+    bool is_noint;
+    bool is_reset_pv;
+    bool is_read_int;
+    byte prefix;
+} s_CpuState;
+
 #namespace Cpu
     extern bool ::is_tbl_initialized;
     extern byte ::tbl_parity[0x100];
@@ -223,5 +233,8 @@ typedef struct s_Cpu {
     word ::get_reg(s_Cpu* self, int reg);
     void ::set_reg(s_Cpu* self, int reg, word val);
 
+    void ::get_state(s_Cpu* self, s_CpuState* state);
+    bool ::set_state(s_Cpu* self, const s_CpuState* state);
+
     #define ::tick(cpu) (cpu->tick(cpu))
 #end
@@ -68,9 +68,19 @@ struct s_Cpu {
     Z80EX_DWORD tmp_dword;
 };
 
+struct s_CpuState {
+    bool is_halted;
+    bool is_opcode;
+    bool is_noint;
+    bool is_reset_pv;
+    bool is_read_int;
+    Z80EX_BYTE prefix;
+};
+
 #endif /* Z80EX_SELF_INCLUDE */
 
 typedef struct s_Cpu Z80EX_CONTEXT;
+typedef struct s_CpuState Z80EX_STATE;
 
 #ifndef Z80EX_SELF_INCLUDE
 
@@ -96,12 +106,16 @@ extern unsigned Cpu::do_int(s_Cpu* self);
 extern void Cpu::reset(s_Cpu* self);
 extern Z80EX_WORD Cpu::get_reg(s_Cpu* self, int reg);
 extern void Cpu::set_reg(s_Cpu* self, int reg, Z80EX_WORD value);
+extern void Cpu::get_state(s_Cpu* self, s_CpuState* state);
+extern bool Cpu::set_state(s_Cpu* self, const s_CpuState* state);
 
 #define z80ex_create Cpu::new
 #define z80ex_destroy Cpu::free
 #define z80ex_reset Cpu::reset
 #define z80ex_get_reg Cpu::get_reg
 #define z80ex_set_reg Cpu::set_reg
+#define z80ex_get_state Cpu::get_state
+#define z80ex_set_state Cpu::set_state
 #define z80ex_last_op_type(cpu) (cpu->prefix)
 #define z80ex_op_tstate(cpu) (cpu->tstate)
 